@@ -0,0 +1,96 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <stdexcept>
+#include <vector>
+#include "ContentHash.h"
+#include "strings.h"
+
+namespace takevos {
+namespace hurricane {
+
+const int ContentHash::none;
+const int ContentHash::md5;
+const int ContentHash::fast;
+
+ContentHash ContentHash::hash(int algorithm, const char *data, size_t data_size)
+{
+    switch (algorithm) {
+    case md5:   return ContentHash(algorithm, MD5(data, data_size));
+    case fast:  return ContentHash(algorithm, FastHash(data, data_size));
+    default:    throw std::runtime_error(string_format("Unknown content hash algorithm %i", algorithm));
+    }
+}
+
+void ContentHash::hash(int algorithm, size_t nr_buffers, char const * const data[], size_t const data_size[], ContentHash hashes[])
+{
+    if (algorithm == md5) {
+        std::vector<uint128_t> values(nr_buffers);
+
+        MD5(nr_buffers, data, data_size, values.data());
+        for (size_t i = 0; i < nr_buffers; i++) {
+            hashes[i] = ContentHash(algorithm, values[i]);
+        }
+
+    } else {
+        for (size_t i = 0; i < nr_buffers; i++) {
+            hashes[i] = hash(algorithm, data[i], data_size[i]);
+        }
+    }
+}
+
+ContentHasher::ContentHasher(int algorithm) : algorithm(algorithm)
+{
+    if (algorithm != ContentHash::md5 && algorithm != ContentHash::fast) {
+        throw std::runtime_error(string_format("Unknown content hash algorithm %i", algorithm));
+    }
+}
+
+char const *ContentHash::name(int algorithm)
+{
+    switch (algorithm) {
+    case md5:   return "md5";
+    case fast:  return "fast";
+    default:    return "none";
+    }
+}
+
+int ContentHash::algorithm_by_name(char const *name)
+{
+    for (auto algorithm: {md5, fast}) {
+        if (strcmp(ContentHash::name(algorithm), name) == 0) {
+            return algorithm;
+        }
+    }
+    return none;
+}
+
+std::ostream &operator<<(std::ostream &os, ContentHash const &x)
+{
+    return os << ContentHash::name(x.algorithm) << ":" << x.value;
+}
+
+}}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_CONTENTHASH_H
+#define TAKEVOS_HURRICANE_CONTENTHASH_H
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include "numbers.h"
+#include "md5.h"
+#include "fasthash.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** A hash of the contents of a file or a piece of text, used to detect changes.
+ * The algorithm is stored with the value, so that a hash calculated with a
+ * different algorithm is never equal, and persisted hashes are invalidated
+ * when the algorithm is switched.
+ */
+struct ContentHash {
+    static const int    none = 0;   ///< No hash was calculated.
+    static const int    md5  = 1;   ///< MD5, see md5.h.
+    static const int    fast = 2;   ///< The much faster non-cryptographic FastHash, see fasthash.h.
+
+    int                 algorithm;  ///< The algorithm used to calculate the value.
+    uint128_t           value;      ///< The 128 bit hash value.
+
+    ContentHash() : algorithm(none), value(0) { }
+    ContentHash(int algorithm, uint128_t value) : algorithm(algorithm), value(value) { }
+
+    /** Calculate the hash of data.
+     * @param algorithm     One of ContentHash::md5 or ContentHash::fast.
+     * @param data          The data to hash.
+     * @param data_size     The size of the data.
+     */
+    static ContentHash hash(int algorithm, const char *data, size_t data_size);
+
+    /** Calculate the hash of several independent buffers.
+     * For MD5 the buffers are hashed in parallel lanes, see MD5(size_t, ...).
+     *
+     * @param algorithm     One of ContentHash::md5 or ContentHash::fast.
+     * @param nr_buffers    The number of buffers.
+     * @param data          The data of each buffer.
+     * @param data_size     The size of each buffer.
+     * @param hashes        Returns the hash of each buffer.
+     */
+    static void hash(int algorithm, size_t nr_buffers, char const * const data[], size_t const data_size[], ContentHash hashes[]);
+
+    /** The name of an algorithm, as used on the command line.
+     */
+    static char const *name(int algorithm);
+
+    /** Find an algorithm by name.
+     * @return The algorithm, or ContentHash::none when the name is unknown.
+     */
+    static int algorithm_by_name(char const *name);
+
+    bool operator==(ContentHash const &other) const {
+        return algorithm == other.algorithm && value == other.value;
+    }
+
+    bool operator!=(ContentHash const &other) const {
+        return !(*this == other);
+    }
+};
+
+std::ostream &operator<<(std::ostream &os, ContentHash const &x);
+
+/** Calculate a ContentHash of data that is passed in pieces.
+ * The result is the same as ContentHash::hash() of the concatenated pieces.
+ */
+class ContentHasher {
+public:
+    /** Start a new hash.
+     * @param algorithm     One of ContentHash::md5 or ContentHash::fast.
+     */
+    ContentHasher(int algorithm);
+
+    /** Add a piece of data.
+     * @param data          The data to add.
+     * @param data_size     The size of the data.
+     */
+    void update(const char *data, size_t data_size) {
+        if (algorithm == ContentHash::md5) {
+            md5.update(data, data_size);
+        } else {
+            fast.update(data, data_size);
+        }
+    }
+
+    /** Finish the hash.
+     * @return The hash of all the data passed to update().
+     */
+    ContentHash final(void) {
+        return ContentHash(algorithm, algorithm == ContentHash::md5 ? md5.final() : fast.final());
+    }
+
+private:
+    int         algorithm;
+    MD5Hasher   md5;
+    FastHasher  fast;
+};
+
+}}
+#endif
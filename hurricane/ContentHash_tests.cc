@@ -0,0 +1,197 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE ContentHash
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <stdlib.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "ContentHash.h"
+#include "fasthash.h"
+#include "md5.h"
+
+using namespace takevos::hurricane;
+using namespace std;
+
+static string ContentHash_tests_random(size_t size)
+{
+    string r;
+
+    for (size_t i = 0; i < size; i++) {
+        r += (char)random();
+    }
+    return r;
+}
+
+BOOST_AUTO_TEST_CASE(FastHash_hash_1)
+{
+    // The same data gives the same hash, wherever it is in memory.
+    srandom(1);
+    auto text = ContentHash_tests_random(5000);
+    auto copy = " " + text;
+
+    for (size_t size: {0, 1, 63, 64, 65, 1024, 1087, 5000}) {
+        BOOST_CHECK_EQUAL(FastHash(text.data(), size), FastHash(&copy[1], size));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastHash_hash_2)
+{
+    // Zero bytes at the end are not ignored.
+    set<uint128_t> hashes;
+
+    for (size_t size = 0; size < 200; size++) {
+        BOOST_CHECK(hashes.insert(FastHash(string(size, '\0'))).second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastHash_hash_3)
+{
+    // Flipping any single bit changes the hash, including in the overlapping last stripe.
+    srandom(2);
+    for (size_t size: {1, 8, 63, 64, 100, 128, 1100}) {
+        auto            text = ContentHash_tests_random(size);
+        set<uint128_t>  hashes = {FastHash(text)};
+
+        for (size_t bit = 0; bit < size * 8; bit++) {
+            text[bit / 8] ^= (1 << (bit % 8));
+            BOOST_CHECK(hashes.insert(FastHash(text)).second);
+            text[bit / 8] ^= (1 << (bit % 8));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastHash_hash_4)
+{
+    // Both halves of the hash are distributed.
+    srandom(3);
+    set<uint64_t> low;
+    set<uint64_t> high;
+
+    for (int i = 0; i < 10000; i++) {
+        auto hash = FastHash(ContentHash_tests_random(random() % 300));
+        low.insert((uint64_t)hash);
+        high.insert((uint64_t)(hash >> 64));
+    }
+    BOOST_CHECK_GT(low.size(), 9900);
+    BOOST_CHECK_GT(high.size(), 9900);
+}
+
+BOOST_AUTO_TEST_CASE(FastHash_hash_5)
+{
+    // Every implementation gives the same hash, also across the scramble after each block of 1024 bytes.
+    srandom(5);
+    auto text = ContentHash_tests_random(10000);
+
+    for (size_t size = 0; size < text.size(); size += 1 + random() % 97) {
+        auto expected = FastHash(text.data(), size, FastHash_scalar);
+
+        BOOST_CHECK_EQUAL(FastHash(text.data(), size), expected);
+        if (__builtin_cpu_supports("avx2")) {
+            BOOST_CHECK_EQUAL(FastHash(text.data(), size, FastHash_avx2), expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastHash_hasher_1)
+{
+    // Pieces of random sizes give the same hash as the whole text.
+    srandom(6);
+    auto text = ContentHash_tests_random(20000);
+
+    for (int i = 0; i < 300; i++) {
+        size_t size = i < 200 ? i : random() % text.size();
+
+        for (auto implementation: {FastHash_scalar, FastHash_best_implementation()}) {
+            FastHasher hasher(implementation);
+
+            for (size_t offset = 0; offset < size;) {
+                size_t piece = std::min(size - offset, (size_t)(random() % (i % 2 == 0 ? 150 : 5000)));
+                hasher.update(&text[offset], piece);
+                offset += piece;
+            }
+            BOOST_CHECK_EQUAL(hasher.final(), FastHash(text.data(), size));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ContentHash_hasher_1)
+{
+    for (auto algorithm: {ContentHash::md5, ContentHash::fast}) {
+        ContentHasher hasher(algorithm);
+
+        hasher.update("a", 1);
+        hasher.update("bc", 2);
+        BOOST_CHECK_EQUAL(hasher.final(), ContentHash::hash(algorithm, "abc", 3));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ContentHash_hash_1)
+{
+    auto md5 = ContentHash::hash(ContentHash::md5, "abc", 3);
+    auto fast = ContentHash::hash(ContentHash::fast, "abc", 3);
+
+    BOOST_CHECK_EQUAL(md5, ContentHash(ContentHash::md5, 0x900150983cd24fb0d6963f7d28e17f72_ULLL));
+    BOOST_CHECK_EQUAL(fast, ContentHash(ContentHash::fast, FastHash("abc")));
+
+    // Hashes of different algorithms are never equal.
+    BOOST_CHECK_NE(ContentHash(ContentHash::md5, fast.value), fast);
+    BOOST_CHECK_THROW(ContentHash::hash(ContentHash::none, "abc", 3), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ContentHash_hash_2)
+{
+    srandom(4);
+    vector<string>      texts;
+    vector<char const*> data;
+    vector<size_t>      data_size;
+
+    for (int i = 0; i < 37; i++) {
+        texts.push_back(ContentHash_tests_random(random() % 3000));
+    }
+    for (auto &text: texts) {
+        data.push_back(text.data());
+        data_size.push_back(text.size());
+    }
+
+    for (auto algorithm: {ContentHash::md5, ContentHash::fast}) {
+        vector<ContentHash> hashes(texts.size());
+
+        ContentHash::hash(algorithm, texts.size(), data.data(), data_size.data(), hashes.data());
+        for (size_t i = 0; i < texts.size(); i++) {
+            BOOST_CHECK_EQUAL(hashes[i], ContentHash::hash(algorithm, data[i], data_size[i]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ContentHash_name_1)
+{
+    BOOST_CHECK_EQUAL(ContentHash::algorithm_by_name("md5"), ContentHash::md5);
+    BOOST_CHECK_EQUAL(ContentHash::algorithm_by_name("fast"), ContentHash::fast);
+    BOOST_CHECK_EQUAL(ContentHash::algorithm_by_name("sha1"), ContentHash::none);
+    BOOST_CHECK_EQUAL(ContentHash::name(ContentHash::md5), string("md5"));
+}
@@ -0,0 +1,613 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdexcept>
+#include <algorithm>
+#include <map>
+#include <bitset>
+#include <unordered_map>
+#include "DFA.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** The maximum number of states in a DFA, to protect against exponential blowup.
+ */
+const size_t DFA_max_states = 65536;
+
+/** The maximum number of single layer states explored to find out if a match attempt will always match.
+ */
+const size_t DFA_max_certain_states = 64;
+
+/** The maximum number of bytes that leave a state for it to be accelerated.
+ * With more bytes the prefilter would stop too often to be faster than the transitions.
+ */
+const size_t DFA_max_accelerator_bytes = 96;
+
+/** Hash of a vector of integers, used to quickly find existing states.
+ */
+template <typename T>
+struct DFAVectorHash {
+    size_t operator()(std::vector<T> const &x) const {
+        size_t r = x.size();
+
+        for (auto i: x) {
+            r = (r ^ (size_t)i) * 0x100000001b3ULL;
+        }
+        return r;
+    }
+};
+
+/** A DFA state during construction.
+ */
+struct DFAStateInfo {
+    bool                            matched;        ///< A match was found, no new match attempts are started.
+    bool                            after_newline;  ///< The previous byte was a newline.
+    std::vector<std::vector<int>>   layers;         ///< NFA states of each live match attempt, earliest first.
+
+    std::vector<int> key(void) const {
+        std::vector<int> r;
+
+        r.push_back(matched);
+        r.push_back(after_newline);
+        for (auto &layer: layers) {
+            r.push_back((int)layer.size());
+            r.insert(r.end(), layer.begin(), layer.end());
+        }
+        return r;
+    }
+};
+
+/** A DFA state after resolving its assertions and matches, before consuming the next symbol.
+ */
+struct DFAResolvedState {
+    DFAStateInfo            info;           ///< The remaining layers.
+    std::vector<int16_t>    origin;         ///< For each remaining layer, its index in the original state.
+    int16_t                 accept_layer;   ///< The original layer that matched, or -1.
+    int16_t                 accept_pattern; ///< The pattern that matched.
+};
+
+/** Subset construction of a DFA from an NFA.
+ */
+class DFABuilder {
+public:
+    NFA const                               &nfa;
+    DFA                                     &dfa;
+    std::vector<DFAStateInfo>               states;
+    std::unordered_map<std::vector<int>,int32_t,DFAVectorHash<int>>             state_ids;
+    std::unordered_map<std::vector<int16_t>,uint32_t,DFAVectorHash<int16_t>>    layer_map_ids;
+    std::vector<int>                        class_bytes;    ///< A representative byte for each class.
+    std::map<std::vector<int>,bool>         certain_cache;  ///< Memoized results of certain_to_match().
+    std::vector<uint32_t>                   visited;        ///< Generation in which each NFA node was last visited.
+    uint32_t                                generation;
+
+    DFABuilder(NFA const &nfa, DFA &dfa) : nfa(nfa), dfa(dfa), visited(nfa.nodes.size()), generation(0) {
+    }
+
+    /** Group bytes that behave identically in every character set.
+     */
+    void build_byte_classes(void) {
+        std::map<std::vector<bool>,int> classes;
+
+        for (int b = 0; b < 256; b++) {
+            std::vector<bool> signature;
+
+            // A newline is always in a class of its own, because of the line assertions.
+            signature.push_back(b == '\n');
+            for (auto &char_set: nfa.char_sets) {
+                signature.push_back(char_set[b]);
+            }
+
+            auto i = classes.find(signature);
+            if (i == classes.end()) {
+                i = classes.insert(std::make_pair(signature, (int)classes.size())).first;
+                class_bytes.push_back(b);
+            }
+            dfa.byte_classes[b] = (uint8_t)i->second;
+        }
+
+        dfa.end_of_text = (int)classes.size();
+        dfa.nr_symbols = dfa.end_of_text + 1;
+    }
+
+    /** Follow all non-consuming NFA nodes from the seeds.
+     * Nodes that were visited by an earlier layer are skipped, because the
+     * earlier layer will always produce a more leftmost match.
+     *
+     * @param seeds     The NFA nodes to start from.
+     * @param bol_ok    The current position is at the beginning of a line.
+     * @param eol_ok    The current position is at the end of a line.
+     *                  When false the eol nodes are kept so that they can be resolved later.
+     * @return          The consuming, accepting and pending eol nodes, sorted.
+     */
+    std::vector<int> closure(std::vector<int> const &seeds, bool bol_ok, bool eol_ok) {
+        std::vector<int> r;
+        std::vector<int> todo(seeds.rbegin(), seeds.rend());
+
+        while (!todo.empty()) {
+            auto i = todo.back();
+            todo.pop_back();
+
+            if (visited[i] == generation) {
+                continue;
+            }
+            visited[i] = generation;
+
+            auto &node = nfa.nodes[i];
+            switch (node.type) {
+            case NFANode::byte_set:
+            case NFANode::accept:
+                r.push_back(i);
+                break;
+            case NFANode::split:
+                todo.push_back(node.out1);
+                todo.push_back(node.out);
+                break;
+            case NFANode::jump:
+            case NFANode::save:
+                todo.push_back(node.out);
+                break;
+            case NFANode::bol:
+                if (bol_ok) {
+                    todo.push_back(node.out);
+                }
+                break;
+            case NFANode::eol:
+                if (eol_ok) {
+                    todo.push_back(node.out);
+                } else {
+                    r.push_back(i);
+                }
+                break;
+            }
+        }
+
+        std::sort(r.begin(), r.end());
+        return r;
+    }
+
+    void clear_visited(void) {
+        generation++;
+    }
+
+    int32_t intern_state(DFAStateInfo const &info) {
+        auto key = info.key();
+
+        auto i = state_ids.find(key);
+        if (i != state_ids.end()) {
+            return i->second;
+        }
+
+        if (states.size() >= DFA_max_states) {
+            throw std::runtime_error("DFA has too many states.");
+        }
+
+        auto id = (int32_t)states.size();
+        states.push_back(info);
+        state_ids[key] = id;
+        dfa.state_layers.push_back((int16_t)info.layers.size());
+        dfa.max_layers = std::max(dfa.max_layers, (int)info.layers.size());
+        return id;
+    }
+
+    uint32_t intern_layer_map(std::vector<int16_t> const &layer_map) {
+        auto i = layer_map_ids.find(layer_map);
+        if (i != layer_map_ids.end()) {
+            return i->second;
+        }
+
+        auto offset = (uint32_t)dfa.layer_maps.size();
+        dfa.layer_maps.insert(dfa.layer_maps.end(), layer_map.begin(), layer_map.end());
+        layer_map_ids[layer_map] = offset;
+        return offset;
+    }
+
+    /** Resolve the assertions of a state and find the earliest layer that matched.
+     *
+     * @param info      The state.
+     * @param at_eol    The next symbol is a newline or the end of the text.
+     * @return          The state after matching, with its accept information.
+     */
+    DFAResolvedState resolve(DFAStateInfo const &info, bool at_eol) {
+        DFAResolvedState r;
+
+        r.info = info;
+        r.accept_layer = -1;
+        r.accept_pattern = -1;
+        for (size_t i = 0; i < info.layers.size(); i++) {
+            r.origin.push_back((int16_t)i);
+        }
+
+        if (at_eol) {
+            // Resolve the pending end-of-line assertions before looking for matches.
+            clear_visited();
+            for (size_t i = 0; i < r.info.layers.size(); ) {
+                r.info.layers[i] = closure(r.info.layers[i], r.info.after_newline, true);
+                if (r.info.layers[i].empty()) {
+                    r.info.layers.erase(r.info.layers.begin() + i);
+                    r.origin.erase(r.origin.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        // Find the earliest layer that matched.
+        for (size_t i = 0; i < r.info.layers.size() && r.accept_layer == -1; i++) {
+            for (auto x: r.info.layers[i]) {
+                auto &node = nfa.nodes[x];
+                if (node.type == NFANode::accept && (r.accept_layer == -1 || node.arg < r.accept_pattern)) {
+                    r.accept_layer = r.origin[i];
+                    r.accept_pattern = (int16_t)node.arg;
+                }
+            }
+
+            if (r.accept_layer != -1) {
+                // Match attempts that started later can never produce a leftmost match.
+                r.info.layers.resize(i + 1);
+                r.origin.resize(i + 1);
+                r.info.matched = true;
+            }
+        }
+        return r;
+    }
+
+    /** Check if a match attempt will produce a match whatever text follows.
+     * For example a comment up to the end of the line will always match once it was started.
+     * Match attempts that started later can then never produce a leftmost match.
+     *
+     * The single layer states reachable from the layer are explored; a state fails
+     * when it has no accept at the end of the text, or when a byte kills it. When
+     * too many states are reachable the match attempt is treated as uncertain.
+     * This function uses the visited marks, so it may not be called during a closure.
+     *
+     * @param layer         The NFA nodes of the match attempt.
+     * @param after_newline The previous byte was a newline.
+     * @return              true when the match attempt will always match.
+     */
+    bool certain_to_match(std::vector<int> const &layer, bool after_newline) {
+        auto root_key = layer;
+        root_key.push_back(after_newline);
+
+        auto cached = certain_cache.find(root_key);
+        if (cached != certain_cache.end()) {
+            return cached->second;
+        }
+
+        std::vector<std::pair<std::vector<int>,bool>>   nodes;
+        std::map<std::vector<int>,size_t>               node_ids;
+        std::vector<std::vector<size_t>>                edges;
+        std::vector<bool>                               failed;
+
+        nodes.push_back(std::make_pair(layer, after_newline));
+        node_ids[root_key] = 0;
+
+        bool too_large = false;
+        for (size_t n = 0; n < nodes.size() && !too_large; n++) {
+            auto set = nodes[n].first;
+            auto newline = nodes[n].second;
+
+            edges.emplace_back();
+            failed.push_back(false);
+
+            bool accepts = false;
+            for (auto x: set) {
+                accepts |= nfa.nodes[x].type == NFANode::accept;
+            }
+            if (accepts) {
+                continue;
+            }
+
+            // The text may end here, or a newline may follow.
+            clear_visited();
+            for (auto x: closure(set, newline, true)) {
+                accepts |= nfa.nodes[x].type == NFANode::accept;
+            }
+            if (!accepts) {
+                failed[n] = true;
+                continue;
+            }
+
+            for (int symbol = 0; symbol < dfa.end_of_text; symbol++) {
+                auto byte = class_bytes[symbol];
+                if (byte == '\n') {
+                    continue;
+                }
+
+                std::vector<int> seeds;
+                for (auto x: set) {
+                    auto &node = nfa.nodes[x];
+                    if (node.type == NFANode::byte_set && nfa.char_sets[node.arg][byte]) {
+                        seeds.push_back(node.out);
+                    }
+                }
+
+                clear_visited();
+                auto next = closure(seeds, false, false);
+                if (next.empty()) {
+                    failed[n] = true;
+                    break;
+                }
+
+                auto next_key = next;
+                next_key.push_back(false);
+                auto i = node_ids.find(next_key);
+                if (i == node_ids.end()) {
+                    if (nodes.size() >= DFA_max_certain_states) {
+                        too_large = true;
+                        break;
+                    }
+                    i = node_ids.insert(std::make_pair(next_key, nodes.size())).first;
+                    nodes.push_back(std::make_pair(next, false));
+                }
+                edges[n].push_back(i->second);
+            }
+        }
+
+        if (too_large) {
+            certain_cache[root_key] = false;
+            return false;
+        }
+
+        // A state fails when any of its successors fail.
+        for (bool changed = true; changed; ) {
+            changed = false;
+            for (size_t n = 0; n < nodes.size(); n++) {
+                for (auto e: edges[n]) {
+                    if (!failed[n] && failed[e]) {
+                        failed[n] = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        certain_cache[root_key] = !failed[0];
+        return !failed[0];
+    }
+
+    /** Calculate the transition from a resolved state on a symbol.
+     * Symbols which advance the same NFA nodes share a transition, which is found in the cache.
+     */
+    DFATransition transition(DFAResolvedState const &resolved, int symbol, std::map<std::vector<int>,DFATransition> &cache) {
+        DFATransition   r = {DFA::dead, resolved.accept_layer, resolved.accept_pattern, 0};
+        auto            &info = resolved.info;
+
+        if (symbol == dfa.end_of_text) {
+            return r;
+        }
+
+        // Find the NFA nodes reached by consuming the byte.
+        auto byte = class_bytes[symbol];
+        bool newline = byte == '\n';
+        std::vector<std::vector<int>> seeds(info.layers.size());
+        std::vector<int> key;
+
+        key.push_back(newline);
+        key.push_back(resolved.accept_layer);
+        for (size_t i = 0; i < info.layers.size(); i++) {
+            for (auto x: info.layers[i]) {
+                auto &node = nfa.nodes[x];
+                if (node.type == NFANode::byte_set && nfa.char_sets[node.arg][byte]) {
+                    seeds[i].push_back(node.out);
+                }
+            }
+            key.push_back(-1);
+            key.insert(key.end(), seeds[i].begin(), seeds[i].end());
+        }
+
+        auto cached = cache.find(key);
+        if (cached != cache.end()) {
+            return cached->second;
+        }
+
+        DFAStateInfo next;
+        std::vector<int16_t> next_origin;
+
+        next.matched = info.matched;
+        next.after_newline = newline;
+
+        clear_visited();
+        for (size_t i = 0; i < info.layers.size(); i++) {
+            auto layer = closure(seeds[i], newline, false);
+            if (!layer.empty()) {
+                next.layers.push_back(layer);
+                next_origin.push_back(resolved.origin[i]);
+            }
+        }
+
+        if (!next.matched) {
+            // Start a new match attempt after this byte.
+            auto layer = closure(nfa.pattern_starts, newline, false);
+            if (!layer.empty()) {
+                next.layers.push_back(layer);
+                next_origin.push_back(-1);
+            }
+        }
+
+        // Layers after one that will always match can be dropped, like after an actual match.
+        for (size_t i = 0; i < next.layers.size(); i++) {
+            if (certain_to_match(next.layers[i], newline)) {
+                next.layers.resize(i + 1);
+                next_origin.resize(i + 1);
+                next.matched = true;
+            }
+        }
+
+        if (!next.layers.empty()) {
+            r.next = intern_state(next);
+            r.layer_map = intern_layer_map(next_origin);
+        }
+        cache[key] = r;
+        return r;
+    }
+
+    void build(void) {
+        build_byte_classes();
+
+        if (nfa.pattern_starts.empty()) {
+            return;
+        }
+
+        // The start of the text is the beginning of a line.
+        DFAStateInfo initial;
+        initial.matched = false;
+        initial.after_newline = true;
+        clear_visited();
+        initial.layers.push_back(closure(nfa.pattern_starts, true, false));
+        intern_state(initial);
+
+        // States are added while transitions are calculated.
+        for (int32_t state = 0; state < (int32_t)states.size(); state++) {
+            auto info = states[state];
+            auto resolved = resolve(info, false);
+            auto resolved_at_eol = resolve(info, true);
+            std::map<std::vector<int>,DFATransition> cache;
+
+            for (int symbol = 0; symbol < dfa.nr_symbols; symbol++) {
+                bool at_eol = symbol == dfa.end_of_text || symbol == dfa.byte_classes[(int)'\n'];
+
+                dfa.transitions.push_back(transition(at_eol ? resolved_at_eol : resolved, symbol, cache));
+            }
+        }
+
+        build_accelerators();
+    }
+
+    /** Find states that loop back into themselves on most bytes.
+     * A looping byte may only start new match attempts; the other layers must stay in place.
+     */
+    void build_accelerators(void) {
+        for (int32_t state = 0; state < (int32_t)states.size(); state++) {
+            std::bitset<256> stop_bytes;
+            int64_t layer_map = -1;
+
+            for (int b = 0; b < 256; b++) {
+                auto &t = dfa.transitions[state * dfa.nr_symbols + dfa.byte_classes[b]];
+
+                bool loops = t.next == state && t.accept_layer == -1 && (layer_map == -1 || t.layer_map == layer_map);
+                for (int i = 0; loops && i < dfa.state_layers[state]; i++) {
+                    auto origin = dfa.layer_maps[t.layer_map + i];
+                    loops = origin == -1 || origin == i;
+                }
+
+                if (loops) {
+                    layer_map = t.layer_map;
+                } else {
+                    stop_bytes[b] = true;
+                }
+            }
+
+            if (layer_map != -1 && stop_bytes.count() <= DFA_max_accelerator_bytes) {
+                dfa.state_accelerators.push_back((int32_t)dfa.accelerators.size());
+                dfa.accelerators.push_back({Prefilter(stop_bytes), (uint32_t)layer_map});
+            } else {
+                dfa.state_accelerators.push_back(-1);
+            }
+        }
+    }
+};
+
+DFA::DFA() :
+    nr_symbols(1), end_of_text(0), max_layers(0)
+{
+    std::fill(byte_classes, byte_classes + 256, 0);
+}
+
+DFA::DFA(NFA const &nfa) :
+    nr_symbols(1), end_of_text(0), max_layers(0)
+{
+    DFABuilder builder(nfa, *this);
+
+    builder.build();
+}
+
+/** Memory used by DFA::search(), kept between calls on the same thread.
+ */
+static thread_local std::vector<size_t> DFA_search_scratch;
+
+bool DFA::search(char const * const text, size_t text_size, DFAMatch &match) const
+{
+    if (state_layers.empty()) {
+        return false;
+    }
+
+    // The start offset of the match attempt of each layer of the current and next state,
+    // in memory that is kept between searches on the same thread.
+    auto    &scratch = DFA_search_scratch;
+    if (scratch.size() < 2 * (size_t)max_layers) {
+        scratch.resize(2 * max_layers);
+    }
+    size_t  *starts = &scratch[0];
+    size_t  *next_starts = &scratch[max_layers];
+    int32_t state = 0;
+    bool    found = false;
+
+    starts[0] = 0;
+    for (size_t pos = 0; ; pos++) {
+        auto accelerator = state_accelerators[state];
+        if (accelerator != -1 && pos < text_size) {
+            auto &a = accelerators[accelerator];
+            auto stop = a.prefilter.find(text, text_size, pos);
+
+            if (stop != pos) {
+                // The skipped bytes loop back into this state, only restarting new match attempts.
+                auto layer_map = &layer_maps[a.layer_map];
+                for (int i = 0; i < state_layers[state]; i++) {
+                    if (layer_map[i] == -1) {
+                        starts[i] = stop;
+                    }
+                }
+                pos = stop;
+            }
+        }
+
+        int symbol = pos < text_size ? byte_classes[(uint8_t)text[pos]] : end_of_text;
+        auto &t = transitions[state * nr_symbols + symbol];
+
+        if (t.accept_layer != -1) {
+            // Any later match is either more leftmost or longer than this one.
+            found = true;
+            match.pattern = t.accept_pattern;
+            match.begin = starts[t.accept_layer];
+            match.end = pos;
+        }
+
+        if (t.next == dead) {
+            // The match only depends on the bytes up to here, which is used to re-tokenize part of a text.
+            match.scan_end = pos + 1;
+            return found;
+        }
+
+        auto layer_map = &layer_maps[t.layer_map];
+        for (int i = 0; i < state_layers[t.next]; i++) {
+            next_starts[i] = layer_map[i] == -1 ? pos + 1 : starts[layer_map[i]];
+        }
+        std::swap(starts, next_starts);
+        state = t.next;
+    }
+}
+
+}}
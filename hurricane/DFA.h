@@ -0,0 +1,123 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_DFA_H
+#define TAKEVOS_HURRICANE_DFA_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "NFA.h"
+#include "Prefilter.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** The location of a match found by the DFA.
+ */
+struct DFAMatch {
+    int         pattern;    ///< Index of the pattern that matched.
+    size_t      begin;      ///< Offset of the first byte of the match.
+    size_t      end;        ///< Offset one beyond the last byte of the match.
+    size_t      scan_end;   ///< Offset one beyond the last byte examined, text_size + 1 when the end of the text was examined.
+};
+
+/** A transition between two DFA states on a single input symbol.
+ */
+struct DFATransition {
+    int32_t     next;           ///< The next state, or DFA::dead.
+    int16_t     accept_layer;   ///< The layer that matched before consuming the symbol, or -1.
+    int16_t     accept_pattern; ///< The pattern that matched in accept_layer.
+    uint32_t    layer_map;      ///< Offset in DFA::layer_maps describing where each layer of the next state came from.
+};
+
+/** A state which loops back into itself on most bytes.
+ * The search skips over those bytes with a prefilter, instead of
+ * following the transitions one byte at a time.
+ */
+struct DFAAccelerator {
+    Prefilter   prefilter;  ///< Finds the bytes that leave the state.
+    uint32_t    layer_map;  ///< Offset in DFA::layer_maps of the transition that loops back.
+};
+
+/** A deterministic automaton which finds the leftmost-longest match of a set of patterns.
+ *
+ * Each DFA state is an ordered list of layers, each layer being the set
+ * of NFA states reached by a match attempt that started at a different
+ * position in the text. Earlier layers started earlier, and an NFA state
+ * only appears in the earliest layer that reached it. During a search only
+ * the start position of each layer needs to be tracked, which is updated
+ * through the layer_map of each transition.
+ *
+ * This makes it possible to find the leftmost-longest match in a single
+ * pass over the text, instead of trying a match at every position.
+ * When two patterns match the same text the earliest pattern wins.
+ *
+ * States that loop back into themselves on most bytes, such as the state
+ * between tokens or inside a comment, are accelerated by searching for
+ * the next byte that leaves the state using SIMD instructions.
+ *
+ * The DFA is fully constructed when it is created; after that it is
+ * immutable and can be used from several threads at once.
+ */
+class DFA {
+public:
+    static const int32_t        dead = -1;          ///< State without any live match attempts.
+
+    int                         nr_symbols;         ///< Number of byte classes, plus one for the end of text.
+    int                         end_of_text;        ///< Symbol that is used at the end of the text.
+    int                         max_layers;         ///< Largest number of layers in any state.
+    uint8_t                     byte_classes[256];  ///< The symbol for each byte value.
+    std::vector<DFATransition>  transitions;        ///< nr_symbols transitions for each state.
+    std::vector<int16_t>        layer_maps;         ///< Index of the previous layer for each layer, -1 for a new match attempt.
+    std::vector<int16_t>        state_layers;       ///< Number of layers in each state.
+    std::vector<int32_t>        state_accelerators; ///< Index in accelerators for each state, or -1.
+    std::vector<DFAAccelerator> accelerators;       ///< Prefilters for states with many looping bytes.
+
+    DFA();
+
+    /** Construct a DFA from all patterns in the NFA.
+     * @param nfa   The NFA.
+     */
+    DFA(NFA const &nfa);
+
+    /** Find the leftmost-longest match in the text.
+     * The start of the text is treated as the beginning of a line.
+     *
+     * @param text          The text to search.
+     * @param text_size     The size of the text.
+     * @param match         Returns the location of the match.
+     * @return true when a match was found.
+     */
+    bool search(char const * const text, size_t text_size, DFAMatch &match) const;
+
+    /** The number of states in the DFA.
+     */
+    size_t size(void) const {
+        return state_layers.size();
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,410 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <exception>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "DirectoryWalker.h"
+#include "FileStatCache.h"
+#include "ThreadPool.h"
+#include "TokenizerCache.h"
+#include "md5.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace takevos {
+namespace hurricane {
+
+/** Size of the buffer for reading the entries of a directory.
+ */
+static const size_t DirectoryWalker_buffer_size = 32 * 1024;
+
+/** The version of the cache file with the listings of directories.
+ * Increment when the format of the file, or what is listed changes.
+ */
+static const uint32_t DirectoryWalker_cache_version = 1;
+
+/** Identifies the cache file with the listings of directories.
+ */
+static const char DirectoryWalker_cache_magic[8] = {'H', 'R', 'C', 'D', 'I', 'R', 'L', 'S'};
+
+/** An entry of a directory, with the type as in struct dirent.
+ */
+struct DirectoryWalkerEntry {
+    std::string     name;
+    unsigned char   type;
+};
+
+#ifdef __linux__
+/** The layout of the entries returned by getdents64, which glibc does not declare.
+ */
+struct DirectoryWalker_dirent64 {
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[1];
+};
+#endif
+
+/** Read all entries of a directory, except '.' and '..'.
+ * @param fd        The open directory, which stays open.
+ * @param entries   The entries.
+ * @return false when the directory could not be read.
+ */
+static bool DirectoryWalker_read(int fd, std::vector<DirectoryWalkerEntry> &entries)
+{
+    auto is_dots = [](char const *name) {
+        return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+    };
+
+#ifdef __linux__
+    alignas(8) char buffer[DirectoryWalker_buffer_size];
+
+    while (true) {
+        auto size = syscall(SYS_getdents64, fd, buffer, sizeof (buffer));
+        if (size == -1) {
+            return false;
+        }
+        if (size == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < size;) {
+            auto entry = (DirectoryWalker_dirent64 *)&buffer[offset];
+            if (!is_dots(entry->d_name)) {
+                entries.push_back(DirectoryWalkerEntry{entry->d_name, entry->d_type});
+            }
+            offset += entry->d_reclen;
+        }
+    }
+
+#else
+    // The directory stream takes over its file descriptor.
+    auto dir_fd = ::dup(fd);
+    auto dir = dir_fd != -1 ? fdopendir(dir_fd) : NULL;
+    if (dir == NULL) {
+        if (dir_fd != -1) {
+            ::close(dir_fd);
+        }
+        return false;
+    }
+
+    while (auto entry = readdir(dir)) {
+        if (!is_dots(entry->d_name)) {
+            entries.push_back(DirectoryWalkerEntry{entry->d_name, entry->d_type});
+        }
+    }
+    closedir(dir);
+#endif
+    return true;
+}
+
+DirectoryWalker::DirectoryWalker(std::vector<std::string> const &extensions, std::string const &library_filename, fs::path const &cache_filename) :
+    nr_directories(0), nr_replayed(0), nr_stats(0), extensions(extensions.begin(), extensions.end()), library_filename(library_filename),
+    cache_filename(cache_filename), listings_changed(false)
+{
+}
+
+bool DirectoryWalker::matches(char const *name) const
+{
+    auto extension = strrchr(name, '.');
+
+    return extension != NULL && extension != name && extensions.count(extension) > 0;
+}
+
+uint128_t DirectoryWalker::cache_key(fs::path const &directory) const
+{
+    MD5Hasher                   hasher;
+    std::vector<std::string>    sorted_extensions(extensions.begin(), extensions.end());
+
+    std::sort(sorted_extensions.begin(), sorted_extensions.end());
+
+    hasher.value(DirectoryWalker_cache_version);
+    hasher.value((uint32_t)sizeof (FileStat));
+    hasher.string(directory.string());
+    hasher.value((uint64_t)sorted_extensions.size());
+    for (auto &extension: sorted_extensions) {
+        hasher.value((uint64_t)extension.size());
+        hasher.string(extension);
+    }
+    hasher.string(library_filename);
+    return hasher.final();
+}
+
+void DirectoryWalker::load_listings(fs::path const &directory)
+{
+    listings.clear();
+    listings_changed = false;
+    if (cache_filename.empty()) {
+        return;
+    }
+
+    auto valid = TokenizerCache::read_file(cache_filename, DirectoryWalker_cache_magic, cache_key(directory), [this](TokenizerCacheReader &reader) {
+        uint64_t nr_listings;
+
+        reader.value(nr_listings);
+        for (uint64_t i = 0; i < nr_listings; i++) {
+            std::string path;
+            Listing     listing;
+            uint8_t     is_library;
+
+            reader.string(path);
+            reader.value(listing.stat);
+            reader.value(listing.listed_ns);
+            reader.value(is_library);
+            listing.is_library = is_library != 0;
+            listing.visited = false;
+            for (auto names: {&listing.files, &listing.links, &listing.directories}) {
+                uint64_t nr_names;
+
+                reader.value(nr_names);
+                for (uint64_t j = 0; j < nr_names; j++) {
+                    std::string name;
+                    reader.string(name);
+                    names->push_back(std::move(name));
+                }
+            }
+            listings.emplace(std::move(path), std::move(listing));
+        }
+    });
+
+    if (!valid) {
+        listings.clear();
+    }
+}
+
+void DirectoryWalker::save_listings(fs::path const &directory)
+{
+    if (cache_filename.empty()) {
+        return;
+    }
+
+    // Directories that were not found by this walk were removed, or are now part of a library.
+    auto nr_listings = listings.size();
+    for (auto i = listings.begin(); i != listings.end();) {
+        i = i->second.visited ? std::next(i) : listings.erase(i);
+    }
+    if (!listings_changed && listings.size() == nr_listings) {
+        return;
+    }
+
+    TokenizerCacheWriter writer;
+
+    writer.value((uint64_t)listings.size());
+    for (auto &item: listings) {
+        auto &listing = item.second;
+
+        writer.string(item.first);
+        writer.value(listing.stat);
+        writer.value(listing.listed_ns);
+        writer.value((uint8_t)listing.is_library);
+        for (auto names: {&listing.files, &listing.links, &listing.directories}) {
+            writer.value((uint64_t)names->size());
+            for (auto &name: *names) {
+                writer.string(name);
+            }
+        }
+    }
+
+    // The cache is only an optimization, the next walk will read every directory.
+    try {
+        fs::create_directories(cache_filename.parent_path());
+        TokenizerCache::write_file(cache_filename, DirectoryWalker_cache_magic, cache_key(directory), writer);
+    } catch (std::exception &) {
+    }
+}
+
+void DirectoryWalker::walk(fs::path const &directory, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library)
+{
+    auto            &pool = ThreadPool::shared();
+    ThreadPoolGroup group;
+
+    nr_directories = 0;
+    nr_replayed = 0;
+    nr_stats = 0;
+    load_listings(directory);
+
+    pool.submit(group, [this,&pool,&group,&directory,&on_file,&on_library]() {
+        walk_directory(pool, group, directory, true, on_file, on_library);
+    });
+    pool.wait(group);
+
+    save_listings(directory);
+}
+
+void DirectoryWalker::walk_directory(ThreadPool &pool, ThreadPoolGroup &group, fs::path const &directory, bool is_root, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library)
+{
+    if (cache_filename.empty()) {
+        Listing listing;
+
+        read_directory(pool, group, directory, is_root, on_file, on_library, listing);
+        return;
+    }
+
+    // The directory is stat'ed before it is read, so that a change during the read is found by the next walk.
+    Listing     listing;
+    Listing     *cached = NULL;
+    auto        entry = FileStatCache::shared().refresh(directory);
+
+    if (!entry.found) {
+        throw std::runtime_error("Cannot open directory '" + directory.string() + "'.");
+    }
+    listing.stat = entry.stat;
+    listing.listed_ns = FileStat::now_ns();
+    listing.visited = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto i = listings.find(directory.string());
+        if (i != listings.end()) {
+            // Elements of an unordered_map are not moved by an insert, and each directory is walked by a single task.
+            cached = &i->second;
+            cached->visited = true;
+        }
+    }
+
+    // The directory may have changed again within the resolution of its modification time.
+    if (cached != NULL && cached->stat == listing.stat && !listing.stat.is_racy(cached->listed_ns)) {
+        replay_directory(pool, group, directory, on_file, on_library, *cached);
+        return;
+    }
+
+    read_directory(pool, group, directory, is_root, on_file, on_library, listing);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    listings[directory.string()] = std::move(listing);
+    listings_changed = true;
+}
+
+void DirectoryWalker::replay_directory(ThreadPool &pool, ThreadPoolGroup &group, fs::path const &directory, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library, Listing const &listing)
+{
+    nr_replayed++;
+    if (listing.is_library) {
+        on_library(directory);
+        return;
+    }
+
+    for (auto &name: listing.directories) {
+        auto subdirectory = directory / name;
+        pool.submit(group, [this,&pool,&group,subdirectory,&on_file,&on_library]() {
+            walk_directory(pool, group, subdirectory, false, on_file, on_library);
+        });
+    }
+
+    for (auto &name: listing.files) {
+        on_file(directory / name);
+    }
+
+    for (auto &name: listing.links) {
+        auto path = directory / name;
+
+        nr_stats++;
+        if (FileStatCache::shared().refresh(path).is_regular_file()) {
+            on_file(path);
+        }
+    }
+}
+
+void DirectoryWalker::read_directory(ThreadPool &pool, ThreadPoolGroup &group, fs::path const &directory, bool is_root, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library, Listing &listing)
+{
+    std::vector<DirectoryWalkerEntry>   entries;
+    int                                 fd;
+
+    nr_directories++;
+    listing.is_library = false;
+    if ((fd = ::open(directory.string().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        throw std::runtime_error("Cannot open directory '" + directory.string() + "'.");
+    }
+
+    if (!DirectoryWalker_read(fd, entries)) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read directory '" + directory.string() + "'.");
+    }
+
+    if (!is_root) {
+        for (auto &entry: entries) {
+            if (entry.name == library_filename) {
+                ::close(fd);
+                listing.is_library = true;
+                on_library(directory);
+                return;
+            }
+        }
+    }
+
+    try {
+        for (auto &entry: entries) {
+            auto        type = entry.type;
+            auto        is_link = false;
+            struct stat stats;
+
+            if (type == DT_UNKNOWN) {
+                nr_stats++;
+                if (::fstatat(fd, entry.name.c_str(), &stats, AT_SYMLINK_NOFOLLOW) == -1) {
+                    continue;
+                }
+                type = S_ISDIR(stats.st_mode) ? DT_DIR : S_ISREG(stats.st_mode) ? DT_REG : S_ISLNK(stats.st_mode) ? DT_LNK : DT_UNKNOWN;
+            }
+
+            // Symbolic links to files are followed, those to directories are not.
+            if (type == DT_LNK && matches(entry.name.c_str())) {
+                listing.links.push_back(entry.name);
+                is_link = true;
+                nr_stats++;
+                if (::fstatat(fd, entry.name.c_str(), &stats, 0) == -1) {
+                    continue;
+                }
+                type = S_ISREG(stats.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+
+            if (type == DT_DIR) {
+                listing.directories.push_back(entry.name);
+                auto subdirectory = directory / entry.name;
+                pool.submit(group, [this,&pool,&group,subdirectory,&on_file,&on_library]() {
+                    walk_directory(pool, group, subdirectory, false, on_file, on_library);
+                });
+
+            } else if (type == DT_REG && matches(entry.name.c_str())) {
+                if (!is_link) {
+                    listing.files.push_back(entry.name);
+                }
+                on_file(directory / entry.name);
+            }
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+}}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_DIRECTORYWALKER_H
+#define TAKEVOS_HURRICANE_DIRECTORYWALKER_H
+#include <stdbool.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "FileStat.h"
+#include "numbers.h"
+
+namespace fs = boost::filesystem;
+
+namespace takevos {
+namespace hurricane {
+
+class ThreadPool;
+class ThreadPoolGroup;
+
+/** Finds the source files in a directory tree, in parallel.
+ *
+ * Each directory is read by a task of the ThreadPool, which submits a task for
+ * each of its subdirectories; so large trees are spread over the workers by
+ * work stealing. The type of each entry is taken from the directory itself, as
+ * returned by getdents64 on Linux, so only symbolic links and entries of file
+ * systems that do not report a type are stat'ed.
+ *
+ * A directory which contains a library file is a nested library; it is reported
+ * instead of its files and is not descended into. Symbolic links to directories
+ * are not followed, so that a link can not create a cycle.
+ *
+ * With a cache file the relevant entries of each directory are stored after a
+ * walk. A directory whose metadata did not change since it was listed is not
+ * read again; only its own stat is needed to replay its files and subdirectories.
+ * Adding, removing or renaming an entry changes the modification time of the
+ * directory. The targets of symbolic links are not part of the directory, so
+ * these are stat'ed again on each walk.
+ */
+class DirectoryWalker {
+public:
+    std::atomic<size_t> nr_directories; ///< Number of directories read by the last walk().
+    std::atomic<size_t> nr_replayed;    ///< Number of directories replayed from the cache by the last walk().
+    std::atomic<size_t> nr_stats;       ///< Number of entries that were stat'ed by the last walk().
+
+    /** Create a walker.
+     * @param extensions        The extensions of the files to find, including the dot.
+     * @param library_filename  The name of the file that marks the directory of a library.
+     * @param cache_filename    The file with the listings of the directories of a walk, or empty to read every directory.
+     */
+    DirectoryWalker(std::vector<std::string> const &extensions, std::string const &library_filename, fs::path const &cache_filename = fs::path());
+
+    /** Find the files in a directory and its subdirectories.
+     * The callbacks are called concurrently from tasks of the ThreadPool, as soon
+     * as a file or library is found. Throws std::runtime_error when a directory
+     * can not be read.
+     *
+     * @param directory     The directory to walk, which is not itself checked for a library file.
+     * @param on_file       Called as on_file(fs::path const &path) for each file with one of the extensions.
+     * @param on_library    Called as on_library(fs::path const &directory) for each nested library.
+     */
+    void walk(fs::path const &directory, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library);
+
+private:
+    /** The relevant entries of a directory, as found by a walk.
+     */
+    struct Listing {
+        FileStat                    stat;       ///< The metadata of the directory before it was read.
+        int64_t                     listed_ns;  ///< The time the directory was read, see FileStat::now_ns().
+        bool                        is_library; ///< The directory contains the library file.
+        bool                        visited;    ///< The directory was found by the current walk.
+        std::vector<std::string>    files;      ///< Names of the files with one of the extensions.
+        std::vector<std::string>    links;      ///< Names of the symbolic links with one of the extensions.
+        std::vector<std::string>    directories; ///< Names of the subdirectories.
+    };
+
+    std::unordered_set<std::string> extensions;
+    std::string                     library_filename;
+    fs::path                        cache_filename;
+    std::mutex                      mutex;      ///< Protects listings and listings_changed during a walk.
+    std::unordered_map<std::string,Listing> listings; ///< The listing of each directory, by path.
+    bool                            listings_changed; ///< A directory was read by the current walk.
+
+    /** Key of the cache file, which depends on the root of the walk and on what is listed.
+     */
+    uint128_t cache_key(fs::path const &directory) const;
+
+    /** Load the listings from the cache file.
+     */
+    void load_listings(fs::path const &directory);
+
+    /** Save the listings found by a walk to the cache file.
+     */
+    void save_listings(fs::path const &directory);
+
+    /** Check if a filename has one of the extensions.
+     */
+    bool matches(char const *name) const;
+
+    /** Read or replay a directory, submitting a task for each subdirectory.
+     */
+    void walk_directory(ThreadPool &pool, ThreadPoolGroup &group, fs::path const &directory, bool is_root, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library);
+
+    /** Read a directory, submitting a task for each subdirectory.
+     * @param listing   Receives the relevant entries of the directory.
+     */
+    void read_directory(ThreadPool &pool, ThreadPoolGroup &group, fs::path const &directory, bool is_root, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library, Listing &listing);
+
+    /** Report the files of a directory from its listing, submitting a task for each subdirectory.
+     */
+    void replay_directory(ThreadPool &pool, ThreadPoolGroup &group, fs::path const &directory, std::function<void(fs::path const &)> const &on_file, std::function<void(fs::path const &)> const &on_library, Listing const &listing);
+};
+
+}}
+#endif
@@ -0,0 +1,140 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "DirectoryWalker.h"
+#include "ThreadPool.h"
+#include "utils.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+/** Write a tree of empty files: a number of top directories, each with subdirectories of 100 files.
+ * The modification times of the directories are moved to the past, as in a tree
+ * that was not changed since the previous walk.
+ */
+static void DirectoryWalker_bench_corpus(fs::path const &directory, size_t nr_files)
+{
+    auto past = time(NULL) - 10;
+    auto nr_subdirectories = (nr_files + 99) / 100;
+
+    for (size_t i = 0; i < nr_subdirectories; i++) {
+        auto subdirectory = directory / string_format("d%zu", i / 20) / string_format("e%zu", i % 20);
+
+        fs::create_directories(subdirectory);
+        for (size_t j = i * 100; j < std::min(nr_files, (i + 1) * 100); j++) {
+            write_to_file(subdirectory / string_format("file-%zu.vhd", j), "");
+        }
+        write_to_file(subdirectory / "README", "");
+    }
+
+    fs::last_write_time(directory, past);
+    for (fs::recursive_directory_iterator i(directory), end; i != end; ++i) {
+        if (fs::is_directory(i->symlink_status())) {
+            fs::last_write_time(i->path(), past);
+        }
+    }
+}
+
+/** Walk the tree and print the results as a JSON object.
+ * The best of a number of runs is reported, to reduce noise from the rest of the system.
+ *
+ * @param directory     The tree to walk.
+ * @param method        Name of the method.
+ * @param nr_runs       Number of runs.
+ * @param last          true for the last result, which is not followed by a comma.
+ * @param walker        The walker, which is used once before the runs to fill its cache.
+ */
+static void DirectoryWalker_bench_run(fs::path const &directory, char const *method, int nr_runs, bool last, DirectoryWalker &walker)
+{
+    double              best = 1e99;
+    std::atomic<size_t> nr_files(0);
+    auto                on_file = [&nr_files](fs::path const &) { nr_files++; };
+    auto                on_library = [](fs::path const &) {};
+
+    walker.walk(directory, on_file, on_library);
+    for (int run = 0; run < nr_runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+
+        nr_files = 0;
+        walker.walk(directory, on_file, on_library);
+
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    printf("    {\"method\": \"%s\", \"files\": %zu, \"seconds\": %.6f, \"directories_read\": %zu, \"directories_replayed\": %zu}%s\n",
+        method, (size_t)nr_files, best, (size_t)walker.nr_directories, (size_t)walker.nr_replayed,
+        last ? "" : ","
+    );
+}
+
+static void DirectoryWalker_bench_usage(void)
+{
+    fprintf(stderr, "Usage: DirectoryWalker_bench [-n <files>] [-j <jobs>] [-r <runs>]\n");
+    fprintf(stderr, "  -n <files>        Number of files, default 50000.\n");
+    fprintf(stderr, "  -j <jobs>         Number of jobs of the thread pool, default one per CPU.\n");
+    fprintf(stderr, "  -r <runs>         Number of runs of which the best is reported, default 5.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t  nr_files = 50000;
+    int     nr_runs = 5;
+    int     ch;
+
+    while ((ch = getopt(argc, argv, "hn:j:r:")) != -1) {
+        switch (ch) {
+        case 'n': nr_files = strtoul(optarg, NULL, 10); break;
+        case 'j': ThreadPool::shared_nr_jobs = strtoul(optarg, NULL, 10); break;
+        case 'r': nr_runs = std::max(1, atoi(optarg)); break;
+        default: DirectoryWalker_bench_usage(); return 2;
+        }
+    }
+
+    // The directories are in the dentry cache after they are written, so this measures the cost of the system calls.
+    auto directory = fs::temp_directory_path() / string_format("DirectoryWalker-bench-%i", (int)getpid());
+    auto cache_filename = fs::temp_directory_path() / string_format("DirectoryWalker-bench-%i.listing", (int)getpid());
+    DirectoryWalker_bench_corpus(directory, nr_files);
+
+    printf("{\"files\": %zu, \"jobs\": %zu, \"results\": [\n", nr_files, ThreadPool::shared().nr_jobs());
+
+    DirectoryWalker read_walker({".vhd", ".vhdl"}, "hurricane.ini");
+    DirectoryWalker_bench_run(directory, "read", nr_runs, false, read_walker);
+
+    DirectoryWalker cached_walker({".vhd", ".vhdl"}, "hurricane.ini", cache_filename);
+    DirectoryWalker_bench_run(directory, "cached", nr_runs, true, cached_walker);
+    printf("]}\n");
+
+    fs::remove_all(directory);
+    fs::remove(cache_filename);
+    return 0;
+}
@@ -0,0 +1,210 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE DirectoryWalker
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DirectoryWalker.h"
+#include "utils.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+struct DirectoryWalker_tests_fixture {
+    fs::path                    directory;
+    std::vector<std::string>    expected_files;
+    std::vector<std::string>    expected_libraries;
+
+    DirectoryWalker_tests_fixture() {
+        directory = string_format("/tmp/DirectoryWalker-tests-%i", (int)getpid());
+
+        // A tree that is deep and wide enough to be spread over several tasks.
+        for (int i = 0; i < 20; i++) {
+            auto subdirectory = directory / string_format("d%i", i) / string_format("e%i", i % 3);
+            fs::create_directories(subdirectory);
+            for (int j = 0; j < 10; j++) {
+                auto filename = subdirectory / string_format("f%i.vhd", j);
+                write_to_file(filename, "");
+                expected_files.push_back(filename.string());
+                write_to_file(subdirectory / string_format("f%i.txt", j), "");
+            }
+        }
+
+        write_to_file(directory / "hurricane.ini", "");
+        write_to_file(directory / "top.vhdl", "");
+        expected_files.push_back((directory / "top.vhdl").string());
+        write_to_file(directory / "vhd", "");
+        write_to_file(directory / ".vhd", "");
+
+        // The files of a nested library are not reported.
+        fs::create_directories(directory / "nested" / "sub");
+        write_to_file(directory / "nested" / "hurricane.ini", "");
+        write_to_file(directory / "nested" / "n.vhd", "");
+        write_to_file(directory / "nested" / "sub" / "s.vhd", "");
+        expected_libraries.push_back((directory / "nested").string());
+
+        // Links to files are followed, links to directories are not.
+        fs::create_symlink(directory / "top.vhdl", directory / "link.vhd");
+        expected_files.push_back((directory / "link.vhd").string());
+        fs::create_directory_symlink(directory / "d0", directory / "d0.vhd");
+        fs::create_directory_symlink(directory, directory / "d1" / "cycle");
+
+        std::sort(expected_files.begin(), expected_files.end());
+    }
+
+    ~DirectoryWalker_tests_fixture() {
+        fs::remove_all(directory);
+        fs::remove(cache_filename());
+    }
+
+    fs::path cache_filename(void) const {
+        return directory.string() + ".listing";
+    }
+
+    /** Move the modification time of the directories to the past, so that their listings can be trusted.
+     */
+    void age(void) const {
+        auto past = time(NULL) - 10;
+
+        fs::last_write_time(directory, past);
+        for (fs::recursive_directory_iterator i(directory), end; i != end; ++i) {
+            if (fs::is_directory(i->symlink_status())) {
+                fs::last_write_time(i->path(), past);
+            }
+        }
+    }
+
+    /** Walk the directory, returning the sorted files and libraries that were found.
+     */
+    std::pair<std::vector<std::string>,std::vector<std::string>> walk(DirectoryWalker &walker) const {
+        std::mutex                  mutex;
+        std::vector<std::string>    files;
+        std::vector<std::string>    libraries;
+
+        walker.walk(directory, [&](fs::path const &path) {
+            std::lock_guard<std::mutex> lock(mutex);
+            files.push_back(path.string());
+        }, [&](fs::path const &path) {
+            std::lock_guard<std::mutex> lock(mutex);
+            libraries.push_back(path.string());
+        });
+
+        std::sort(files.begin(), files.end());
+        return {files, libraries};
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(DirectoryWalker_tests, DirectoryWalker_tests_fixture)
+
+BOOST_AUTO_TEST_CASE(directory_walker_walk_1)
+{
+    DirectoryWalker             walker({".vhd", ".vhdl"}, "hurricane.ini");
+    std::mutex                  mutex;
+    std::vector<std::string>    files;
+    std::vector<std::string>    libraries;
+
+    walker.walk(directory, [&](fs::path const &path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        files.push_back(path.string());
+    }, [&](fs::path const &path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        libraries.push_back(path.string());
+    });
+
+    std::sort(files.begin(), files.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(files.begin(), files.end(), expected_files.begin(), expected_files.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(libraries.begin(), libraries.end(), expected_libraries.begin(), expected_libraries.end());
+
+    // Only the links with a matching extension are stat'ed, the other types are known from the directory.
+    BOOST_CHECK_EQUAL(walker.nr_directories, 1 + 20 + 20 + 1);
+    BOOST_CHECK_LE(walker.nr_stats, 2);
+}
+
+BOOST_AUTO_TEST_CASE(directory_walker_cache_1)
+{
+    DirectoryWalker walker({".vhd", ".vhdl"}, "hurricane.ini", cache_filename());
+
+    age();
+    auto read = walk(walker);
+    BOOST_CHECK(read.first == expected_files);
+    BOOST_CHECK(read.second == expected_libraries);
+    BOOST_CHECK_EQUAL(walker.nr_directories, 1 + 20 + 20 + 1);
+    BOOST_CHECK_EQUAL(walker.nr_replayed, 0);
+    BOOST_CHECK(fs::exists(cache_filename()));
+
+    // Only the stat of each directory and of the links is needed.
+    auto replayed = walk(walker);
+    BOOST_CHECK(replayed.first == expected_files);
+    BOOST_CHECK(replayed.second == expected_libraries);
+    BOOST_CHECK_EQUAL(walker.nr_directories, 0);
+    BOOST_CHECK_EQUAL(walker.nr_replayed, 1 + 20 + 20 + 1);
+
+    // A new file changes the modification time of its directory.
+    write_to_file(directory / "d3" / "e0" / "new.vhd", "");
+    expected_files.push_back((directory / "d3" / "e0" / "new.vhd").string());
+    std::sort(expected_files.begin(), expected_files.end());
+
+    DirectoryWalker other_walker({".vhd", ".vhdl"}, "hurricane.ini", cache_filename());
+    auto changed = walk(other_walker);
+    BOOST_CHECK(changed.first == expected_files);
+    BOOST_CHECK_EQUAL(other_walker.nr_directories, 1);
+    BOOST_CHECK_EQUAL(other_walker.nr_replayed, 1 + 20 + 20);
+
+    // Recently modified directories are read on each walk, as they may change again without a change in their metadata.
+    fs::remove_all(directory / "d4");
+    auto removed = walk(other_walker);
+    BOOST_CHECK_EQUAL(removed.first.size(), expected_files.size() - 10);
+    BOOST_CHECK_EQUAL(other_walker.nr_directories, 2);
+    BOOST_CHECK_EQUAL(walk(other_walker).first.size(), expected_files.size() - 10);
+    BOOST_CHECK_EQUAL(other_walker.nr_directories, 2);
+}
+
+BOOST_AUTO_TEST_CASE(directory_walker_cache_2)
+{
+    // A cache for other extensions is not used.
+    DirectoryWalker walker({".vhd", ".vhdl"}, "hurricane.ini", cache_filename());
+    DirectoryWalker other_walker({".vhd"}, "hurricane.ini", cache_filename());
+
+    age();
+    walk(walker);
+    auto files = walk(other_walker).first;
+    BOOST_CHECK_EQUAL(files.size(), expected_files.size() - 1);
+    BOOST_CHECK_EQUAL(other_walker.nr_replayed, 0);
+}
+
+BOOST_AUTO_TEST_CASE(directory_walker_error_1)
+{
+    DirectoryWalker walker({".vhd"}, "hurricane.ini");
+
+    BOOST_CHECK_THROW(walker.walk(directory / "missing", [](fs::path const &) {}, [](fs::path const &) {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,8 +23,12 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <exception>
+#include <algorithm>
+#include <vector>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -34,13 +38,38 @@
 namespace takevos {
 namespace hurricane {
 
-FileHandle::FileHandle(const fs::path &filename) : filename(filename), fd(-1), data(NULL), data_size(0)
+/** Number of buffers kept in the pool of each thread.
+ */
+static const size_t FileHandle_pool_size = 4;
+
+/** Buffers are aligned to, and a multiple of, the page size.
+ */
+static const size_t FileHandle_page_size = 4096;
+
+const size_t FileHandle::default_mmap_threshold;
+size_t FileHandle::mmap_threshold = FileHandle::default_mmap_threshold;
+
+/** Buffers of closed files, to be reused by the next file that is read by the same thread.
+ */
+struct FileHandlePool {
+    std::vector<std::pair<char *,size_t>>   buffers;    ///< Each buffer with its capacity.
+
+    ~FileHandlePool() {
+        for (auto &buffer: buffers) {
+            free(buffer.first);
+        }
+    }
+};
+
+static thread_local FileHandlePool FileHandle_pool;
+
+FileHandle::FileHandle(const fs::path &filename) : filename(filename), fd(-1), data(NULL), data_size(0), buffer(NULL), buffer_capacity(0)
 {
 }
 
 FileHandle::~FileHandle()
 {
-    assert(fd == -1 && data == NULL && data_size == 0);
+    assert(fd == -1 && data == NULL && data_size == 0 && buffer == NULL);
 }
 
 void FileHandle::open(void)
@@ -55,18 +84,113 @@ void FileHandle::open(void)
         close();
         throw std::runtime_error("Cannot stat file '" + filename.string() + "'.");
     }
+    if ((uintmax_t)stats.st_size > SIZE_MAX) {
+        close();
+        throw std::runtime_error("File '" + filename.string() + "' is too large to map.");
+    }
     data_size = stats.st_size;
 
-    if ((data = (const char *)::mmap(NULL, data_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    // An empty file can not be mapped.
+    if (data_size < mmap_threshold || data_size == 0) {
+        read_file();
+    } else {
+        map_file();
+    }
+}
+
+void FileHandle::read_file(void)
+{
+    auto &pool = FileHandle_pool.buffers;
+
+    for (auto i = pool.begin(); i != pool.end(); i++) {
+        if (i->second >= data_size) {
+            buffer = i->first;
+            buffer_capacity = i->second;
+            pool.erase(i);
+            break;
+        }
+    }
+
+    if (buffer == NULL) {
+        auto capacity = std::max(data_size, (size_t)1);
+        capacity = ((capacity + FileHandle_page_size - 1) / FileHandle_page_size) * FileHandle_page_size;
+
+        void *p;
+        if (posix_memalign(&p, FileHandle_page_size, capacity) != 0) {
+            close();
+            throw std::runtime_error("Cannot allocate a buffer for file '" + filename.string() + "'.");
+        }
+        buffer = (char *)p;
+        buffer_capacity = capacity;
+    }
+
+    size_t offset = 0;
+    while (offset < data_size) {
+        auto r = ::pread(fd, &buffer[offset], data_size - offset, offset);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close();
+            throw std::runtime_error("Cannot read file '" + filename.string() + "'.");
+        }
+        if (r == 0) {
+            // The file was truncated after it was stat'ed.
+            break;
+        }
+        offset += r;
+    }
+
+    data = buffer;
+    data_size = offset;
+}
+
+void FileHandle::map_file(void)
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+    // Increases the readahead of the kernel, also while populating the mapping.
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    int flags = MAP_FILE | MAP_SHARED;
+#ifdef MAP_POPULATE
+    // Map every page up front, instead of taking a page fault for each few pages.
+    flags |= MAP_POPULATE;
+#endif
+
+    if ((data = (const char *)::mmap(NULL, data_size, PROT_READ, flags, fd, 0)) == MAP_FAILED) {
         data = NULL; // This is different from MAP_FAILED.
         close();
         throw std::runtime_error("Cannot map file '" + filename.string() + "'.");
     }
+
+    // The advice is only a hint, errors are ignored. The values of the advice
+    // are enumerated, not flags, so each is given separately.
+    ::madvise((void *)data, data_size, MADV_SEQUENTIAL);
+#ifndef MAP_POPULATE
+    ::madvise((void *)data, data_size, MADV_WILLNEED);
+#endif
+#ifdef MADV_HUGEPAGE
+    ::madvise((void *)data, data_size, MADV_HUGEPAGE);
+#endif
 }
 
 void FileHandle::close(void)
 {
-    if (data != NULL) {
+    if (buffer != NULL) {
+        auto &pool = FileHandle_pool.buffers;
+
+        if (pool.size() < FileHandle_pool_size) {
+            pool.emplace_back(buffer, buffer_capacity);
+        } else {
+            free(buffer);
+        }
+        buffer = NULL;
+        buffer_capacity = 0;
+        data = NULL;
+        data_size = 0;
+
+    } else if (data != NULL) {
         if (::munmap((void *)data, data_size) != 0) {
             throw std::runtime_error("Cannot unmap file '" + filename.string() + "'.");
         }
@@ -33,16 +33,38 @@ namespace fs = boost::filesystem;
 namespace takevos {
 namespace hurricane {
 
+/** The contents of a file, in memory.
+ *
+ * Small files are read into a buffer, which is taken from a pool of the thread
+ * and returned to it on close(); for those mapping the file costs more in system
+ * calls and page faults than copying it. Larger files are mapped, and the kernel
+ * is told that they will be read sequentially.
+ */
 struct FileHandle {
+    /** The default of mmap_threshold.
+     */
+    static const size_t default_mmap_threshold = 256 * 1024;
+
+    /** Files of at least this size are mapped, smaller files are read into a buffer.
+     * Set from Options::mmap_threshold.
+     */
+    static size_t mmap_threshold;
+
     fs::path    filename;
     int         fd;
     const char  *data;
     size_t      data_size;
+    char        *buffer;            ///< The buffer the file was read into, or NULL when the file is mapped.
+    size_t      buffer_capacity;    ///< The size of the buffer.
 
     FileHandle(const fs::path &filename);
     ~FileHandle();
     void open(void);
     void close(void);
+
+private:
+    void read_file(void);
+    void map_file(void);
 };
 
 }}
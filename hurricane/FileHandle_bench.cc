@@ -0,0 +1,168 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "FileHandle.h"
+#include "utils.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+/** A set of files written to a temporary directory.
+ */
+struct Corpus {
+    std::string             name;
+    std::vector<fs::path>   filenames;
+    size_t                  size;
+};
+
+/** Write files of a given size with lines of text.
+ * std::minstd_rand is fully specified by the standard, so every platform
+ * generates the same files.
+ */
+static Corpus FileHandle_bench_corpus(fs::path const &directory, char const *name, size_t nr_files, size_t file_size)
+{
+    std::minstd_rand    random(1);
+    Corpus              corpus;
+
+    corpus.name = name;
+    corpus.size = 0;
+    for (size_t i = 0; i < nr_files; i++) {
+        std::string text;
+        while (text.size() < file_size) {
+            text += "    s" + std::to_string(random() % 1000) + " <= a and b;\n";
+        }
+        text.resize(file_size);
+
+        auto filename = directory / string_format("%s-%zu.vhd", name, i);
+        write_to_file(filename, text);
+        corpus.filenames.push_back(filename);
+        corpus.size += text.size();
+    }
+    return corpus;
+}
+
+/** Open every file of a corpus with a threshold and print the results as a JSON object.
+ * Every byte of each file is examined, as the tokenizer would.
+ * The best of a number of runs is reported, to reduce noise from the rest of the system.
+ *
+ * @param corpus            The files to open.
+ * @param method            Name of the strategy.
+ * @param mmap_threshold    Value of FileHandle::mmap_threshold.
+ * @param nr_runs           Number of runs.
+ * @param last              true for the last result, which is not followed by a comma.
+ */
+static void FileHandle_bench_run(Corpus const &corpus, char const *method, size_t mmap_threshold, int nr_runs, bool last)
+{
+    double  best = 1e99;
+    size_t  nr_lines = 0;
+
+    FileHandle::mmap_threshold = mmap_threshold;
+    for (int run = 0; run < nr_runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+
+        nr_lines = 0;
+        for (auto const &filename: corpus.filenames) {
+            FileHandle handle(filename);
+
+            handle.open();
+            auto end = handle.data + handle.data_size;
+            for (auto p = handle.data; (p = (char const *)memchr(p, '\n', end - p)) != NULL; p++) {
+                nr_lines++;
+            }
+            handle.close();
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    printf("        {\"method\": \"%s\", \"lines\": %zu, \"seconds\": %.6f, \"mb_per_s\": %.1f, \"files_per_s\": %.0f}%s\n",
+        method, nr_lines, best,
+        corpus.size / best / 1e6,
+        corpus.filenames.size() / best,
+        last ? "" : ","
+    );
+}
+
+static void FileHandle_bench_corpus(Corpus const &corpus, int nr_runs, bool last)
+{
+    printf("    {\"corpus\": \"%s\", \"files\": %zu, \"bytes\": %zu, \"results\": [\n", corpus.name.c_str(), corpus.filenames.size(), corpus.size);
+
+    FileHandle_bench_run(corpus, "read", SIZE_MAX, nr_runs, false);
+    FileHandle_bench_run(corpus, "mmap", 0, nr_runs, false);
+    FileHandle_bench_run(corpus, "adaptive", FileHandle::default_mmap_threshold, nr_runs, true);
+
+    printf("    ]}%s\n", last ? "" : ",");
+}
+
+static void FileHandle_bench_usage(void)
+{
+    fprintf(stderr, "Usage: FileHandle_bench [-s <megabytes>] [-r <runs>]\n");
+    fprintf(stderr, "  -s <megabytes>    Size of each corpus, default 64.\n");
+    fprintf(stderr, "  -r <runs>         Number of runs of which the best is reported, default 5.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t  size = 64;
+    int     nr_runs = 5;
+    int     ch;
+
+    while ((ch = getopt(argc, argv, "hs:r:")) != -1) {
+        switch (ch) {
+        case 's': size = strtoul(optarg, NULL, 10); break;
+        case 'r': nr_runs = std::max(1, atoi(optarg)); break;
+        default: FileHandle_bench_usage(); return 2;
+        }
+    }
+    size *= 1024 * 1024;
+
+    // The files are in the page cache after they are written, so only the cost of getting them into memory is measured.
+    auto directory = fs::temp_directory_path() / string_format("FileHandle-bench-%i", (int)getpid());
+    fs::create_directories(directory);
+
+    static size_t const small_sizes[] = {4 * 1024, 20 * 1024};
+
+    printf("{\"corpora\": [\n");
+    for (auto small_size: small_sizes) {
+        auto name = string_format("small_files_%zuk", small_size / 1024);
+        FileHandle_bench_corpus(FileHandle_bench_corpus(directory, name.c_str(), size / small_size, small_size), nr_runs, false);
+    }
+    FileHandle_bench_corpus(FileHandle_bench_corpus(directory, "medium_files", size / (1024 * 1024), 1024 * 1024), nr_runs, false);
+    FileHandle_bench_corpus(FileHandle_bench_corpus(directory, "huge_file", 1, size), nr_runs, true);
+    printf("]}\n");
+
+    fs::remove_all(directory);
+    return 0;
+}
@@ -57,3 +57,52 @@ BOOST_AUTO_TEST_CASE(filehandle_test_1)
     }
 }
 
+
+BOOST_AUTO_TEST_CASE(filehandle_test_2)
+{
+    auto            mmap_threshold = FileHandle::mmap_threshold;
+    auto            filename = fs::path(string_format("/tmp/test-%i.txt", (int)getpid()));
+    std::string     text;
+
+    for (int i = 0; text.size() < 100000; i++) {
+        text += string_format("line %i\n", i);
+    }
+    write_to_file(filename, text);
+
+    // The same contents when read and when mapped.
+    for (auto threshold: {text.size() + 1, text.size(), (size_t)0}) {
+        FileHandle::mmap_threshold = threshold;
+        FileHandle handle(filename);
+
+        handle.open();
+        BOOST_CHECK_EQUAL(handle.buffer != NULL, threshold > text.size());
+        BOOST_CHECK_EQUAL(handle.data_size, text.length());
+        BOOST_CHECK(std::string(handle.data, handle.data_size) == text);
+        handle.close();
+        BOOST_CHECK(handle.data == NULL);
+        BOOST_CHECK(handle.buffer == NULL);
+    }
+
+    // The buffer of a closed file is reused.
+    FileHandle::mmap_threshold = FileHandle::default_mmap_threshold;
+    FileHandle first(filename);
+    first.open();
+    auto buffer = first.buffer;
+    first.close();
+
+    FileHandle second(filename);
+    second.open();
+    BOOST_CHECK(second.buffer == buffer);
+    second.close();
+
+    // An empty file is never mapped.
+    write_to_file(filename, "");
+    FileHandle::mmap_threshold = 0;
+    FileHandle empty(filename);
+    empty.open();
+    BOOST_CHECK_EQUAL(empty.data_size, 0);
+    empty.close();
+
+    FileHandle::mmap_threshold = mmap_threshold;
+    fs::remove(filename);
+}
@@ -0,0 +1,592 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "FileLoader.h"
+#include "ThreadPool.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HURRICANE_FILELOADER_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+namespace takevos {
+namespace hurricane {
+
+const int FileLoader::best_loader;
+const int FileLoader::uring_loader;
+const int FileLoader::pread_loader;
+
+/** Number of files that are read at the same time with io_uring.
+ */
+static const size_t FileLoader_queue_depth = 256;
+
+/** A single read is never larger than this, Linux reads at most about 2 GB at a time.
+ */
+static const size_t FileLoader_max_read_size = 1 << 30;
+
+FileLoader::FileLoader(int loader) :
+    loader(loader), nr_syscalls(0)
+{
+    if (loader == best_loader) {
+        this->loader = uring_supported() ? uring_loader : pread_loader;
+
+    } else if (loader == uring_loader && !uring_supported()) {
+        throw std::runtime_error("io_uring is not supported by this kernel.");
+
+    } else if (loader != uring_loader && loader != pread_loader) {
+        throw std::runtime_error("Unknown file loader.");
+    }
+}
+
+char const *FileLoader::name(int loader)
+{
+    switch (loader) {
+    case best_loader: return "best";
+    case uring_loader: return "uring";
+    case pread_loader: return "pread";
+    default: return "unknown";
+    }
+}
+
+int FileLoader::loader_by_name(char const *name)
+{
+    for (auto loader: {best_loader, uring_loader, pread_loader}) {
+        if (strcmp(name, FileLoader::name(loader)) == 0) {
+            return loader;
+        }
+    }
+    return -1;
+}
+
+void FileLoader::load(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f)
+{
+    nr_syscalls = 0;
+    if (loader == uring_loader) {
+        load_uring(filenames, f);
+    } else {
+        load_pread(filenames, f);
+    }
+}
+
+void FileLoader::load_pread(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f)
+{
+    auto &pool = ThreadPool::shared();
+
+    pool.parallel_for(filenames.size(), [this,&filenames,&f](size_t i) {
+        auto        &filename = filenames[i];
+        struct stat stats;
+        int         fd;
+
+        nr_syscalls++;
+        if ((fd = ::open(filename.string().c_str(), O_RDONLY | O_CLOEXEC, 0)) == -1) {
+            throw std::runtime_error("Cannot open file '" + filename.string() + "'.");
+        }
+
+        nr_syscalls++;
+        if (::fstat(fd, &stats) == -1) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat file '" + filename.string() + "'.");
+        }
+
+        std::unique_ptr<char, decltype(&free)> data((char *)malloc(std::max((size_t)stats.st_size, (size_t)1)), &free);
+        size_t offset = 0;
+        while (data && offset < (size_t)stats.st_size) {
+            nr_syscalls++;
+            auto r = ::pread(fd, data.get() + offset, std::min(stats.st_size - offset, FileLoader_max_read_size), offset);
+            if (r == -1 && errno == EINTR) {
+                continue;
+            }
+            if (r == -1) {
+                ::close(fd);
+                throw std::runtime_error("Cannot read file '" + filename.string() + "'.");
+            }
+            if (r == 0) {
+                // The file was truncated after it was stat'ed.
+                break;
+            }
+            offset += r;
+        }
+
+        nr_syscalls++;
+        ::close(fd);
+        if (!data) {
+            throw std::runtime_error("Cannot allocate a buffer for file '" + filename.string() + "'.");
+        }
+
+        f(i, data.get(), offset);
+    });
+}
+
+#ifdef HURRICANE_FILELOADER_URING
+
+/** Pass the contents of a file to a task, which frees it afterwards.
+ */
+static void FileLoader_dispatch(ThreadPool &pool, ThreadPoolGroup &group, std::function<void(size_t, char const *, size_t)> const &f, size_t i, char *data, size_t data_size, std::atomic<size_t> &nr_buffered)
+{
+    pool.submit(group, [&f,i,data,data_size,&nr_buffered]() {
+        std::unique_ptr<char, decltype(&free)> owner(data, &free);
+
+        nr_buffered--;
+        f(i, data, data_size);
+    });
+}
+
+/** The submission and completion queues of io_uring, shared with the kernel.
+ */
+class FileLoaderRing {
+public:
+    int                 fd;
+    io_uring_params     params;
+
+    FileLoaderRing(unsigned nr_entries) :
+        fd(-1), sq_ring(MAP_FAILED), cq_ring(MAP_FAILED), sqes((io_uring_sqe *)MAP_FAILED), sq_ring_size(0), cq_ring_size(0), nr_unsubmitted(0)
+    {
+        memset(&params, 0, sizeof (params));
+        if ((fd = syscall(__NR_io_uring_setup, nr_entries, &params)) == -1) {
+            throw std::runtime_error("Cannot setup io_uring.");
+        }
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+
+        sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cq_ring = sq_ring;
+        } else {
+            cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        }
+        sqes = (io_uring_sqe *)mmap(NULL, params.sq_entries * sizeof (io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+            unmap();
+            throw std::runtime_error("Cannot map io_uring.");
+        }
+    }
+
+    ~FileLoaderRing() {
+        unmap();
+    }
+
+    /** A cleared submission queue entry, which is submitted by the next enter().
+     * There must be room in the submission queue.
+     */
+    io_uring_sqe &sqe(void) {
+        auto &tail = *sq(params.sq_off.tail);
+        auto index = tail & *sq(params.sq_off.ring_mask);
+        auto &sqe = sqes[index];
+
+        memset(&sqe, 0, sizeof (sqe));
+        sq(params.sq_off.array)[index] = index;
+        __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+        nr_unsubmitted++;
+        return sqe;
+    }
+
+    /** Submit the new entries, and wait for a number of completions.
+     * @return false when the call was interrupted and should be repeated.
+     */
+    bool enter(unsigned min_complete) {
+        auto r = syscall(__NR_io_uring_enter, fd, nr_unsubmitted, min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (r == -1) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                return false;
+            }
+            throw std::runtime_error("Cannot submit to io_uring.");
+        }
+        nr_unsubmitted -= r;
+        return true;
+    }
+
+    /** Pass each completion to a handler.
+     * @param f     Called as f(io_uring_cqe const &cqe).
+     * @return The number of completions.
+     */
+    template <typename F>
+    size_t reap(F &&f) {
+        auto &head = *cq(params.cq_off.head);
+        auto tail = __atomic_load_n(cq(params.cq_off.tail), __ATOMIC_ACQUIRE);
+        auto mask = *cq(params.cq_off.ring_mask);
+        auto cqes = (io_uring_cqe *)((char *)cq_ring + params.cq_off.cqes);
+        size_t r = 0;
+
+        for (auto i = head; i != tail; i++, r++) {
+            auto cqe = cqes[i & mask];
+
+            // Release the entry first, the handler may add submissions which complete into it.
+            __atomic_store_n(&head, i + 1, __ATOMIC_RELEASE);
+            f(cqe);
+        }
+        return r;
+    }
+
+    unsigned nr_unsubmitted_entries(void) const {
+        return nr_unsubmitted;
+    }
+
+private:
+    void                *sq_ring;
+    void                *cq_ring;
+    io_uring_sqe        *sqes;
+    size_t              sq_ring_size;
+    size_t              cq_ring_size;
+    unsigned            nr_unsubmitted;  ///< Number of entries that were added but not submitted yet.
+
+    unsigned *sq(unsigned offset) const {
+        return (unsigned *)((char *)sq_ring + offset);
+    }
+
+    unsigned *cq(unsigned offset) const {
+        return (unsigned *)((char *)cq_ring + offset);
+    }
+
+    void unmap(void) {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, params.sq_entries * sizeof (io_uring_sqe));
+        }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+            munmap(cq_ring, cq_ring_size);
+        }
+        if (sq_ring != MAP_FAILED) {
+            munmap(sq_ring, sq_ring_size);
+        }
+        if (fd != -1) {
+            ::close(fd);
+        }
+        sq_ring = cq_ring = MAP_FAILED;
+        sqes = (io_uring_sqe *)MAP_FAILED;
+        fd = -1;
+    }
+};
+
+/** The operations in the user_data of an entry, the slot is in the upper bits.
+ */
+static const uint64_t FileLoader_open   = 0;
+static const uint64_t FileLoader_statx  = 1;
+static const uint64_t FileLoader_read   = 2;
+static const uint64_t FileLoader_close  = 3;
+
+/** A file that is being read.
+ */
+struct FileLoaderSlot {
+    size_t          index;          ///< Index of the file.
+    std::string     path;           ///< The path, which must stay valid until the open and statx complete.
+    int             fd;             ///< The file descriptor, -1 when not open.
+    struct statx    stats;          ///< Written by the statx operation.
+    int             nr_pending;     ///< Number of the open and statx operations that did not complete.
+    char const      *error;         ///< The operation that failed, or NULL.
+    char            *data;          ///< The contents of the file, until they are passed to a task.
+    size_t          data_size;      ///< The size of the file, as found by statx.
+    size_t          offset;         ///< Number of bytes read.
+};
+
+bool FileLoader::uring_supported(void)
+{
+    static const bool supported = []() {
+        try {
+            FileLoaderRing ring(1);
+
+            auto size = sizeof (io_uring_probe) + 256 * sizeof (io_uring_probe_op);
+            std::unique_ptr<io_uring_probe, decltype(&free)> probe((io_uring_probe *)calloc(1, size), &free);
+            if (!probe || syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe.get(), 256) == -1) {
+                return false;
+            }
+
+            for (auto op: {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE}) {
+                if (op >= probe->ops_len || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                    return false;
+                }
+            }
+            return true;
+
+        } catch (std::runtime_error &) {
+            return false;
+        }
+    }();
+
+    return supported;
+}
+
+void FileLoader::load_uring(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f)
+{
+    auto                        &pool = ThreadPool::shared();
+    ThreadPoolGroup             group;
+    std::atomic<size_t>         nr_buffered(0);
+    std::exception_ptr          exception;
+    std::vector<FileLoaderSlot> slots(FileLoader_queue_depth);
+    std::vector<size_t>         free_slots;
+    size_t                      next = 0;
+    size_t                      nr_in_flight = 0;
+
+    // Each slot has at most two operations in flight, the completion queue is twice as large.
+    FileLoaderRing ring(2 * FileLoader_queue_depth);
+    nr_syscalls++;
+
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i].fd = -1;
+        slots[i].data = NULL;
+        free_slots.push_back(slots.size() - 1 - i);
+    }
+
+    auto submit = [&ring,&nr_in_flight](uint64_t slot, uint64_t operation) -> io_uring_sqe & {
+        auto &sqe = ring.sqe();
+        sqe.user_data = (slot << 2) | operation;
+        nr_in_flight++;
+        return sqe;
+    };
+
+    auto submit_read = [&](size_t s) {
+        auto &slot = slots[s];
+        auto &sqe = submit(s, FileLoader_read);
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = slot.fd;
+        sqe.addr = (uintptr_t)(slot.data + slot.offset);
+        sqe.len = std::min(slot.data_size - slot.offset, FileLoader_max_read_size);
+        sqe.off = slot.offset;
+    };
+
+    auto submit_close = [&](size_t s) {
+        auto &sqe = submit(s, FileLoader_close);
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = slots[s].fd;
+        slots[s].fd = -1;
+    };
+
+    // The file is closed after a failure, the error is reported when the close completes.
+    auto fail = [&](size_t s, char const *error) {
+        auto &slot = slots[s];
+
+        slot.error = error;
+        free(slot.data);
+        slot.data = NULL;
+        if (slot.fd != -1) {
+            submit_close(s);
+        } else {
+            if (!exception) {
+                exception = std::make_exception_ptr(std::runtime_error(std::string("Cannot ") + error + " file '" + slot.path + "'."));
+            }
+            free_slots.push_back(s);
+        }
+    };
+
+    auto finish = [&](size_t s) {
+        auto &slot = slots[s];
+
+        nr_buffered++;
+        FileLoader_dispatch(pool, group, f, slot.index, slot.data, slot.offset, nr_buffered);
+        slot.data = NULL;
+        submit_close(s);
+    };
+
+    auto complete = [&](io_uring_cqe const &cqe) {
+        auto s = cqe.user_data >> 2;
+        auto &slot = slots[s];
+
+        nr_in_flight--;
+        switch (cqe.user_data & 3) {
+        case FileLoader_open:
+        case FileLoader_statx:
+            if ((cqe.user_data & 3) == FileLoader_open) {
+                if (cqe.res >= 0) {
+                    slot.fd = cqe.res;
+                } else if (!slot.error) {
+                    slot.error = "open";
+                }
+            } else if (cqe.res < 0 && !slot.error) {
+                slot.error = "stat";
+            }
+
+            if (--slot.nr_pending > 0) {
+                break;
+            }
+            if (slot.error) {
+                fail(s, slot.error);
+                break;
+            }
+
+            slot.data_size = slot.stats.stx_size;
+            slot.offset = 0;
+            if ((slot.data = (char *)malloc(std::max(slot.data_size, (size_t)1))) == NULL) {
+                fail(s, "allocate a buffer for");
+            } else if (slot.data_size == 0) {
+                finish(s);
+            } else {
+                submit_read(s);
+            }
+            break;
+
+        case FileLoader_read:
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                submit_read(s);
+            } else if (cqe.res < 0) {
+                fail(s, "read");
+            } else if (cqe.res == 0) {
+                // The file was truncated after it was stat'ed.
+                finish(s);
+            } else if ((slot.offset += cqe.res) < slot.data_size) {
+                submit_read(s);
+            } else {
+                finish(s);
+            }
+            break;
+
+        case FileLoader_close:
+            if (slot.error && !exception) {
+                exception = std::make_exception_ptr(std::runtime_error(std::string("Cannot ") + slot.error + " file '" + slot.path + "'."));
+            }
+            free_slots.push_back(s);
+            break;
+        }
+    };
+
+    try {
+        while (true) {
+            // Limit the number of files that are read but not yet handled by a task.
+            while (next < filenames.size() && !free_slots.empty() && nr_buffered < FileLoader_queue_depth) {
+                auto s = free_slots.back();
+                auto &slot = slots[s];
+                free_slots.pop_back();
+
+                slot.index = next;
+                slot.path = filenames[next++].string();
+                slot.fd = -1;
+                slot.nr_pending = 2;
+                slot.error = NULL;
+                slot.data = NULL;
+
+                auto &open = submit(s, FileLoader_open);
+                open.opcode = IORING_OP_OPENAT;
+                open.fd = AT_FDCWD;
+                open.addr = (uintptr_t)slot.path.c_str();
+                open.open_flags = O_RDONLY | O_CLOEXEC;
+
+                auto &stat = submit(s, FileLoader_statx);
+                stat.opcode = IORING_OP_STATX;
+                stat.fd = AT_FDCWD;
+                stat.addr = (uintptr_t)slot.path.c_str();
+                stat.len = STATX_SIZE;
+                stat.off = (uintptr_t)&slot.stats;
+            }
+
+            if (free_slots.size() == slots.size()) {
+                if (next == filenames.size()) {
+                    break;
+                }
+                // Too many files are waiting for a task.
+                if (!pool.execute_one()) {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+
+            if (ring.reap(complete) > 0) {
+                continue;
+            }
+
+            // Handle a file while waiting, unless there are operations to submit.
+            if (ring.nr_unsubmitted_entries() == 0 && pool.execute_one()) {
+                continue;
+            }
+
+            nr_syscalls++;
+            ring.enter(1);
+        }
+    } catch (...) {
+        if (!exception) {
+            exception = std::current_exception();
+        }
+
+        // The kernel writes into the slots and buffers until each operation completes.
+        while (nr_in_flight > 0) {
+            auto nr_completed = ring.reap([&](io_uring_cqe const &cqe) {
+                auto &slot = slots[cqe.user_data >> 2];
+
+                nr_in_flight--;
+                if ((cqe.user_data & 3) == FileLoader_open && cqe.res >= 0) {
+                    slot.fd = cqe.res;
+                }
+            });
+            if (nr_completed > 0) {
+                continue;
+            }
+
+            try {
+                nr_syscalls++;
+                ring.enter(1);
+            } catch (std::runtime_error &) {
+                fprintf(stderr, "ERROR waiting for the operations of io_uring to complete.\n");
+                abort();
+            }
+        }
+
+        for (auto &slot: slots) {
+            free(slot.data);
+            slot.data = NULL;
+            if (slot.fd != -1) {
+                ::close(slot.fd);
+                slot.fd = -1;
+            }
+        }
+    }
+
+    // Wait for the tasks, which use the state of this function.
+
+    pool.wait(group);
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+#else
+
+bool FileLoader::uring_supported(void)
+{
+    return false;
+}
+
+void FileLoader::load_uring(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f)
+{
+    load_pread(filenames, f);
+}
+
+#endif
+
+}}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_FILELOADER_H
+#define TAKEVOS_HURRICANE_FILELOADER_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace takevos {
+namespace hurricane {
+
+/** Reads the contents of many files at once.
+ *
+ * Reading a file one at a time takes an open, stat, read and close system
+ * call, each waiting for the previous one; on a network file system the
+ * latency of each call dominates. With io_uring the opens, stats, reads and
+ * closes of hundreds of files are submitted together and complete in any
+ * order, with about one system call for each round of completions. When
+ * io_uring is not available the files are read with pread() by tasks of the
+ * ThreadPool instead.
+ *
+ * Each file is passed to a task of the ThreadPool as soon as it is read, so
+ * that it is hashed and tokenized while other files are still being read.
+ */
+class FileLoader {
+public:
+    static const int best_loader    = 0;    ///< io_uring when the kernel supports it, otherwise pread.
+    static const int uring_loader   = 1;    ///< Submit batches of operations through io_uring.
+    static const int pread_loader   = 2;    ///< open, fstat, pread and close by tasks of the ThreadPool.
+
+    int                 loader;         ///< uring_loader or pread_loader.
+    std::atomic<size_t> nr_syscalls;    ///< Number of system calls made by the last load().
+
+    /** Create a loader.
+     * @param loader    One of best_loader, uring_loader or pread_loader; uring_loader must be supported.
+     */
+    FileLoader(int loader = best_loader);
+
+    /** Check if io_uring, with every operation that is needed, is supported by the kernel.
+     */
+    static bool uring_supported(void);
+
+    /** The name of a loader, as used on the command line.
+     */
+    static char const *name(int loader);
+
+    /** The loader with a name, as used on the command line.
+     * @return The loader, or -1 when the name is unknown.
+     */
+    static int loader_by_name(char const *name);
+
+    /** Read files and pass each to a task of the ThreadPool.
+     * Throws std::runtime_error when a file could not be read, or rethrows the
+     * first exception of f, after the other files have been handled; with either
+     * loader every file that can be read is passed to f.
+     *
+     * @param filenames     The files to read.
+     * @param f             Called as f(size_t i, char const *data, size_t data_size) with the
+     *                      contents of filenames[i]; the data is freed when f returns.
+     */
+    void load(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f);
+
+private:
+    void load_uring(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f);
+    void load_pread(std::vector<fs::path> const &filenames, std::function<void(size_t, char const *, size_t)> const &f);
+};
+
+}}
+#endif
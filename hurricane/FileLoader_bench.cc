@@ -0,0 +1,178 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "FileLoader.h"
+#include "FileHandle.h"
+#include "ThreadPool.h"
+#include "utils.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+/** Write files of a given size with lines of text.
+ * std::minstd_rand is fully specified by the standard, so every platform
+ * generates the same files.
+ */
+static std::vector<fs::path> FileLoader_bench_corpus(fs::path const &directory, size_t nr_files, size_t file_size)
+{
+    std::minstd_rand        random(1);
+    std::vector<fs::path>   r;
+
+    for (size_t i = 0; i < nr_files; i++) {
+        std::string text;
+        while (text.size() < file_size) {
+            text += "    s" + std::to_string(random() % 1000) + " <= a and b;\n";
+        }
+        text.resize(file_size);
+
+        r.push_back(directory / string_format("file-%zu.vhd", i));
+        write_to_file(r.back(), text);
+    }
+    return r;
+}
+
+/** Count the lines of a file, to examine every byte as the tokenizer would.
+ */
+static size_t FileLoader_bench_lines(char const *data, size_t data_size)
+{
+    size_t  r = 0;
+    auto    end = data + data_size;
+
+    for (auto p = data; (p = (char const *)memchr(p, '\n', end - p)) != NULL; p++) {
+        r++;
+    }
+    return r;
+}
+
+/** Read every file and print the results as a JSON object.
+ * The best of a number of runs is reported, to reduce noise from the rest of the system.
+ *
+ * @param filenames     The files to read.
+ * @param method        Name of the method.
+ * @param nr_runs       Number of runs.
+ * @param last          true for the last result, which is not followed by a comma.
+ * @param f             Called as f(std::atomic<size_t> &nr_lines), returns the number of system calls.
+ */
+template <typename F>
+static void FileLoader_bench_run(std::vector<fs::path> const &filenames, char const *method, int nr_runs, bool last, F &&f)
+{
+    double              best = 1e99;
+    size_t              nr_syscalls = 0;
+    std::atomic<size_t> nr_lines(0);
+
+    for (int run = 0; run < nr_runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+
+        nr_lines = 0;
+        nr_syscalls = f(nr_lines);
+
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    printf("    {\"method\": \"%s\", \"lines\": %zu, \"seconds\": %.6f, \"files_per_s\": %.0f, \"syscalls_per_file\": %.2f}%s\n",
+        method, (size_t)nr_lines, best,
+        filenames.size() / best,
+        (double)nr_syscalls / filenames.size(),
+        last ? "" : ","
+    );
+}
+
+static void FileLoader_bench_usage(void)
+{
+    fprintf(stderr, "Usage: FileLoader_bench [-n <files>] [-s <kilobytes>] [-j <jobs>] [-r <runs>]\n");
+    fprintf(stderr, "  -n <files>        Number of files, default 20000.\n");
+    fprintf(stderr, "  -s <kilobytes>    Size of each file, default 8.\n");
+    fprintf(stderr, "  -j <jobs>         Number of jobs of the thread pool, default one per CPU.\n");
+    fprintf(stderr, "  -r <runs>         Number of runs of which the best is reported, default 5.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t  nr_files = 20000;
+    size_t  file_size = 8;
+    int     nr_runs = 5;
+    int     ch;
+
+    while ((ch = getopt(argc, argv, "hn:s:j:r:")) != -1) {
+        switch (ch) {
+        case 'n': nr_files = strtoul(optarg, NULL, 10); break;
+        case 's': file_size = strtoul(optarg, NULL, 10); break;
+        case 'j': ThreadPool::shared_nr_jobs = strtoul(optarg, NULL, 10); break;
+        case 'r': nr_runs = std::max(1, atoi(optarg)); break;
+        default: FileLoader_bench_usage(); return 2;
+        }
+    }
+    file_size *= 1024;
+
+    // The files are in the page cache after they are written, so this measures the cost of the system calls.
+    auto directory = fs::temp_directory_path() / string_format("FileLoader-bench-%i", (int)getpid());
+    fs::create_directories(directory);
+    auto filenames = FileLoader_bench_corpus(directory, nr_files, file_size);
+
+    printf("{\"files\": %zu, \"file_size\": %zu, \"jobs\": %zu, \"uring\": %s, \"results\": [\n",
+        nr_files, file_size, ThreadPool::shared().nr_jobs(), FileLoader::uring_supported() ? "true" : "false"
+    );
+
+    // A FileHandle for each file in turn, as before FileLoader: open, fstat, pread and close.
+    FileLoader_bench_run(filenames, "serial", nr_runs, false, [&filenames](std::atomic<size_t> &nr_lines) {
+        for (auto const &filename: filenames) {
+            FileHandle handle(filename);
+
+            handle.open();
+            nr_lines += FileLoader_bench_lines(handle.data, handle.data_size);
+            handle.close();
+        }
+        return filenames.size() * 4;
+    });
+
+    std::vector<int> loaders = {FileLoader::pread_loader};
+    if (FileLoader::uring_supported()) {
+        loaders.push_back(FileLoader::uring_loader);
+    }
+    for (auto loader: loaders) {
+        FileLoader_bench_run(filenames, FileLoader::name(loader), nr_runs, loader == loaders.back(), [&filenames,loader](std::atomic<size_t> &nr_lines) {
+            FileLoader file_loader(loader);
+
+            file_loader.load(filenames, [&nr_lines](size_t, char const *data, size_t data_size) {
+                nr_lines += FileLoader_bench_lines(data, data_size);
+            });
+            return (size_t)file_loader.nr_syscalls;
+        });
+    }
+    printf("]}\n");
+
+    fs::remove_all(directory);
+    return 0;
+}
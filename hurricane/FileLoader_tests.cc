@@ -0,0 +1,134 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE FileLoader
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <unistd.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FileLoader.h"
+#include "utils.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+struct FileLoader_tests_fixture {
+    fs::path                    directory;
+    std::vector<fs::path>       filenames;
+    std::vector<std::string>    texts;
+
+    FileLoader_tests_fixture() {
+        directory = string_format("/tmp/FileLoader-tests-%i", (int)getpid());
+        fs::create_directories(directory);
+
+        // More files than are read at the same time, including an empty file and a large file.
+        for (int i = 0; i < 1000; i++) {
+            std::string text;
+            auto nr_lines = i == 0 ? 0 : i == 1 ? 200000 : i % 50;
+            for (int j = 0; j < nr_lines; j++) {
+                text += string_format("file %i line %i\n", i, j);
+            }
+
+            filenames.push_back(directory / string_format("file-%i.vhd", i));
+            texts.push_back(text);
+            write_to_file(filenames.back(), text);
+        }
+    }
+
+    ~FileLoader_tests_fixture() {
+        fs::remove_all(directory);
+    }
+
+    std::vector<int> loaders(void) const {
+        std::vector<int> r = {FileLoader::pread_loader};
+        if (FileLoader::uring_supported()) {
+            r.push_back(FileLoader::uring_loader);
+        }
+        return r;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(FileLoader_tests, FileLoader_tests_fixture)
+
+BOOST_AUTO_TEST_CASE(file_loader_load_1)
+{
+    for (auto loader: loaders()) {
+        FileLoader                  file_loader(loader);
+        std::vector<std::string>    results(filenames.size());
+        std::vector<int>            nr_calls(filenames.size());
+
+        file_loader.load(filenames, [&](size_t i, char const *data, size_t data_size) {
+            results[i] = std::string(data, data_size);
+            nr_calls[i]++;
+        });
+
+        for (size_t i = 0; i < filenames.size(); i++) {
+            BOOST_CHECK_EQUAL(nr_calls[i], 1);
+            BOOST_CHECK(results[i] == texts[i]);
+        }
+        BOOST_CHECK_GT(file_loader.nr_syscalls, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(file_loader_error_1)
+{
+    filenames.insert(filenames.begin() + filenames.size() / 2, directory / "missing.vhd");
+
+    for (auto loader: loaders()) {
+        FileLoader  file_loader(loader);
+        std::mutex  mutex;
+        size_t      nr_calls = 0;
+
+        BOOST_CHECK_THROW(file_loader.load(filenames, [&](size_t, char const *, size_t) {
+            std::lock_guard<std::mutex> lock(mutex);
+            nr_calls++;
+        }), std::runtime_error);
+        BOOST_CHECK_EQUAL(nr_calls, filenames.size() - 1);
+    }
+
+    // An exception of the handler is passed on.
+    filenames.erase(filenames.begin() + filenames.size() / 2);
+    for (auto loader: loaders()) {
+        FileLoader file_loader(loader);
+
+        BOOST_CHECK_THROW(file_loader.load(filenames, [](size_t i, char const *, size_t) {
+            if (i == 500) {
+                throw std::logic_error("handler");
+            }
+        }), std::logic_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(file_loader_name_1)
+{
+    BOOST_CHECK_EQUAL(FileLoader::loader_by_name("uring"), FileLoader::uring_loader);
+    BOOST_CHECK_EQUAL(FileLoader::loader_by_name("pread"), FileLoader::pread_loader);
+    BOOST_CHECK_EQUAL(FileLoader::loader_by_name("aio"), -1);
+    BOOST_CHECK_EQUAL(FileLoader::name(FileLoader::pread_loader), std::string("pread"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <time.h>
+#include "FileStat.h"
+
+namespace takevos {
+namespace hurricane {
+
+const int64_t FileStat::racy_ns;
+
+bool FileStat::get(fs::path const &filename)
+{
+    struct stat stats;
+
+    if (::stat(filename.string().c_str(), &stats) == -1) {
+        return false;
+    }
+
+    set(stats);
+    return true;
+}
+
+void FileStat::set(struct stat const &stats)
+{
+    device = stats.st_dev;
+    inode = stats.st_ino;
+    size = stats.st_size;
+#ifdef __APPLE__
+    mtime_ns = stats.st_mtimespec.tv_sec * 1000000000LL + stats.st_mtimespec.tv_nsec;
+    ctime_ns = stats.st_ctimespec.tv_sec * 1000000000LL + stats.st_ctimespec.tv_nsec;
+#else
+    mtime_ns = stats.st_mtim.tv_sec * 1000000000LL + stats.st_mtim.tv_nsec;
+    ctime_ns = stats.st_ctim.tv_sec * 1000000000LL + stats.st_ctim.tv_nsec;
+#endif
+}
+
+int64_t FileStat::now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+}}
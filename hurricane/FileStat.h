@@ -0,0 +1,85 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_FILESTAT_H
+#define TAKEVOS_HURRICANE_FILESTAT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace takevos {
+namespace hurricane {
+
+/** The metadata of a file or directory which changes when its contents change.
+ * For a directory the contents are its entries.
+ */
+struct FileStat {
+    /** A file modified less than this before a result was recorded may be modified again without a change in its metadata.
+     * Some file systems only store the modification time in seconds.
+     */
+    static const int64_t racy_ns = 1000000000LL;
+
+    uint64_t    device;
+    uint64_t    inode;
+    uint64_t    size;
+    int64_t     mtime_ns;   ///< Modification time, in nanoseconds since the epoch.
+    int64_t     ctime_ns;   ///< Status change time, in nanoseconds since the epoch.
+
+    /** Get the metadata of a file.
+     * @param filename  The file.
+     * @return false when the file could not be found.
+     */
+    bool get(fs::path const &filename);
+
+    /** Set the metadata from the result of stat().
+     */
+    void set(struct stat const &stats);
+
+    /** The current time, in the same unit as mtime_ns.
+     */
+    static int64_t now_ns(void);
+
+    /** Check if the file may have been modified after a time without a change in its metadata.
+     * @param time_ns   The time a result for the file was recorded, see now_ns().
+     */
+    bool is_racy(int64_t time_ns) const {
+        return mtime_ns + racy_ns > time_ns;
+    }
+
+    bool operator==(FileStat const &other) const {
+        return
+            device == other.device && inode == other.inode && size == other.size &&
+            mtime_ns == other.mtime_ns && ctime_ns == other.ctime_ns;
+    }
+
+    bool operator!=(FileStat const &other) const {
+        return !(*this == other);
+    }
+};
+
+}}
+#endif
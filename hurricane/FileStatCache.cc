@@ -0,0 +1,216 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <exception>
+#include <functional>
+#include <unistd.h>
+#include <limits.h>
+#include "FileStatCache.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** Maximum number of symbolic links that are followed for a single path, as ELOOP.
+ */
+static const int FileStatCache_max_links = 40;
+
+const size_t FileStatCache::nr_shards;
+
+FileStatCache::FileStatCache() :
+    nr_lookups(0), nr_syscalls(0)
+{
+}
+
+FileStatCache &FileStatCache::shared(void)
+{
+    static FileStatCache cache;
+
+    return cache;
+}
+
+FileStatCache::Shard &FileStatCache::shard(std::string const &key)
+{
+    return shards[std::hash<std::string>()(key) % nr_shards];
+}
+
+FileStatCacheEntry FileStatCache::get(std::string const &key, bool follow)
+{
+    FileStatCacheEntry  r;
+    struct stat         stats;
+
+    nr_syscalls++;
+    if ((follow ? ::stat(key.c_str(), &stats) : ::lstat(key.c_str(), &stats)) == -1) {
+        r.found = false;
+        r.mode = 0;
+        r.stat = FileStat();
+    } else {
+        r.found = true;
+        r.mode = stats.st_mode;
+        r.stat.set(stats);
+    }
+    return r;
+}
+
+FileStatCacheEntry FileStatCache::stat(fs::path const &path)
+{
+    auto    key = path.string();
+    auto    &s = shard(key);
+
+    nr_lookups++;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        auto i = s.stats.find(key);
+        if (i != s.stats.end()) {
+            return i->second;
+        }
+
+        // Without a symbolic link at the end, stat() and lstat() return the same.
+        auto j = s.lstats.find(key);
+        if (j != s.lstats.end() && !j->second.is_symlink()) {
+            return j->second;
+        }
+    }
+
+    auto r = get(key, true);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.stats.emplace(key, r);
+    return r;
+}
+
+FileStatCacheEntry FileStatCache::lstat(fs::path const &path)
+{
+    auto    key = path.string();
+    auto    &s = shard(key);
+
+    nr_lookups++;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        auto i = s.lstats.find(key);
+        if (i != s.lstats.end()) {
+            return i->second;
+        }
+    }
+
+    auto r = get(key, false);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.lstats.emplace(key, r);
+    return r;
+}
+
+FileStatCacheEntry FileStatCache::refresh(fs::path const &path)
+{
+    auto    key = path.string();
+    auto    &s = shard(key);
+
+    nr_lookups++;
+    auto r = get(key, true);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.stats[key] = r;
+    s.lstats.erase(key);
+    return r;
+}
+
+fs::path FileStatCache::canonical(fs::path const &path)
+{
+    return canonical(fs::absolute(path), 0);
+}
+
+fs::path FileStatCache::canonical(fs::path const &path, int nr_links)
+{
+    if (path == path.root_path()) {
+        return path;
+    }
+
+    auto    key = path.string();
+    auto    &s = shard(key);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        auto i = s.canonicals.find(key);
+        if (i != s.canonicals.end()) {
+            nr_lookups++;
+            return i->second;
+        }
+    }
+
+    // The parent is canonical, so only the last component needs to be resolved.
+    auto        parent = canonical(path.parent_path(), nr_links);
+    auto        name = path.filename();
+    fs::path    r;
+
+    if (name == ".") {
+        r = parent;
+
+    } else if (name == "..") {
+        r = parent == parent.root_path() ? parent : parent.parent_path();
+
+    } else {
+        auto candidate = parent / name;
+        auto entry = lstat(candidate);
+
+        if (!entry.found) {
+            throw std::runtime_error("Cannot find '" + path.string() + "'.");
+        }
+
+        if (entry.is_symlink()) {
+            char    target[PATH_MAX];
+            ssize_t target_size;
+
+            nr_lookups++;
+            nr_syscalls++;
+            if (nr_links >= FileStatCache_max_links || (target_size = ::readlink(candidate.string().c_str(), target, sizeof (target))) == -1) {
+                throw std::runtime_error("Cannot resolve link '" + candidate.string() + "'.");
+            }
+
+            auto target_path = fs::path(std::string(target, target_size));
+            r = canonical(target_path.is_absolute() ? target_path : parent / target_path, nr_links + 1);
+
+        } else {
+            r = candidate;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.canonicals.emplace(key, r);
+    return r;
+}
+
+void FileStatCache::clear(void)
+{
+    for (auto &s: shards) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        s.stats.clear();
+        s.lstats.clear();
+        s.canonicals.clear();
+    }
+}
+
+}}
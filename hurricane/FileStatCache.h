@@ -0,0 +1,138 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_FILESTATCACHE_H
+#define TAKEVOS_HURRICANE_FILESTATCACHE_H
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include "FileStat.h"
+
+namespace fs = boost::filesystem;
+
+namespace takevos {
+namespace hurricane {
+
+/** The metadata of a path, as found by stat() or lstat().
+ */
+struct FileStatCacheEntry {
+    bool        found;      ///< The path exists.
+    mode_t      mode;       ///< The type and permissions, see struct stat.
+    FileStat    stat;       ///< The metadata, when found.
+
+    bool is_directory(void) const { return found && S_ISDIR(mode); }
+    bool is_regular_file(void) const { return found && S_ISREG(mode); }
+    bool is_symlink(void) const { return found && S_ISLNK(mode); }
+};
+
+/** A process-wide cache of the metadata and the canonical form of paths.
+ *
+ * Finding the project and library directories, walking the libraries and
+ * checking files for changes look at the same paths; through this cache each
+ * path is stat'ed once during a run. A canonical path is built from the
+ * canonical path of its parent, so finding the directories with a file from a
+ * directory up to the root costs a single lstat() for each ancestor.
+ *
+ * The paths are spread over shards, each with its own mutex, so that the tasks
+ * of the ThreadPool rarely wait for each other. A lookup returns what was found
+ * the first time during the run; a check for a change of a file must use
+ * refresh(), which always asks the file system.
+ */
+class FileStatCache {
+public:
+    static const size_t nr_shards = 64;
+
+    std::atomic<size_t> nr_lookups;     ///< Number of paths looked up, including those by canonical().
+    std::atomic<size_t> nr_syscalls;    ///< Number of system calls made for the lookups.
+
+    FileStatCache();
+    FileStatCache(FileStatCache const &) = delete;
+    FileStatCache &operator=(FileStatCache const &) = delete;
+
+    /** The cache used by the whole process.
+     */
+    static FileStatCache &shared(void);
+
+    /** The metadata of a path, following symbolic links.
+     */
+    FileStatCacheEntry stat(fs::path const &path);
+
+    /** The metadata of a path, not following a symbolic link at the end of the path.
+     */
+    FileStatCacheEntry lstat(fs::path const &path);
+
+    /** The current metadata of a path, following symbolic links.
+     * The file system is always asked, and the result replaces the cached metadata.
+     */
+    FileStatCacheEntry refresh(fs::path const &path);
+
+    /** Check if a path exists, following symbolic links.
+     */
+    bool exists(fs::path const &path) {
+        return stat(path).found;
+    }
+
+    /** The absolute path without symbolic links and '.' and '..' components, like realpath().
+     * Throws std::runtime_error when the path does not exist.
+     */
+    fs::path canonical(fs::path const &path);
+
+    /** Number of system calls that were saved by the cache.
+     */
+    size_t nr_saved(void) const {
+        return nr_lookups - nr_syscalls;
+    }
+
+    /** Forget all paths, for when the file system was changed during the run.
+     */
+    void clear(void);
+
+private:
+    struct Shard {
+        std::mutex                                          mutex;
+        std::unordered_map<std::string,FileStatCacheEntry>  stats;      ///< Results of stat().
+        std::unordered_map<std::string,FileStatCacheEntry>  lstats;     ///< Results of lstat().
+        std::unordered_map<std::string,fs::path>            canonicals; ///< Canonical paths.
+    };
+
+    Shard shards[nr_shards];
+
+    Shard &shard(std::string const &key);
+
+    /** Call stat() or lstat().
+     */
+    FileStatCacheEntry get(std::string const &key, bool follow);
+
+    /** The canonical path of an absolute path.
+     * @param nr_links  Number of symbolic links followed to reach this path.
+     */
+    fs::path canonical(fs::path const &path, int nr_links);
+};
+
+}}
+#endif
@@ -0,0 +1,133 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE FileStatCache
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <unistd.h>
+#include <string>
+#include "FileStatCache.h"
+#include "utils.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+struct FileStatCache_tests_fixture {
+    fs::path    directory;
+
+    FileStatCache_tests_fixture() {
+        directory = string_format("/tmp/FileStatCache-tests-%i", (int)getpid());
+        fs::create_directories(directory / "a" / "b" / "c");
+        write_to_file(directory / "a" / "b" / "file.txt", "Hello World");
+
+        // Just in case symbolic links are pointing from /tmp
+        directory = fs::canonical(directory);
+
+        fs::create_symlink("b/file.txt", directory / "a" / "link.txt");
+        fs::create_directory_symlink("../../b", directory / "a" / "b" / "c" / "up");
+        fs::create_symlink("loop", directory / "loop");
+    }
+
+    ~FileStatCache_tests_fixture() {
+        fs::remove_all(directory);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(FileStatCache_tests, FileStatCache_tests_fixture)
+
+BOOST_AUTO_TEST_CASE(file_stat_cache_stat_1)
+{
+    FileStatCache cache;
+
+    auto file = cache.stat(directory / "a" / "b" / "file.txt");
+    BOOST_CHECK(file.is_regular_file());
+    BOOST_CHECK_EQUAL(file.stat.size, 11);
+    BOOST_CHECK(cache.stat(directory / "a" / "b").is_directory());
+    BOOST_CHECK(!cache.stat(directory / "missing").found);
+    BOOST_CHECK_EQUAL(cache.nr_syscalls, 3);
+
+    // The second time every path comes from the cache.
+    BOOST_CHECK(cache.stat(directory / "a" / "b" / "file.txt").stat == file.stat);
+    BOOST_CHECK(cache.stat(directory / "a" / "b").is_directory());
+    BOOST_CHECK(!cache.exists(directory / "missing"));
+    BOOST_CHECK_EQUAL(cache.nr_syscalls, 3);
+    BOOST_CHECK_EQUAL(cache.nr_saved(), 3);
+
+    // A link is followed by stat(), not by lstat().
+    BOOST_CHECK(cache.stat(directory / "a" / "link.txt").stat == file.stat);
+    BOOST_CHECK(cache.lstat(directory / "a" / "link.txt").is_symlink());
+}
+
+BOOST_AUTO_TEST_CASE(file_stat_cache_refresh_1)
+{
+    FileStatCache   cache;
+    auto            filename = directory / "a" / "b" / "file.txt";
+
+    auto before = cache.stat(filename);
+    write_to_file(filename, "Hello");
+
+    // Until refreshed, the metadata from the first lookup is returned.
+    BOOST_CHECK_EQUAL(cache.stat(filename).stat.size, before.stat.size);
+    BOOST_CHECK_EQUAL(cache.refresh(filename).stat.size, 5);
+    BOOST_CHECK_EQUAL(cache.stat(filename).stat.size, 5);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.stat(filename).stat.size, 5);
+    BOOST_CHECK_EQUAL(cache.nr_syscalls, 3);
+}
+
+BOOST_AUTO_TEST_CASE(file_stat_cache_canonical_1)
+{
+    FileStatCache cache;
+
+    for (auto path: {
+        directory / "a" / "b",
+        directory / "a" / "b" / "c" / ".." / "file.txt",
+        directory / "a" / "." / "link.txt",
+        directory / "a" / "b" / "c" / "up" / "c" / "up" / "file.txt",
+        directory / "a" / "b" / "c" / "up" / ".." / "link.txt",
+    }) {
+        BOOST_CHECK_EQUAL(cache.canonical(path), fs::canonical(path));
+    }
+
+    BOOST_CHECK_EQUAL(cache.canonical(directory / "a" / "b" / "c" / ""), directory / "a" / "b" / "c");
+    BOOST_CHECK_THROW(cache.canonical(directory / "missing" / "b"), std::runtime_error);
+    BOOST_CHECK_THROW(cache.canonical(directory / "loop"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(file_stat_cache_canonical_2)
+{
+    FileStatCache   cache;
+    auto            depth = std::distance(directory.begin(), directory.end());
+
+    // One lstat() for each component, the ancestors are shared between paths.
+    cache.canonical(directory / "a" / "b" / "c");
+    BOOST_CHECK_EQUAL(cache.nr_syscalls, depth - 1 + 3);
+    cache.canonical(directory / "a" / "b" / "file.txt");
+    cache.canonical(directory / "a" / "b" / "c");
+    BOOST_CHECK_EQUAL(cache.nr_syscalls, depth - 1 + 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
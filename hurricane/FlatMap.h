@@ -0,0 +1,166 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_FLATMAP_H
+#define TAKEVOS_HURRICANE_FLATMAP_H
+
+#include <stddef.h>
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "strings.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** A map stored as a sorted array of key/value pairs.
+ * Up to N pairs are stored inside the object itself, so that a small map needs
+ * no allocations and its pairs are next to each other in memory. Larger maps
+ * move all of their pairs to the heap.
+ *
+ * It has the part of the interface of std::map used by MapQuery. Iterators
+ * are pointers, which are invalidated when a pair is added.
+ */
+template <class K, class V, size_t N = 4>
+class FlatMap {
+public:
+    typedef std::pair<K,V>      value_type;
+    typedef value_type          *iterator;
+    typedef value_type const    *const_iterator;
+
+    FlatMap() : nr_items(0) {
+    }
+
+    /** Convert a std::map.
+     * @param m     A map with keys and values which can be converted to K and V.
+     */
+    template <class K2, class V2>
+    FlatMap(std::map<K2,V2> const &m) : nr_items(0) {
+        for (auto &x: m) {
+            (*this)[K(x.first)] = V(x.second);
+        }
+    }
+
+    size_t size(void) const { return nr_items; }
+    bool empty(void) const { return nr_items == 0; }
+
+    iterator begin(void) { return data(); }
+    iterator end(void) { return data() + nr_items; }
+    const_iterator begin(void) const { return data(); }
+    const_iterator end(void) const { return data() + nr_items; }
+
+    iterator find(K const &key) {
+        auto i = lower_bound(key);
+        return (i != end() && i->first == key) ? i : end();
+    }
+
+    const_iterator find(K const &key) const {
+        auto i = const_cast<FlatMap *>(this)->lower_bound(key);
+        return (i != end() && i->first == key) ? i : end();
+    }
+
+    size_t count(K const &key) const {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    /** The value of a key, which is added with a default value when it is not in the map.
+     */
+    V &operator[](K const &key) {
+        auto i = lower_bound(key);
+        if (i != end() && i->first == key) {
+            return i->second;
+        }
+        return insert_at(i - begin(), value_type(key, V()))->second;
+    }
+
+    /** Add pairs, except those with a key which is already in the map.
+     */
+    template <class I>
+    void insert(I first, I last) {
+        for (; first != last; ++first) {
+            auto i = lower_bound(first->first);
+            if (i == end() || !(i->first == first->first)) {
+                insert_at(i - begin(), *first);
+            }
+        }
+    }
+
+    bool operator==(FlatMap const &other) const {
+        return nr_items == other.nr_items && std::equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(FlatMap const &other) const {
+        return !(*this == other);
+    }
+
+private:
+    size_t                  nr_items;
+    value_type              small_items[N];     ///< The pairs, when there are at most N.
+    std::vector<value_type> large_items;        ///< The pairs, when there are more than N.
+
+    value_type *data(void) { return nr_items <= N ? small_items : large_items.data(); }
+    value_type const *data(void) const { return nr_items <= N ? small_items : large_items.data(); }
+
+    iterator lower_bound(K const &key) {
+        return std::lower_bound(begin(), end(), key, [](value_type const &x, K const &key) {
+            return x.first < key;
+        });
+    }
+
+    iterator insert_at(size_t index, value_type const &x) {
+        if (nr_items < N) {
+            std::move_backward(small_items + index, small_items + nr_items, small_items + nr_items + 1);
+            small_items[index] = x;
+
+        } else {
+            if (nr_items == N) {
+                large_items.assign(small_items, small_items + N);
+            }
+            large_items.insert(large_items.begin() + index, x);
+        }
+
+        nr_items++;
+        return data() + index;
+    }
+};
+
+}}
+
+namespace std {
+
+template <class K, class V, size_t N>
+static inline std::ostream &operator<<(std::ostream &os, const takevos::hurricane::FlatMap<K,V,N> &m) {
+    os << "{";
+    for (auto &x: m) {
+        os << std::to_string(x.first) << ": " << std::to_string(x.second) << ", ";
+    }
+    os << "}";
+    return os;
+}
+
+}
+#endif
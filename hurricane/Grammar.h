@@ -0,0 +1,507 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_GRAMMAR_H
+#define TAKEVOS_HURRICANE_GRAMMAR_H
+#include <stdbool.h>
+#include <string.h>
+#include <stdexcept>
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Tokenizer.h"
+#include "TokenizerBackend.h"
+#include "TokenizerCache.h"
+#include "ThreadPool.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** Type used to select a token handler by overloading on the token code.
+ */
+template <int Code>
+using TokenCode = std::integral_constant<int, Code>;
+
+/** Count the capturing sub expressions in a pattern.
+ * This follows the syntax accepted by the NFA; syntax errors are left for the NFA to report.
+ *
+ * @param pattern   The pattern in extended regular expression format.
+ * @return The number of capturing sub expressions.
+ */
+constexpr int count_groups(char const * const pattern)
+{
+    int r = 0;
+
+    for (size_t i = 0; pattern[i] != '\0'; i++) {
+        if (pattern[i] == '\\' && pattern[i + 1] != '\0') {
+            i++;
+
+        } else if (pattern[i] == '[') {
+            i++;
+            if (pattern[i] == '^') {
+                i++;
+            }
+            if (pattern[i] == ']') {
+                i++;
+            }
+            while (pattern[i] != '\0' && pattern[i] != ']') {
+                if (pattern[i] == '[' && (pattern[i + 1] == ':' || pattern[i + 1] == '.' || pattern[i + 1] == '=')) {
+                    // Skip over [:class:], [.c.] and [=c=].
+                    auto terminator = pattern[i + 1];
+                    i += 2;
+                    while (pattern[i] != '\0' && !(pattern[i] == terminator && pattern[i + 1] == ']')) {
+                        i++;
+                    }
+                    if (pattern[i] != '\0') {
+                        i++;
+                    }
+                }
+                if (pattern[i] != '\0') {
+                    i++;
+                }
+            }
+            if (pattern[i] == '\0') {
+                return r;
+            }
+
+        } else if (pattern[i] == '(' && pattern[i + 1] != '?') {
+            r++;
+        }
+    }
+    return r;
+}
+
+/** A match found by a Grammar.
+ * All offsets are relative to the start of the text.
+ */
+struct GrammarMatch : DFAMatch {
+    size_t      search_start;                       ///< Offset where the search for this match started.
+    long        slots[TokenView::max_groups * 2];   ///< Begin and end offset of each sub expression, -1 when not used.
+
+    /** Offset where the search for the next match starts.
+     * Always makes progress on an empty match at the start of the search.
+     */
+    size_t next(void) const {
+        return end > search_start ? end : search_start + 1;
+    }
+};
+
+/** A pattern of a Grammar.
+ * When a TokenRule is constructed as a constant expression, a pattern with a
+ * different number of capturing sub expressions is a compile error.
+ *
+ * @tparam Code         The token code, or Token::suppress when the token is not passed to the handler.
+ * @tparam NrGroups     The number of capturing sub expressions in the pattern.
+ */
+template <int Code, int NrGroups>
+struct TokenRule {
+    static const int code = Code;
+    static const int nr_groups = NrGroups;
+
+    static_assert(NrGroups >= 0 && NrGroups <= TokenView::max_groups, "Too many sub-expressions");
+
+    char const * const  pattern;    ///< The pattern in extended regular expression format.
+
+    constexpr TokenRule(char const * const pattern) :
+        pattern(count_groups(pattern) == NrGroups ? pattern : throw std::logic_error("Wrong number of sub-expressions in pattern")) {}
+};
+
+/** A tokenizer with a grammar that is known at compile time.
+ *
+ * The token codes and the number of sub expressions of each pattern are part
+ * of the type. For each token the handler is called with a TokenCode<code>
+ * followed by exactly that many boost::string_ref arguments, so a handler
+ * taking the wrong number of sub expressions does not compile. The call
+ * for each pattern is selected through a table that is built at compile time.
+ *
+ * The patterns are compiled into a DFA when the Grammar is constructed;
+ * a Grammar is usually a function-local static so this happens on first use.
+ *
+ * @tparam Rules    A TokenRule for each pattern, in priority order.
+ */
+template <typename... Rules>
+class Grammar {
+public:
+    using RuleTuple = std::tuple<Rules...>;
+    static const size_t nr_rules = sizeof... (Rules);
+
+    Tokenizer   tokenizer;  ///< The compiled patterns.
+
+    /** Compile the grammar.
+     * @param rules             The pattern for each rule.
+     * @param cache_directory   Directory of the TokenizerCache, empty to always compile the patterns.
+     */
+    Grammar(RuleTuple const &rules, fs::path const &cache_directory = fs::path())
+    {
+        TokenizerCache::compile(tokenizer, patterns(rules, std::make_index_sequence<nr_rules>()), cache_directory);
+        check_groups(std::make_index_sequence<nr_rules>());
+    }
+
+    /** Find all tokens in the text, passing each token to a handler as soon as it is found.
+     * The sub expressions passed to the handler point into the text.
+     * Tokens with code Token::suppress are not passed to the handler.
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param handler       Called as handler(TokenCode<code>(), boost::string_ref group...) for each token.
+     */
+    template <typename F>
+    void for_each_token(char const * const text, size_t text_size, F &&handler) const {
+        auto            visitors = visitor_table<typename std::decay<F>::type>(std::make_index_sequence<nr_rules>());
+        GrammarMatch    match;
+        size_t          offset = 0;
+
+        while (find(text, text_size, offset, match)) {
+            visitors[match.pattern](text, match, handler);
+            offset = match.next();
+        }
+    }
+
+    /** Find all tokens in the text using several threads.
+     * The text is split at line boundaries into chunks which are tokenized
+     * concurrently, each chunk starting a new search at its first byte. The
+     * chunks are merged in order; where a token of the previous chunk ran
+     * past the start of the next chunk the search is repeated from the end
+     * of that token, until it finds the same token as the chunk did. After
+     * that both searches are in lock-step, so the result is identical to
+     * for_each_token().
+     *
+     * The handler is called from the calling thread, in the order of the
+     * tokens in the text, so it may keep state between tokens.
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param nr_chunks     The number of chunks to tokenize concurrently.
+     * @param handler       Called as handler(TokenCode<code>(), boost::string_ref group...) for each token.
+     */
+    template <typename F>
+    void parallel_for_each_token(char const * const text, size_t text_size, size_t nr_chunks, F &&handler) const {
+        auto visitors = visitor_table<typename std::decay<F>::type>(std::make_index_sequence<nr_rules>());
+
+        parallel_for_each_match(text, text_size, nr_chunks, [&](GrammarMatch const &match) {
+            visitors[match.pattern](text, match, handler);
+        });
+    }
+
+    /** Find all tokens in the text using several threads, passing each token as a TokenView.
+     * This is used where the handler is not known at compile time, see GrammarTokenizerBackend.
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param nr_chunks     The number of chunks to tokenize concurrently.
+     * @param visitor       Called as visitor(const TokenView &token) for each token.
+     */
+    template <typename F>
+    void parallel_for_each_view(char const * const text, size_t text_size, size_t nr_chunks, F &&visitor) const {
+        TokenView   token;
+
+        parallel_for_each_match(text, text_size, nr_chunks, [&](GrammarMatch const &match) {
+            auto &sub_pattern = tokenizer.sub_patterns[match.pattern];
+            if (sub_pattern.code == Token::suppress) {
+                return;
+            }
+
+            token.code = sub_pattern.code;
+            token.nr_groups = sub_pattern.nsub;
+            token.offset = match.begin;
+            for (int i = 0; i < sub_pattern.nsub; i++) {
+                token.groups[i] = group(text, match.slots, i);
+            }
+            visitor(token);
+        });
+    }
+
+    /** Pass a token that was found by another tokenizer of this grammar to a handler.
+     * This adapts the tokens of a TokenStream or a TokenizerBackend, which are
+     * passed as a TokenView, to the handlers of for_each_token().
+     *
+     * @param token         The token, with a code of one of the rules.
+     * @param handler       Called as handler(TokenCode<code>(), boost::string_ref group...).
+     */
+    template <typename F>
+    void visit_token(TokenView const &token, F &&handler) const {
+        static int const codes[] = {Rules::code...};
+        auto visitors = view_visitor_table<typename std::decay<F>::type>(std::make_index_sequence<nr_rules>());
+
+        for (size_t i = 0; i < nr_rules; i++) {
+            if (codes[i] == token.code) {
+                visitors[i](token, handler);
+                return;
+            }
+        }
+    }
+
+    /** Find the next token.
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param offset        The offset to start searching.
+     * @param match         Returns the match, with its sub expressions.
+     * @return true when a token was found.
+     */
+    bool find(char const * const text, size_t text_size, size_t offset, GrammarMatch &match) const {
+        if (offset > text_size || !tokenizer.dfa.search(&text[offset], text_size - offset, match)) {
+            return false;
+        }
+
+        match.search_start = offset;
+        match.begin+= offset;
+        match.end+= offset;
+
+        // Only the pattern that matched needs to be executed again to find its sub-expressions.
+        auto nsub = tokenizer.sub_patterns[match.pattern].nsub;
+        if (nsub > 0) {
+            if (!tokenizer.nfa.capture(match.pattern, &text[offset], text_size - offset, match.begin - offset, match.end - offset, match.slots)) {
+                fprintf(stderr, "ERROR extracting sub-expressions of pattern %i.\n", match.pattern);
+                abort();
+            }
+            for (int i = 0; i < nsub * 2; i++) {
+                if (match.slots[i] >= 0) {
+                    match.slots[i]+= offset;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    /** The matches found in a chunk of the text.
+     */
+    struct GrammarChunk {
+        std::vector<GrammarMatch>   matches;        ///< The matches, in order.
+        size_t                      stop;           ///< Offset of the first search at or after the end of the chunk.
+        bool                        end_of_text;    ///< The search at stop found no match.
+    };
+
+    /** Find all matches in the text using several threads, see parallel_for_each_token().
+     * @param on_match      Called as on_match(const GrammarMatch &match) for each match, in order.
+     */
+    template <typename M>
+    void parallel_for_each_match(char const * const text, size_t text_size, size_t nr_chunks, M &&on_match) const {
+        std::vector<size_t>     boundaries;
+        size_t                  offset = 0;
+        GrammarMatch            match;
+
+        // A search treats its start as the beginning of a line, which is only true for a chunk.
+        if (nr_chunks < 2 || tokenizer.nfa.has_bol()) {
+            while (find(text, text_size, offset, match)) {
+                on_match(match);
+                offset = match.next();
+            }
+            return;
+        }
+
+        boundaries.push_back(0);
+        for (size_t i = 1; i < nr_chunks; i++) {
+            auto boundary = std::max(boundaries.back(), i * (text_size / nr_chunks));
+            auto newline = (char const *)memchr(&text[boundary], '\n', text_size - boundary);
+            boundary = newline != NULL ? newline - text + 1 : text_size;
+            if (boundary > boundaries.back()) {
+                boundaries.push_back(boundary);
+            }
+        }
+        boundaries.push_back(text_size + 1);
+
+        // The chunks are tasks of the shared pool; while waiting for a chunk this thread tokenizes other chunks.
+        auto                            &pool = ThreadPool::shared();
+        std::vector<GrammarChunk>       chunks(boundaries.size() - 1);
+        std::vector<ThreadPoolGroup>    groups(chunks.size());
+
+        try {
+            for (size_t i = 0; i < chunks.size(); i++) {
+                pool.submit(groups[i], [this,text,text_size,&boundaries,&chunks,i]() {
+                    chunks[i] = tokenize_chunk(text, text_size, boundaries[i], boundaries[i+1]);
+                });
+            }
+
+            bool done = false;
+            for (size_t c = 0; c < chunks.size() && !done; c++) {
+                pool.wait(groups[c]);
+
+                auto    &chunk = chunks[c];
+                size_t  i = 0;
+
+                while (offset < chunk.stop) {
+                    while (i + 1 < chunk.matches.size() && chunk.matches[i + 1].search_start <= offset) {
+                        i++;
+                    }
+
+                    if (i < chunk.matches.size() && chunk.matches[i].begin >= offset &&
+                        (chunk.matches[i].end > offset || chunk.matches[i].search_start == offset)) {
+                        // No match starts between the search of the chunk and offset, so the serial search would find the same tokens.
+                        for (; i < chunk.matches.size(); i++) {
+                            on_match(chunk.matches[i]);
+                        }
+                        offset = chunk.stop;
+
+                    } else if (find(text, text_size, offset, match)) {
+                        on_match(match);
+                        offset = match.next();
+
+                    } else {
+                        done = true;
+                        break;
+                    }
+                }
+
+                done = done || chunk.end_of_text;
+            }
+        } catch (...) {
+            // The tasks of the chunks refer to this stack frame, the first exception is passed on.
+            for (auto &group: groups) {
+                try {
+                    pool.wait(group);
+                } catch (...) {
+                }
+            }
+            throw;
+        }
+
+        // The tasks of the remaining chunks refer to this stack frame.
+        for (auto &group: groups) {
+            pool.wait(group);
+        }
+    }
+
+    GrammarChunk tokenize_chunk(char const * const text, size_t text_size, size_t begin, size_t end) const {
+        GrammarChunk    chunk;
+        GrammarMatch    match;
+
+        chunk.stop = begin;
+        chunk.end_of_text = false;
+        while (chunk.stop < end) {
+            if (!find(text, text_size, chunk.stop, match)) {
+                chunk.end_of_text = true;
+                break;
+            }
+            chunk.matches.push_back(match);
+            chunk.stop = match.next();
+        }
+        return chunk;
+    }
+
+    template <typename F>
+    using Visitor = void (*)(char const * const text, GrammarMatch const &match, F &handler);
+
+    template <size_t... I>
+    static std::vector<std::pair<int,char const *>> patterns(RuleTuple const &rules, std::index_sequence<I...>) {
+        return {std::make_pair((int)std::tuple_element<I, RuleTuple>::type::code, std::get<I>(rules).pattern)...};
+    }
+
+    template <size_t... I>
+    void check_groups(std::index_sequence<I...>) const {
+        int const nr_groups[] = {std::tuple_element<I, RuleTuple>::type::nr_groups...};
+
+        for (size_t i = 0; i < nr_rules; i++) {
+            if (tokenizer.sub_patterns[i].nsub != nr_groups[i]) {
+                fprintf(stderr, "ERROR pattern %i has %i sub-expressions, expected %i.\n", (int)i, tokenizer.sub_patterns[i].nsub, nr_groups[i]);
+                abort();
+            }
+        }
+    }
+
+    template <typename F, size_t... I>
+    static Visitor<F> const *visitor_table(std::index_sequence<I...>) {
+        static Visitor<F> const visitors[] = {&Grammar::visit<F, I>...};
+        return visitors;
+    }
+
+    template <typename F, size_t I>
+    static void visit(char const * const text, GrammarMatch const &match, F &handler) {
+        using Rule = typename std::tuple_element<I, RuleTuple>::type;
+
+        call<Rule>(text, match, handler, std::integral_constant<bool, Rule::code == Token::suppress>(), std::make_index_sequence<Rule::nr_groups>());
+    }
+
+    template <typename F>
+    using ViewVisitor = void (*)(TokenView const &token, F &handler);
+
+    template <typename F, size_t... I>
+    static ViewVisitor<F> const *view_visitor_table(std::index_sequence<I...>) {
+        static ViewVisitor<F> const visitors[] = {&Grammar::visit_view<F, I>...};
+        return visitors;
+    }
+
+    template <typename F, size_t I>
+    static void visit_view(TokenView const &token, F &handler) {
+        using Rule = typename std::tuple_element<I, RuleTuple>::type;
+
+        call_view<Rule>(token, handler, std::integral_constant<bool, Rule::code == Token::suppress>(), std::make_index_sequence<Rule::nr_groups>());
+    }
+
+    template <typename Rule, typename F, size_t... G>
+    static void call_view(TokenView const &, F &, std::true_type, std::index_sequence<G...>) {
+    }
+
+    template <typename Rule, typename F, size_t... G>
+    static void call_view(TokenView const &token, F &handler, std::false_type, std::index_sequence<G...>) {
+        (void)token;
+        handler(TokenCode<Rule::code>(), token.groups[G]...);
+    }
+
+    template <typename Rule, typename F, size_t... G>
+    static void call(char const * const, GrammarMatch const &, F &, std::true_type, std::index_sequence<G...>) {
+    }
+
+    template <typename Rule, typename F, size_t... G>
+    static void call(char const * const text, GrammarMatch const &match, F &handler, std::false_type, std::index_sequence<G...>) {
+        // Without sub expressions the text and match are not used.
+        (void)text;
+        (void)match;
+        handler(TokenCode<Rule::code>(), group(text, match.slots, G)...);
+    }
+
+    static boost::string_ref group(char const * const text, long const slots[], size_t i) {
+        if (slots[i*2] >= 0 && slots[i*2+1] >= 0) {
+            return boost::string_ref(&text[slots[i*2]], slots[i*2+1] - slots[i*2]);
+        } else {
+            return boost::string_ref();
+        }
+    }
+};
+
+/** A tokenizer backend using the DFA of a Grammar.
+ * Large texts are tokenized by several threads, see Grammar::parallel_for_each_token().
+ *
+ * @tparam G    The type of the Grammar.
+ */
+template <typename G>
+class GrammarTokenizerBackend : public TokenizerBackend {
+public:
+    G const     &grammar;           ///< The compiled grammar.
+    size_t      min_chunk_size;     ///< The smallest part of a text that is tokenized by a separate thread.
+
+    GrammarTokenizerBackend(G const &grammar, size_t min_chunk_size) : grammar(grammar), min_chunk_size(min_chunk_size) {}
+
+    virtual char const *name(void) const { return "dfa"; }
+
+    virtual void for_each_token(char const * const text, size_t text_size, std::function<void(TokenView const &)> const &visitor) const {
+        size_t nr_chunks = std::min(ThreadPool::shared().nr_jobs(), text_size / min_chunk_size);
+
+        grammar.parallel_for_each_view(text, text_size, nr_chunks, visitor);
+    }
+};
+
+}}
+#endif
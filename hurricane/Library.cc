@@ -22,12 +22,32 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
 #include "Library.h"
 #include "Options.h"
+#include "DirectoryWalker.h"
+#include "ThreadPool.h"
+#include "VHDLSourceFile.h"
+#include "md5.h"
+#include "strings.h"
 
 namespace takevos {
 namespace hurricane {
 
+/** Number of source files that are processed together, while the walk continues.
+ */
+static const size_t Library_batch_size = 256;
+
+/** Create a source file of the type for an extension.
+ */
+static const std::map<std::string, std::function<SourceFile *(fs::path const &)>> Library_source_file_types = {
+    {".vhd",    [](fs::path const &path) -> SourceFile * { return new VHDLSourceFile(path); }},
+    {".vhdl",   [](fs::path const &path) -> SourceFile * { return new VHDLSourceFile(path); }},
+};
+
 Library::Library(fs::path const &library_directory) :
     library_directory(library_directory),
     configuration_path(library_directory / options.library_filename)
@@ -35,38 +55,72 @@ Library::Library(fs::path const &library_directory) :
     pt::ini_parser::read_ini(configuration_path.string(), configuration);
 }
 
-void Library::walk(fs::path const &directory)
+void Library::walk(void)
 {
-    /*
-    fs::directory_iterator end;
-
-    for (auto &i = fs::directory_iterator(directory); i != end; i++) {
-        auto x = *i;
-        if (is_directory(x.path())) {
-            if (exists(x.path() / options.library_filename)) {
-                options.log(LOG_NOTICE "Found library: %s", x.path().string().c_str());
-            } else {
-                walk(x.path());
-            }
+    auto                        &pool = ThreadPool::shared();
+    ThreadPoolGroup             group;
+    std::mutex                  mutex;
+    std::vector<SourceFile *>   batch;
+    std::vector<std::string>    extensions;
 
-        } else {
-            options.log(LOG_NOTICE "entry: %s", x.path().string().c_str());
-            auto ext = x.path().extension();
+    for (auto &type: Library_source_file_types) {
+        extensions.push_back(type.first);
+    }
+
+    // Called with the mutex held.
+    auto process_batch = [&pool,&group,&batch]() {
+        auto files = std::make_shared<std::vector<SourceFile *>>(std::move(batch));
+
+        batch.clear();
+        pool.submit(group, [files]() {
+            SourceFile::process_files(*files);
+        });
+    };
+
+    // The listings of the directories of the library, so that unchanged directories are not read again.
+    fs::path listings_filename;
+    if (!options.cache_directory.empty()) {
+        auto hash = MD5(fs::absolute(library_directory).string());
+        listings_filename = options.cache_directory / "directories" / string_format("%016llx%016llx.listing", (unsigned long long)(hash >> 64), (unsigned long long)hash);
+    }
 
-            auto j = options.source_file_handlers.find(ext);
-            if (j != options.source_file_handlers.end()) {
-                auto source_file_handler = *j;
+    DirectoryWalker     walker(extensions, options.library_filename.string(), listings_filename);
+    std::exception_ptr  exception;
 
-                SourceFile(this, source_file_handler, x.path());
+    try {
+        walker.walk(library_directory, [&](fs::path const &path) {
+            auto type = Library_source_file_types.find(path.extension().string());
+            if (type == Library_source_file_types.end()) {
+                return;
             }
-        }
+
+            std::unique_ptr<SourceFile> source_file(type->second(path));
+            std::lock_guard<std::mutex> lock(mutex);
+
+            batch.push_back(source_file.get());
+            source_files.push_back(std::move(source_file));
+            if (batch.size() == Library_batch_size) {
+                process_batch();
+            }
+
+        }, [&](fs::path const &path) {
+            options.log(LOG_NOTICE "Found library: %s", path.string().c_str());
+
+            std::lock_guard<std::mutex> lock(mutex);
+            library_directories.push_back(path);
+        });
+    } catch (...) {
+        // The batches that were submitted refer to the group.
+        exception = std::current_exception();
     }
-    */
-}
 
-void Library::walk(void)
-{
-    walk(library_directory);
+    if (!exception && !batch.empty()) {
+        process_batch();
+    }
+    pool.wait(group);
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
 }
 
 }}
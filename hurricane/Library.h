@@ -25,10 +25,13 @@
 #ifndef TAKEVOS_HURRICANE_LIBRARY_H
 #define TAKEVOS_HURRICANE_LIBRARY_H
 #include <stdbool.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
+#include "SourceFile.h"
 
 namespace fs = boost::filesystem;
 namespace pt = boost::property_tree;
@@ -42,14 +45,10 @@ private:
     fs::path    library_directory;
     fs::path    configuration_path;
 
-    /** Recusively find all source files and nested libraries.
-     * This function is called by the public method @see walk.
-     *
-     * @param directory     Directory to walk.
-     */
-    void walk(fs::path const &directory);
-
 public:
+    std::vector<std::unique_ptr<SourceFile>>    source_files;           ///< The source files found by walk().
+    std::vector<fs::path>                       library_directories;    ///< The directories of the nested libraries found by walk().
+
     /** Create a library object at the library_directory.
      * At the library_directory there must be a file named options.library_file.
      *
@@ -57,7 +56,10 @@ public:
      */
     Library(fs::path const &library_directory);
 
-    /** Recursively find all source files or nested libraries.
+    /** Recursively find all source files and nested libraries.
+     * The directory tree is read in parallel by a DirectoryWalker. The source
+     * files are processed in batches, see SourceFile::process_files(), while
+     * the rest of the tree is still being read.
      */
     void walk(void);
 };
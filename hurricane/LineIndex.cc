@@ -0,0 +1,98 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "LineIndex.h"
+
+namespace takevos {
+namespace hurricane {
+
+const size_t LineIndex::block_size;
+
+LineIndex::LineIndex(char const * const text, size_t text_size)
+{
+    size_t  nr_lines = 0;
+
+    block_lines.reserve(text_size / block_size + 1);
+    for (size_t offset = 0; offset <= text_size; offset += block_size) {
+        block_lines.push_back(nr_lines);
+        nr_lines += count_newlines(&text[offset], std::min(block_size, text_size - offset));
+    }
+}
+
+size_t LineIndex::line(char const * const text, size_t offset) const
+{
+    size_t block = std::min(offset / block_size, block_lines.size() - 1);
+    size_t block_start = block * block_size;
+
+    return block_lines[block] + count_newlines(&text[block_start], offset - block_start) + 1;
+}
+
+size_t LineIndex::column(char const * const text, size_t offset)
+{
+    size_t line_start = offset;
+
+    while (line_start > 0 && text[line_start - 1] != '\n') {
+        line_start--;
+    }
+    return offset - line_start + 1;
+}
+
+size_t LineIndex::count_newlines(char const * const text, size_t text_size)
+{
+    size_t  count = 0;
+    size_t  offset = 0;
+
+#if defined(__SSE2__)
+    auto newline = _mm_set1_epi8('\n');
+    auto zero = _mm_setzero_si128();
+
+    while (offset + 16 <= text_size) {
+        // Each byte of the accumulator counts up by one for every newline, the compare gives
+        // 0xff (minus one) which is subtracted; it is folded into the total before any of the
+        // bytes can overflow.
+        auto accumulator = _mm_setzero_si128();
+        size_t end = std::min(offset + 255 * 16, text_size & ~(size_t)15);
+
+        for (; offset < end; offset += 16) {
+            auto data = _mm_loadu_si128((__m128i const *)&text[offset]);
+            accumulator = _mm_sub_epi8(accumulator, _mm_cmpeq_epi8(data, newline));
+        }
+
+        auto sums = _mm_sad_epu8(accumulator, zero);
+        count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+#endif
+
+    for (; offset < text_size; offset++) {
+        count += text[offset] == '\n';
+    }
+    return count;
+}
+
+}}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_LINEINDEX_H
+#define TAKEVOS_HURRICANE_LINEINDEX_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector>
+
+namespace takevos {
+namespace hurricane {
+
+/** Convert byte offsets in a text to line and column numbers.
+ *
+ * Tokens only carry the byte offset at which they were found, so that
+ * the tokenizer does not need to track lines. When a diagnostic needs
+ * a line number, the index is built once for the text: it holds the
+ * number of newlines before each block of the text, counted 16 bytes
+ * at a time with SSE2. Finding a line only requires counting the newlines
+ * inside a single block.
+ */
+class LineIndex {
+public:
+    static const size_t block_size = 4096;  ///< Number of bytes for each entry in the index.
+
+    std::vector<size_t> block_lines;        ///< Number of newlines before the start of each block.
+
+    /** Build the index for a text.
+     * @param text          The text to index.
+     * @param text_size     The size of the text.
+     */
+    LineIndex(char const * const text, size_t text_size);
+
+    /** Line number of a byte.
+     * @param text          The text that was indexed.
+     * @param offset        The offset of the byte.
+     * @return The line number, starting at 1.
+     */
+    size_t line(char const * const text, size_t offset) const;
+
+    /** Column number of a byte.
+     * @param text          The text that was indexed.
+     * @param offset        The offset of the byte.
+     * @return The column number in bytes, starting at 1.
+     */
+    static size_t column(char const * const text, size_t offset);
+
+    /** Count the number of newlines in a text.
+     * @param text          The text to search.
+     * @param text_size     The size of the text.
+     * @return The number of '\n' characters.
+     */
+    static size_t count_newlines(char const * const text, size_t text_size);
+};
+
+}}
+#endif
@@ -0,0 +1,71 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE LineIndex
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <stdlib.h>
+#include <string>
+#include "LineIndex.h"
+
+using namespace takevos::hurricane;
+
+BOOST_AUTO_TEST_CASE(line_index_simple_1)
+{
+    std::string         test = "library foo;\n\nuse foo.bar;\n";
+    LineIndex           index(test.data(), test.size());
+
+    BOOST_CHECK_EQUAL(index.line(test.data(), 0), 1);
+    BOOST_CHECK_EQUAL(LineIndex::column(test.data(), 0), 1);
+    BOOST_CHECK_EQUAL(index.line(test.data(), test.find("foo.bar")), 3);
+    BOOST_CHECK_EQUAL(LineIndex::column(test.data(), test.find("foo.bar")), 5);
+    BOOST_CHECK_EQUAL(index.line(test.data(), test.size()), 4);
+}
+
+BOOST_AUTO_TEST_CASE(line_index_random_1)
+{
+    srandom(1);
+
+    for (int round = 0; round < 20; round++) {
+        std::string     test;
+
+        // Long runs without a newline overflow the byte counters of the vector loop.
+        auto text_size = random() % (3 * LineIndex::block_size);
+        auto newline_chance = 1 + random() % 2000;
+        for (size_t i = 0; i < text_size; i++) {
+            test.push_back(random() % newline_chance == 0 ? '\n' : 'x');
+        }
+
+        LineIndex index(test.data(), test.size());
+        size_t line = 1;
+        for (size_t offset = 0; offset <= test.size(); offset++) {
+            BOOST_REQUIRE_EQUAL(index.line(test.data(), offset), line);
+            if (offset < test.size() && test[offset] == '\n') {
+                line++;
+            }
+        }
+        BOOST_CHECK_EQUAL(LineIndex::count_newlines(test.data(), test.size()), line - 1);
+    }
+}
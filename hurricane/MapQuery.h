@@ -32,6 +32,8 @@
 #include <memory>
 #include "strings.h"
 #include "utils.h"
+#include "Symbol.h"
+#include "FlatMap.h"
 
 namespace takevos {
 namespace hurricane {
@@ -43,11 +45,15 @@ namespace hurricane {
  * Polymorphy requires pointers, which requires clone() functions to be
  * called, and values to be dereferenced. This is ugly when writing queries
  * in C++ code, therefor the MapQuery class is not implemented using inherintence.
+ *
+ * @param K     The type of the keys.
+ * @param V     The type of the values.
+ * @param M     The type of map that queries are compared with, with the interface of std::map<K,V>.
  */
-template <class K, class V>
+template <class K, class V, class M = std::map<K,V> >
 class MapQuery {
     char                            operation;
-    std::vector<MapQuery<K,V> >     items;
+    std::vector<MapQuery<K,V,M> >   items;
     K                               key;
     V                               value;
 public:
@@ -81,7 +87,7 @@ public:
      * @param lhs           The left hand side of the boolean operation.
      * @param rhs           The right hand side of the boolean operation.
      */
-    MapQuery(int operation, const MapQuery<K,V> &lhs, const MapQuery<K,V> &rhs) : operation(operation) {
+    MapQuery(int operation, const MapQuery<K,V,M> &lhs, const MapQuery<K,V,M> &rhs) : operation(operation) {
         if (lhs.operation != 'N') {
             // The left most NULL will be ignore because it may be an uninitialized query.
             add(lhs);
@@ -95,9 +101,9 @@ public:
      *
      * @param m     A map of key/value pairs.
      */
-    MapQuery(const std::map<K,V> &m) : operation('&') {
+    MapQuery(const M &m) : operation('&') {
         for (auto &x: m) {
-            items.push_back(MapQuery<K,V>(x.first, x.second));
+            items.push_back(MapQuery<K,V,M>(x.first, x.second));
         }
     }
 
@@ -110,7 +116,7 @@ public:
      * @param lhs           The left hand side of the boolean operation.
      * @param m             The right hand side of the boolean operation, being a map.
      */
-    MapQuery(int operation, const MapQuery<K,V> &lhs, const std::map<K,V> &m) : operation(operation) {
+    MapQuery(int operation, const MapQuery<K,V,M> &lhs, const M &m) : operation(operation) {
         MapQuery(lhs, MapQuery(m));
     }
 
@@ -119,19 +125,19 @@ public:
 
     /** OR two queries together.
      */
-    MapQuery<K,V> operator|(const MapQuery<K,V> &other) const {
-        return MapQuery<K,V>('|', *this, other);
+    MapQuery<K,V,M> operator|(const MapQuery<K,V,M> &other) const {
+        return MapQuery<K,V,M>('|', *this, other);
     }
 
     /** AND two queries together.
      */
-    MapQuery<K,V> operator&(const MapQuery<K,V> &other) const {
-        return MapQuery<K,V>('&', *this, other);
+    MapQuery<K,V,M> operator&(const MapQuery<K,V,M> &other) const {
+        return MapQuery<K,V,M>('&', *this, other);
     }
 
     /** OR two queries together.
      */
-    MapQuery<K,V> &operator|=(const MapQuery<K,V> &other) {
+    MapQuery<K,V,M> &operator|=(const MapQuery<K,V,M> &other) {
         if (operation == '|') {
             // Append when or is done on an or operation.
             add(other);
@@ -147,7 +153,7 @@ public:
 
     /** AND two queries together.
      */
-    MapQuery<K,V> &operator&=(const MapQuery<K,V> &other) {
+    MapQuery<K,V,M> &operator&=(const MapQuery<K,V,M> &other) {
         if (operation == '&') {
             // Append when or is done on an or operation.
             add(other);
@@ -164,21 +170,21 @@ public:
     /** OR a query together with a std::map.
      * The std::map is interpeted as MapQueryItems together in an AND-MapQueryExpression.
      */
-    MapQuery<K,V> operator|(const std::map<K,V> &other) const {
-        return MapQuery<K,V>('|', *this, other);
+    MapQuery<K,V,M> operator|(const M &other) const {
+        return MapQuery<K,V,M>('|', *this, other);
     }
 
     /** AND a query together with a std::map.
      * The std::map is interpeted as MapQueryItems together in an AND-MapQueryExpression.
      */
-    MapQuery<K,V> operator&(const std::map<K,V> &other) const {
-        return MapQuery<K,V>('&', *this, other);
+    MapQuery<K,V,M> operator&(const M &other) const {
+        return MapQuery<K,V,M>('&', *this, other);
     }
 
     /* Add an query to this boolean expression.
      * If the query itself is off the same type of boolean expression then we merge the query with this one.
      */
-    void add(const MapQuery<K,V> &other) {
+    void add(const MapQuery<K,V,M> &other) {
         switch (operation) {
         case '&':
         case '|':
@@ -207,8 +213,8 @@ public:
     /** Convert the query into a map.
      * Only items and and-boolean-expressions are supported.
      */
-    std::map<K,V> map(void) const {
-        std::map<K,V>   r;
+    M map(void) const {
+        M   r;
 
         switch (operation) {
         case 'i':
@@ -225,6 +231,42 @@ public:
         }
     }
 
+    /** Serialize the query, see TokenizerCacheWriter.
+     * @param writer    Has value(x) and string(x) methods.
+     */
+    template <typename W>
+    void write(W &writer) const {
+        writer.value(operation);
+        writer.string(std::to_string(key));
+        writer.string(std::to_string(value));
+        writer.value((uint64_t)items.size());
+        for (auto &x: items) {
+            x.write(writer);
+        }
+    }
+
+    /** Deserialize a query written by write(), see TokenizerCacheReader.
+     * @param reader    Has value(x) and string(x) methods.
+     */
+    template <typename R>
+    void read(R &reader) {
+        uint64_t    nr_items;
+        std::string key_string;
+        std::string value_string;
+
+        reader.value(operation);
+        reader.string(key_string);
+        reader.string(value_string);
+        key = K(key_string);
+        value = V(value_string);
+        reader.value(nr_items);
+        items.clear();
+        for (uint64_t i = 0; i < nr_items; i++) {
+            items.emplace_back();
+            items.back().read(reader);
+        }
+    }
+
     /** Convert the query into a string.
      */
     std::string string() const
@@ -256,7 +298,7 @@ public:
      * @param   m   A map of items to compare to the query.
      * @return      The number of items in the map that match the query.
      */
-    int compare(const std::map<K,V> &other) const {
+    int compare(const M &other) const {
         int count = 0;
         int result;
 
@@ -305,15 +347,15 @@ public:
 
     /** Check if std::map matches exactly with this query.
      */
-    bool operator==(const std::map<K,V> &other) {
+    bool operator==(const M &other) {
         // If the number of elements in the map is equal to the number of query elements that matched.
         return compare(other) == other.size();
     }
 
     /** Check if std::map matches exactly with this query.
      */
-    bool operator==(const MapQuery<K,V> &other) {
-        std::map<K,V> tmp = other.map();
+    bool operator==(const MapQuery<K,V,M> &other) {
+        M tmp = other.map();
 
         // If the number of elements in the map is equal to the number of query elements that matched.
         return compare(tmp) == tmp.size();
@@ -321,29 +363,38 @@ public:
 
     /** Check if std::map matches with this query.
      */
-    bool operator!=(const std::map<K,V> &other) {
+    bool operator!=(const M &other) {
         return !(*this == other);
     }
 
     /** Check if std::map matches with this query.
      */
-    bool operator!=(const MapQuery<K,V> &other) {
+    bool operator!=(const MapQuery<K,V,M> &other) {
         return !(*this == other);
     }
 
 };
 
+/** A map describing an object, such as {lib: work, ent: counter}.
+ * Objects have only a few of the same keys, and share the names of libraries.
+ */
+using DQMap = FlatMap<Symbol,Symbol,4>;
+
+/** A query for objects.
+ */
+using DQ = MapQuery<Symbol,Symbol,DQMap>;
+
 }}
 
 namespace std {
 
-template <class K, class V>
-static inline string to_string(const takevos::hurricane::MapQuery<K,V> &x) {
+template <class K, class V, class M>
+static inline string to_string(const takevos::hurricane::MapQuery<K,V,M> &x) {
     return x.string();
 }
 
-template <class K, class V>
-static inline ostream &operator<<(ostream &os, const takevos::hurricane::MapQuery<K,V> &x) {
+template <class K, class V, class M>
+static inline ostream &operator<<(ostream &os, const takevos::hurricane::MapQuery<K,V,M> &x) {
     os << std::to_string(x);
     return os;
 }
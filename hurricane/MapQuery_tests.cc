@@ -109,3 +109,38 @@ BOOST_AUTO_TEST_CASE(mapquery_compare_with_different_sizes_1)
 }
 
 
+
+BOOST_AUTO_TEST_CASE(mapquery_map_1)
+{
+    auto    r = DQ("lib", "work") & DQ("ent", "counter") & DQ("arch", "rtl");
+    DQMap   m = r.map();
+
+    BOOST_CHECK_EQUAL(m.size(), 3);
+    BOOST_CHECK(m.find("ent") != m.end());
+    BOOST_CHECK_EQUAL(m.find("ent")->second.string(), "counter");
+    BOOST_CHECK(m.find("pkg") == m.end());
+    BOOST_CHECK(r == m);
+}
+
+BOOST_AUTO_TEST_CASE(mapquery_map_with_many_items_1)
+{
+    std::map<std::string,std::string>   e;
+    DQ                                  r;
+
+    // More items than are stored inside the map itself.
+    for (int i = 0; i < 10; i++) {
+        e[std::to_string(i)] = std::to_string(i * i);
+        r &= DQ(std::to_string(i), std::to_string(i * i));
+    }
+
+    DQMap m = e;
+    BOOST_CHECK_EQUAL(m.size(), 10);
+    BOOST_CHECK(r == e);
+    BOOST_CHECK(m == r.map());
+    for (auto &x: e) {
+        BOOST_CHECK_EQUAL(m[x.first].string(), x.second);
+    }
+
+    e["5"] = "0";
+    BOOST_CHECK(r != e);
+}
@@ -0,0 +1,642 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdexcept>
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include "NFA.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** A node of the syntax tree of a regular expression.
+ * The syntax tree is compiled into NFA nodes after parsing, which
+ * allows bounded repetition to compile its sub tree multiple times.
+ */
+struct RegexNode {
+    static const int empty      = 1;    ///< Matches the empty string.
+    static const int byte_set   = 2;    ///< Matches a single byte from char_sets[arg].
+    static const int concat     = 3;    ///< Matches all children in sequence.
+    static const int alternate  = 4;    ///< Matches one of the children.
+    static const int repeat     = 5;    ///< Matches the first child between min and max times.
+    static const int group      = 6;    ///< Captures the first child in sub expression arg.
+    static const int bol        = 7;    ///< Matches at the beginning of a line.
+    static const int eol        = 8;    ///< Matches at the end of a line.
+
+    int                     type;
+    int                     arg;
+    int                     min;
+    int                     max;        ///< -1 means no maximum.
+    bool                    greedy;
+    std::vector<RegexNode>  children;
+
+    RegexNode(int type, int arg=0) : type(type), arg(arg), min(0), max(0), greedy(true) { }
+};
+
+/** A partially compiled piece of the NFA.
+ * The dangling outputs are patched to the next fragment once that is known.
+ */
+struct NFAFragment {
+    int                             start;
+    std::vector<std::pair<int,int>> outs;   ///< (node, 0 for out or 1 for out1)
+};
+
+/** Recursive descent parser for regular expressions.
+ */
+class RegexParser {
+public:
+    NFA             &nfa;
+    char const      *pattern;
+    size_t          offset;
+    int             nsub;
+
+    RegexParser(NFA &nfa, char const * const pattern) : nfa(nfa), pattern(pattern), offset(0), nsub(0) {
+    }
+
+    [[noreturn]] void error(std::string const &msg) {
+        throw std::invalid_argument(msg + " at offset " + std::to_string(offset));
+    }
+
+    char peek(void) const {
+        return pattern[offset];
+    }
+
+    bool at_end(void) const {
+        return pattern[offset] == '\0';
+    }
+
+    RegexNode parse(void) {
+        auto node = parse_alternate();
+        if (!at_end()) {
+            error("Unmatched ')'");
+        }
+        return node;
+    }
+
+    RegexNode parse_alternate(void) {
+        RegexNode node(RegexNode::alternate);
+
+        node.children.push_back(parse_concat());
+        while (peek() == '|') {
+            offset++;
+            node.children.push_back(parse_concat());
+        }
+        return node.children.size() == 1 ? node.children[0] : node;
+    }
+
+    RegexNode parse_concat(void) {
+        RegexNode node(RegexNode::concat);
+
+        while (!at_end() && peek() != '|' && peek() != ')') {
+            node.children.push_back(parse_repeat());
+        }
+
+        switch (node.children.size()) {
+        case 0:  return RegexNode(RegexNode::empty);
+        case 1:  return node.children[0];
+        default: return node;
+        }
+    }
+
+    RegexNode parse_repeat(void) {
+        auto atom = parse_atom();
+
+        while (true) {
+            int min;
+            int max;
+
+            switch (peek()) {
+            case '*': min = 0; max = -1; offset++; break;
+            case '+': min = 1; max = -1; offset++; break;
+            case '?': min = 0; max =  1; offset++; break;
+            case '{':
+                if (!isdigit(pattern[offset + 1])) {
+                    return atom;
+                }
+                offset++;
+                min = parse_number();
+                max = min;
+                if (peek() == ',') {
+                    offset++;
+                    max = isdigit(peek()) ? parse_number() : -1;
+                }
+                if (peek() != '}') {
+                    error("Expecting '}'");
+                }
+                offset++;
+                if (max != -1 && max < min) {
+                    error("Invalid repetition count");
+                }
+                break;
+            default:
+                return atom;
+            }
+
+            RegexNode node(RegexNode::repeat);
+            node.min = min;
+            node.max = max;
+            if (peek() == '?') {
+                // Non-greedy quantifier.
+                offset++;
+                node.greedy = false;
+            }
+            node.children.push_back(atom);
+            atom = node;
+        }
+    }
+
+    int parse_number(void) {
+        int r = 0;
+
+        while (isdigit(peek())) {
+            r = r * 10 + (pattern[offset++] - '0');
+            if (r > 255) {
+                error("Repetition count too large");
+            }
+        }
+        return r;
+    }
+
+    RegexNode byte_set(std::bitset<256> const &set) {
+        return RegexNode(RegexNode::byte_set, nfa.add_char_set(set));
+    }
+
+    RegexNode parse_atom(void) {
+        std::bitset<256> set;
+        char c = pattern[offset++];
+
+        switch (c) {
+        case '(':
+            if (peek() == '?') {
+                if (pattern[offset + 1] != ':') {
+                    error("Unsupported group type");
+                }
+                offset += 2;
+                auto node = parse_alternate();
+                if (peek() != ')') {
+                    error("Expecting ')'");
+                }
+                offset++;
+                return node;
+
+            } else {
+                RegexNode node(RegexNode::group, nsub++);
+                node.children.push_back(parse_alternate());
+                if (peek() != ')') {
+                    error("Expecting ')'");
+                }
+                offset++;
+                return node;
+            }
+
+        case '[':
+            return byte_set(parse_bracket());
+
+        case '.':
+            // With REG_NEWLINE semantics the '.' does not match a newline.
+            set.set();
+            set.reset('\n');
+            return byte_set(set);
+
+        case '^':
+            return RegexNode(RegexNode::bol);
+
+        case '$':
+            return RegexNode(RegexNode::eol);
+
+        case '\\':
+            return byte_set(parse_escape());
+
+        case '*':
+        case '+':
+        case '?':
+            offset--;
+            error("Repetition operator without operand");
+
+        default:
+            set.set((unsigned char)c);
+            return byte_set(set);
+        }
+    }
+
+    std::bitset<256> parse_escape(void) {
+        std::bitset<256>    set;
+        char                c = pattern[offset++];
+
+        switch (c) {
+        case '\0':
+            offset--;
+            error("Trailing backslash");
+        case 'd': case 'D':
+            add_class(set, "digit");
+            break;
+        case 's': case 'S':
+            add_class(set, "space");
+            break;
+        case 'w': case 'W':
+            add_class(set, "alnum");
+            set.set('_');
+            break;
+        case 'n': set.set('\n'); return set;
+        case 't': set.set('\t'); return set;
+        case 'r': set.set('\r'); return set;
+        case 'f': set.set('\f'); return set;
+        case 'v': set.set('\v'); return set;
+        case 'b': case 'B': case '<': case '>':
+            error("Word boundaries are not supported");
+        default:
+            set.set((unsigned char)c);
+            return set;
+        }
+
+        if (isupper(c)) {
+            // Negated class, which does not match a newline.
+            set.flip();
+            set.reset('\n');
+        }
+        return set;
+    }
+
+    void add_class(std::bitset<256> &set, std::string const &name) {
+        int (*f)(int);
+
+        if      (name == "alnum")  f = isalnum;
+        else if (name == "alpha")  f = isalpha;
+        else if (name == "blank")  f = isblank;
+        else if (name == "cntrl")  f = iscntrl;
+        else if (name == "digit")  f = isdigit;
+        else if (name == "graph")  f = isgraph;
+        else if (name == "lower")  f = islower;
+        else if (name == "print")  f = isprint;
+        else if (name == "punct")  f = ispunct;
+        else if (name == "space")  f = isspace;
+        else if (name == "upper")  f = isupper;
+        else if (name == "xdigit") f = isxdigit;
+        else error("Unknown character class '" + name + "'");
+
+        // Only ASCII is classified, so that the result does not depend on the locale.
+        for (int i = 0; i < 128; i++) {
+            if (f(i)) {
+                set.set(i);
+            }
+        }
+    }
+
+    std::bitset<256> parse_bracket(void) {
+        std::bitset<256>    set;
+        bool                negate = false;
+        bool                first = true;
+
+        if (peek() == '^') {
+            negate = true;
+            offset++;
+        }
+
+        while (true) {
+            int c = (unsigned char)pattern[offset++];
+
+            if (c == '\0') {
+                offset--;
+                error("Expecting ']'");
+
+            } else if (c == ']' && !first) {
+                break;
+
+            } else if (c == '[' && peek() == ':') {
+                auto end = strstr(&pattern[offset], ":]");
+                if (end == NULL) {
+                    error("Expecting ':]'");
+                }
+                add_class(set, std::string(&pattern[offset + 1], end - &pattern[offset + 1]));
+                offset = end - pattern + 2;
+
+            } else if (c == '[' && (peek() == '.' || peek() == '=') && pattern[offset + 1] != '\0' && pattern[offset + 2] == peek() && pattern[offset + 3] == ']') {
+                // Single character collating element or equivalence class.
+                set.set((unsigned char)pattern[offset + 1]);
+                offset += 4;
+
+            } else if (pattern[offset] == '-' && pattern[offset + 1] != ']' && pattern[offset + 1] != '\0') {
+                int last = (unsigned char)pattern[offset + 1];
+                if (last < c) {
+                    error("Invalid range");
+                }
+                for (int i = c; i <= last; i++) {
+                    set.set(i);
+                }
+                offset += 2;
+
+            } else {
+                set.set(c);
+            }
+            first = false;
+        }
+
+        if (negate) {
+            // With REG_NEWLINE semantics a negated bracket does not match a newline.
+            set.flip();
+            set.reset('\n');
+        }
+        return set;
+    }
+};
+
+/** Compile the syntax tree of a regular expression into NFA nodes.
+ */
+class RegexCompiler {
+public:
+    NFA             &nfa;
+
+    RegexCompiler(NFA &nfa) : nfa(nfa) {
+    }
+
+    void patch(std::vector<std::pair<int,int>> const &outs, int target) {
+        for (auto &x: outs) {
+            if (x.second == 0) {
+                nfa.nodes[x.first].out = target;
+            } else {
+                nfa.nodes[x.first].out1 = target;
+            }
+        }
+    }
+
+    NFAFragment single(int type, int arg=0) {
+        NFAFragment r;
+
+        r.start = nfa.add_node(type, arg);
+        r.outs.push_back(std::make_pair(r.start, 0));
+        return r;
+    }
+
+    NFAFragment sequence(NFAFragment a, NFAFragment const &b) {
+        patch(a.outs, b.start);
+        a.outs = b.outs;
+        return a;
+    }
+
+    NFAFragment optional(NFAFragment const &a, bool greedy) {
+        NFAFragment r;
+
+        r.start = nfa.add_node(NFANode::split);
+        if (greedy) {
+            nfa.nodes[r.start].out = a.start;
+            r.outs = a.outs;
+            r.outs.push_back(std::make_pair(r.start, 1));
+        } else {
+            nfa.nodes[r.start].out1 = a.start;
+            r.outs = a.outs;
+            r.outs.push_back(std::make_pair(r.start, 0));
+        }
+        return r;
+    }
+
+    NFAFragment star(NFAFragment const &a, bool greedy) {
+        auto r = optional(a, greedy);
+
+        // Loop the body back to the split, leaving only the split's exit dangling.
+        patch(a.outs, r.start);
+        r.outs.clear();
+        r.outs.push_back(std::make_pair(r.start, greedy ? 1 : 0));
+        return r;
+    }
+
+    NFAFragment compile(RegexNode const &node) {
+        switch (node.type) {
+        case RegexNode::empty:
+            return single(NFANode::jump);
+
+        case RegexNode::byte_set:
+            return single(NFANode::byte_set, node.arg);
+
+        case RegexNode::bol:
+            return single(NFANode::bol);
+
+        case RegexNode::eol:
+            return single(NFANode::eol);
+
+        case RegexNode::concat: {
+            auto r = compile(node.children[0]);
+            for (size_t i = 1; i < node.children.size(); i++) {
+                r = sequence(r, compile(node.children[i]));
+            }
+            return r;
+        }
+
+        case RegexNode::alternate: {
+            // A chain of splits, earlier alternatives are preferred.
+            auto r = compile(node.children.back());
+            for (size_t i = node.children.size() - 1; i > 0; i--) {
+                auto a = compile(node.children[i - 1]);
+                NFAFragment tmp;
+
+                tmp.start = nfa.add_node(NFANode::split);
+                nfa.nodes[tmp.start].out = a.start;
+                nfa.nodes[tmp.start].out1 = r.start;
+                tmp.outs = a.outs;
+                tmp.outs.insert(tmp.outs.end(), r.outs.begin(), r.outs.end());
+                r = tmp;
+            }
+            return r;
+        }
+
+        case RegexNode::group: {
+            auto r = single(NFANode::save, node.arg * 2);
+            r = sequence(r, compile(node.children[0]));
+            return sequence(r, single(NFANode::save, node.arg * 2 + 1));
+        }
+
+        case RegexNode::repeat: {
+            auto r = single(NFANode::jump);
+
+            for (int i = 0; i < node.min; i++) {
+                r = sequence(r, compile(node.children[0]));
+            }
+
+            if (node.max == -1) {
+                r = sequence(r, star(compile(node.children[0]), node.greedy));
+
+            } else {
+                // Nest the optional copies so that a later copy is only tried after an earlier one matched.
+                std::vector<NFAFragment> copies;
+                for (int i = node.min; i < node.max; i++) {
+                    copies.push_back(compile(node.children[0]));
+                }
+                if (copies.size() > 0) {
+                    auto tail = optional(copies.back(), node.greedy);
+                    for (size_t i = copies.size() - 1; i > 0; i--) {
+                        tail = optional(sequence(copies[i - 1], tail), node.greedy);
+                    }
+                    r = sequence(r, tail);
+                }
+            }
+            return r;
+        }
+
+        default:
+            throw std::logic_error("Unknown regex node type.");
+        }
+    }
+};
+
+bool NFA::has_bol(void) const
+{
+    for (auto &node: nodes) {
+        if (node.type == NFANode::bol) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int NFA::add_node(int type, int arg)
+{
+    nodes.push_back(NFANode(type, arg));
+    return (int)nodes.size() - 1;
+}
+
+int NFA::add_char_set(std::bitset<256> const &char_set)
+{
+    for (size_t i = 0; i < char_sets.size(); i++) {
+        if (char_sets[i] == char_set) {
+            return (int)i;
+        }
+    }
+
+    char_sets.push_back(char_set);
+    return (int)char_sets.size() - 1;
+}
+
+int NFA::add_pattern(char const * const pattern)
+{
+    RegexParser     parser(*this, pattern);
+    RegexCompiler   compiler(*this);
+
+    auto tree = parser.parse();
+    auto fragment = compiler.compile(tree);
+    auto accept = add_node(NFANode::accept, (int)pattern_starts.size());
+    compiler.patch(fragment.outs, accept);
+
+    pattern_starts.push_back(fragment.start);
+    pattern_nsubs.push_back(parser.nsub);
+    return parser.nsub;
+}
+
+/** A step of the backtracking search in NFA::capture().
+ */
+struct NFACaptureJob {
+    int     node;   ///< Node to continue at, or -1 to restore a slot.
+    long    pos;    ///< Position in the text, or the slot to restore.
+    long    value;  ///< Previous value of the slot to restore.
+};
+
+/** Memory used by NFA::capture(), kept between calls on the same thread.
+ */
+struct NFACaptureScratch {
+    std::vector<bool>           visited;        ///< Set for each (node, position) pair that was tried.
+    std::vector<NFACaptureJob>  jobs;           ///< Stack of alternatives still to try.
+};
+
+static thread_local NFACaptureScratch NFA_capture_scratch;
+
+bool NFA::capture(int pattern, char const * const text, size_t text_size, size_t begin, size_t end, long slots[]) const
+{
+    using Job = NFACaptureJob;
+
+    // Backtrack in priority order, remembering which (node, position) pairs
+    // were already tried, so that the search is linear in the size of the match.
+    auto                width = end - begin + 1;
+    auto                &scratch = NFA_capture_scratch;
+    auto                &visited = scratch.visited;
+    auto                &jobs = scratch.jobs;
+
+    // Only the part of the visited table used by this call is cleared.
+    if (visited.size() < nodes.size() * width) {
+        visited.resize(nodes.size() * width);
+    }
+    std::fill(visited.begin(), visited.begin() + nodes.size() * width, false);
+    jobs.clear();
+
+    std::fill(slots, slots + pattern_nsubs[pattern] * 2, -1);
+    jobs.push_back(Job{pattern_starts[pattern], (long)begin, 0});
+
+    while (!jobs.empty()) {
+        auto job = jobs.back();
+        jobs.pop_back();
+
+        if (job.node == -1) {
+            slots[job.pos] = job.value;
+            continue;
+        }
+
+        int     i = job.node;
+        long    pos = job.pos;
+        while (true) {
+            auto visit_index = i * width + (pos - begin);
+            if (visited[visit_index]) {
+                break;
+            }
+            visited[visit_index] = true;
+
+            auto &node = nodes[i];
+            bool ok = true;
+
+            switch (node.type) {
+            case NFANode::byte_set:
+                ok = (size_t)pos < end && char_sets[node.arg][(unsigned char)text[pos]];
+                pos++;
+                break;
+            case NFANode::split:
+                jobs.push_back(Job{node.out1, pos, 0});
+                break;
+            case NFANode::jump:
+                break;
+            case NFANode::save:
+                jobs.push_back(Job{-1, node.arg, slots[node.arg]});
+                slots[node.arg] = pos;
+                break;
+            case NFANode::bol:
+                ok = pos == 0 || text[pos - 1] == '\n';
+                break;
+            case NFANode::eol:
+                ok = (size_t)pos == text_size || text[pos] == '\n';
+                break;
+            case NFANode::accept:
+                if ((size_t)pos == end) {
+                    return true;
+                }
+                ok = false;
+                break;
+            }
+
+            if (!ok) {
+                break;
+            }
+            i = node.out;
+        }
+    }
+    return false;
+}
+
+}}
@@ -0,0 +1,110 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_NFA_H
+#define TAKEVOS_HURRICANE_NFA_H
+#include <stdbool.h>
+#include <string>
+#include <vector>
+#include <bitset>
+
+namespace takevos {
+namespace hurricane {
+
+/** A single instruction of a Thompson NFA.
+ */
+struct NFANode {
+    static const int byte_set   = 1;    ///< Consume a byte that is a member of char_sets[arg].
+    static const int split      = 2;    ///< Continue at out (preferred) and at out1.
+    static const int jump       = 3;    ///< Continue at out without consuming a byte.
+    static const int save       = 4;    ///< Store the current position in capture slot arg.
+    static const int bol        = 5;    ///< Assert the beginning of a line.
+    static const int eol        = 6;    ///< Assert the end of a line.
+    static const int accept     = 7;    ///< Pattern arg has matched.
+
+    int     type;   ///< One of the instruction types above.
+    int     out;    ///< Next node.
+    int     out1;   ///< Alternative next node, only used by split.
+    int     arg;    ///< Character set, capture slot or pattern index.
+
+    NFANode(int type, int arg) : type(type), out(-1), out1(-1), arg(arg) { }
+};
+
+/** A set of regular expressions compiled into a single Thompson NFA.
+ *
+ * The supported syntax is the POSIX extended regular expression syntax with
+ * REG_NEWLINE semantics, together with the extensions that are used by the
+ * patterns in this project: the \\s, \\S, \\w, \\W, \\d, \\D escapes,
+ * non-capturing groups (?:...) and non-greedy quantifiers.
+ *
+ * The NFA is used to build a DFA for finding matches, and afterwards
+ * to extract the sub expressions of only the pattern that matched.
+ */
+class NFA {
+public:
+    std::vector<NFANode>            nodes;          ///< All instructions of all patterns.
+    std::vector<std::bitset<256>>   char_sets;      ///< Sets of bytes used by byte_set instructions.
+    std::vector<int>                pattern_starts; ///< The first instruction of each pattern.
+    std::vector<int>                pattern_nsubs;  ///< The number of capturing sub expressions of each pattern.
+
+    /** Compile a pattern and add it to the NFA.
+     * Throws std::invalid_argument when the pattern can not be parsed.
+     *
+     * @param pattern   A regular expression.
+     * @return          The number of capturing sub expressions in the pattern.
+     */
+    int add_pattern(char const * const pattern);
+
+    /** Extract the captured sub expressions of a match.
+     * The DFA only finds where a pattern matched, this function finds
+     * the positions of the sub expressions for that specific match.
+     *
+     * @param pattern       Index of the pattern that matched.
+     * @param text          The text that was searched.
+     * @param text_size     The size of the text.
+     * @param begin         The start of the match in the text.
+     * @param end           The end of the match in the text.
+     * @param slots         Returns a start and end offset for each sub expression, -1 when not used.
+     *                      Must have room for two entries for each sub expression of the pattern.
+     * @return true when the pattern matches exactly between begin and end.
+     */
+    bool capture(int pattern, char const * const text, size_t text_size, size_t begin, size_t end, long slots[]) const;
+
+    /** Check if any pattern uses the beginning of line assertion '^'.
+     */
+    bool has_bol(void) const;
+
+    /** Add a node to the NFA.
+     * @return The index of the new node.
+     */
+    int add_node(int type, int arg=0);
+
+    /** Add a character set, reusing an identical set when possible.
+     * @return The index of the character set.
+     */
+    int add_char_set(std::bitset<256> const &char_set);
+};
+
+}}
+#endif
@@ -24,12 +24,17 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <stdarg.h>
 
 #include "utils.h"
 #include "options.h"
+#include "ContentHash.h"
+#include "ThreadPool.h"
+#include "FileHandle.h"
+#include "FileLoader.h"
 
 namespace takevos {
 namespace hurricane {
@@ -45,6 +50,28 @@ Options::Options(void) {
     target              = "all";
     library_filename    = "hurricane.ini";
     compilation_mode    = simulation;
+    tokenizer           = dfa_tokenizer;
+    hash_algorithm      = ContentHash::fast;
+    jobs                = 0;
+    file_loader         = FileLoader::best_loader;
+    mmap_threshold      = FileHandle::default_mmap_threshold;
+    cache_directory     = default_cache_directory();
+    benchmark_tokenizers = false;
+}
+
+fs::path Options::default_cache_directory(void) {
+    if (auto xdg_cache_home = getenv("XDG_CACHE_HOME")) {
+        return fs::path(xdg_cache_home) / "hurricane";
+    }
+
+    if (auto home = getenv("HOME")) {
+#ifdef __APPLE__
+        return fs::path(home) / "Library" / "Caches" / "hurricane";
+#else
+        return fs::path(home) / ".cache" / "hurricane";
+#endif
+    }
+    return fs::path();
 }
 
 void Options::usage(void) {
@@ -60,8 +87,24 @@ void Options::usage(void) {
     fprintf(stderr, "    -m, --compilation-mode=<mode>          Compilation mode, default is simulation.\n");
     fprintf(stderr, "                                           simulation - build for simulation.\n");
     fprintf(stderr, "                                           synthesis - build for synthesis.\n");
+    fprintf(stderr, "    -T, --tokenizer=<tokenizer>            Tokenizer for VHDL files, default is dfa.\n");
+    fprintf(stderr, "                                           dfa - patterns compiled into a DFA.\n");
+    fprintf(stderr, "                                           posix - patterns compiled by regcomp().\n");
+    fprintf(stderr, "                                           lexer - hand-written VHDL lexer.\n");
+    fprintf(stderr, "    -j, --jobs=<number>                    Number of files processed concurrently, default is one per CPU.\n");
+    fprintf(stderr, "    -L, --file-loader=<loader>             How files are read, default is best.\n");
+    fprintf(stderr, "                                           best - uring when the kernel supports it, otherwise pread.\n");
+    fprintf(stderr, "                                           uring - batches of files at once through io_uring.\n");
+    fprintf(stderr, "                                           pread - one file at a time in each job.\n");
+    fprintf(stderr, "    -M, --mmap-threshold=<bytes>           Files of at least this size are mapped, smaller files are read. (%zu)\n", mmap_threshold);
+    fprintf(stderr, "    -H, --hash=<algorithm>                 Hash to detect changes to files, default is fast.\n");
+    fprintf(stderr, "                                           fast - fast non-cryptographic hash.\n");
+    fprintf(stderr, "                                           md5 - MD5.\n");
+    fprintf(stderr, "    -B, --benchmark-tokenizers             Run each tokenizer on the VHDL files in the working directory,\n");
+    fprintf(stderr, "                                           report the throughput and if the tokens agree.\n");
     fprintf(stderr, "    -C, --working-directory=<directory>    Change working directory. (%s)\n", working_directory.string().c_str());
     fprintf(stderr, "    -F, --library-filename=<directory>     The name of a library filename. (%s)\n", library_filename.string().c_str());
+    fprintf(stderr, "    -K, --cache-directory=<directory>      Directory for compiled patterns, empty to disable. (%s)\n", cache_directory.string().c_str());
 }
 
 void Options::post_process(void) {
@@ -119,6 +162,13 @@ void Options::parse(int argc, char *argv[]) {
         {"working-directory",   required_argument,  NULL, 'C'},
         {"library-filename",    required_argument,  NULL, 'F'},
         {"compilation-mode",    required_argument,  NULL, 'm'},
+        {"tokenizer",           required_argument,  NULL, 'T'},
+        {"hash",                required_argument,  NULL, 'H'},
+        {"jobs",                required_argument,  NULL, 'j'},
+        {"file-loader",         required_argument,  NULL, 'L'},
+        {"mmap-threshold",      required_argument,  NULL, 'M'},
+        {"benchmark-tokenizers", no_argument,       NULL, 'B'},
+        {"cache-directory",     required_argument,  NULL, 'K'},
         {NULL, 0, NULL, 0}
     };
 
@@ -126,7 +176,7 @@ void Options::parse(int argc, char *argv[]) {
 
     application = argv[0];
 
-    while ((ch = getopt_long(argc, argv, "hvC:F:", longopts, NULL)) != -1) {
+    while ((ch = getopt_long(argc, argv, "hvm:C:F:T:H:j:L:M:BK:", longopts, NULL)) != -1) {
         switch (ch) {
         case 'h':
             usage();
@@ -150,6 +200,74 @@ void Options::parse(int argc, char *argv[]) {
                 usage();
                 exit(2);
             }
+            break;
+
+        case 'T':
+            if (string("dfa") == optarg) {
+                tokenizer = dfa_tokenizer;
+
+            } else if (string("posix") == optarg) {
+                tokenizer = posix_tokenizer;
+
+            } else if (string("lexer") == optarg) {
+                tokenizer = lexer_tokenizer;
+
+            } else {
+                log(LOG_ERROR "Unknown tokenizer %s", optarg);
+                usage();
+                exit(2);
+            }
+            break;
+
+        case 'H':
+            hash_algorithm = ContentHash::algorithm_by_name(optarg);
+            if (hash_algorithm == ContentHash::none) {
+                log(LOG_ERROR "Unknown hash algorithm %s", optarg);
+                usage();
+                exit(2);
+            }
+            break;
+
+        case 'j': {
+                char *end;
+                auto n = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || n < 1) {
+                    log(LOG_ERROR "Invalid number of jobs %s", optarg);
+                    usage();
+                    exit(2);
+                }
+                jobs = n;
+            }
+            break;
+
+        case 'L':
+            file_loader = FileLoader::loader_by_name(optarg);
+            if (file_loader == -1) {
+                log(LOG_ERROR "Unknown file loader %s", optarg);
+                usage();
+                exit(2);
+            }
+            if (file_loader == FileLoader::uring_loader && !FileLoader::uring_supported()) {
+                log(LOG_ERROR "The file loader uring is not supported by this kernel");
+                exit(2);
+            }
+            break;
+
+        case 'M': {
+                char *end;
+                auto n = strtoll(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || n < 0) {
+                    log(LOG_ERROR "Invalid mmap threshold %s", optarg);
+                    usage();
+                    exit(2);
+                }
+                mmap_threshold = n;
+            }
+            break;
+
+        case 'B':
+            benchmark_tokenizers = true;
+            break;
 
         case 'C':
             working_directory = fs::absolute(optarg);
@@ -160,6 +278,10 @@ void Options::parse(int argc, char *argv[]) {
             library_filename = fs::path(optarg).filename();
             break;
 
+        case 'K':
+            cache_directory = optarg[0] != '\0' ? fs::absolute(optarg) : fs::path();
+            break;
+
         case ':':
             usage();
             exit(2);
@@ -188,6 +310,9 @@ void Options::parse(int argc, char *argv[]) {
         usage();
         exit(2);
     }
+
+    ThreadPool::shared_nr_jobs = jobs;
+    FileHandle::mmap_threshold = mmap_threshold;
 }
 
 }}
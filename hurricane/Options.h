@@ -44,6 +44,9 @@ class Options {
 public:
     static const int        simulation  = 1;
     static const int        synthesis   = 2;
+    static const int        dfa_tokenizer   = 1;
+    static const int        lexer_tokenizer = 2;
+    static const int        posix_tokenizer = 3;
 
     std::string             application;
     char                    verbose;
@@ -52,10 +55,22 @@ public:
     fs::path                project_directory;
     fs::path                current_library_directory;
     fs::path                library_filename;
+    fs::path                cache_directory;
     int                     compilation_mode;
+    int                     tokenizer;
+    int                     hash_algorithm; ///< Algorithm to detect changes to files, see ContentHash.
+    size_t                  jobs;       ///< Number of tasks executed concurrently, 0 for one per CPU, see ThreadPool.
+    int                     file_loader; ///< How files are read when they are processed, see FileLoader.
+    size_t                  mmap_threshold; ///< Files of at least this size are mapped instead of read, see FileHandle.
+    bool                    benchmark_tokenizers;
 
     Options(void);
 
+    /** The directory for cache files of the user, as used by the TokenizerCache.
+     * @return $XDG_CACHE_HOME/hurricane or its platform equivalent, empty when there is no home directory.
+     */
+    static fs::path default_cache_directory(void);
+
     /** Post process the options.
      * Secondary information is gathered.
      */
@@ -0,0 +1,183 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HURRICANE_PREFILTER_X86 1
+#endif
+#include "Prefilter.h"
+
+namespace takevos {
+namespace hurricane {
+
+Prefilter::Prefilter()
+{
+    memset(members, 0, sizeof (members));
+    memset(low_nibble_table, 0, sizeof (low_nibble_table));
+    memset(high_nibble_table, 0, sizeof (high_nibble_table));
+}
+
+Prefilter::Prefilter(std::bitset<256> const &stop_bytes)
+{
+    std::vector<uint16_t>   bucket_low_nibbles;
+
+    memset(members, 0, sizeof (members));
+    memset(low_nibble_table, 0, sizeof (low_nibble_table));
+    memset(high_nibble_table, 0, sizeof (high_nibble_table));
+
+    for (int high = 0; high < 16; high++) {
+        uint16_t low_nibbles = 0;
+
+        for (int low = 0; low < 16; low++) {
+            if (stop_bytes[high << 4 | low]) {
+                members[high << 4 | low] = 1;
+                low_nibbles |= 1 << low;
+            }
+        }
+
+        if (low_nibbles == 0) {
+            continue;
+        }
+
+        // Each bucket is a set of low nibbles shared by one or more high nibbles.
+        // When there are more than 8 different sets, the last bucket becomes a
+        // superset, which is fine because candidates are checked against members.
+        auto i = std::find(bucket_low_nibbles.begin(), bucket_low_nibbles.end(), low_nibbles);
+        size_t bucket = i - bucket_low_nibbles.begin();
+        if (i == bucket_low_nibbles.end()) {
+            bucket = std::min(bucket_low_nibbles.size(), (size_t)7);
+            if (bucket == bucket_low_nibbles.size()) {
+                bucket_low_nibbles.push_back(low_nibbles);
+            }
+        }
+
+        high_nibble_table[high] |= 1 << bucket;
+        for (int low = 0; low < 16; low++) {
+            if (low_nibbles & (1 << low)) {
+                low_nibble_table[low] |= 1 << bucket;
+            }
+        }
+    }
+}
+
+static size_t Prefilter_find_scalar(Prefilter const &self, uint8_t const * const text, size_t text_size, size_t offset)
+{
+    for (; offset < text_size; offset++) {
+        if (self.members[text[offset]]) {
+            return offset;
+        }
+    }
+    return text_size;
+}
+
+#ifdef HURRICANE_PREFILTER_X86
+__attribute__((target("ssse3")))
+static size_t Prefilter_find_ssse3(Prefilter const &self, uint8_t const * const text, size_t text_size, size_t offset)
+{
+    auto low_table = _mm_loadu_si128((__m128i const *)self.low_nibble_table);
+    auto high_table = _mm_loadu_si128((__m128i const *)self.high_nibble_table);
+    auto nibble_mask = _mm_set1_epi8(0x0f);
+    auto zero = _mm_setzero_si128();
+
+    for (; offset + 16 <= text_size; offset += 16) {
+        auto data = _mm_loadu_si128((__m128i const *)&text[offset]);
+        auto low = _mm_shuffle_epi8(low_table, _mm_and_si128(data, nibble_mask));
+        auto high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(data, 4), nibble_mask));
+        unsigned int candidates = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(low, high), zero)) & 0xffff;
+
+        while (candidates) {
+            auto i = offset + __builtin_ctz(candidates);
+            if (self.members[text[i]]) {
+                return i;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+    return Prefilter_find_scalar(self, text, text_size, offset);
+}
+
+__attribute__((target("avx2")))
+static size_t Prefilter_find_avx2(Prefilter const &self, uint8_t const * const text, size_t text_size, size_t offset)
+{
+    auto low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)self.low_nibble_table));
+    auto high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)self.high_nibble_table));
+    auto nibble_mask = _mm256_set1_epi8(0x0f);
+    auto zero = _mm256_setzero_si256();
+
+    for (; offset + 32 <= text_size; offset += 32) {
+        auto data = _mm256_loadu_si256((__m256i const *)&text[offset]);
+        auto low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(data, nibble_mask));
+        auto high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(data, 4), nibble_mask));
+        unsigned int candidates = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(low, high), zero));
+
+        while (candidates) {
+            auto i = offset + __builtin_ctz(candidates);
+            if (self.members[text[i]]) {
+                return i;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+    return Prefilter_find_ssse3(self, text, text_size, offset);
+}
+#endif
+
+size_t Prefilter::find(char const * const text, size_t text_size, size_t offset, int implementation) const
+{
+    auto _text = (uint8_t const *)text;
+
+    switch (implementation) {
+#ifdef HURRICANE_PREFILTER_X86
+    case avx2:
+        return Prefilter_find_avx2(*this, _text, text_size, offset);
+    case ssse3:
+        return Prefilter_find_ssse3(*this, _text, text_size, offset);
+#endif
+    default:
+        return Prefilter_find_scalar(*this, _text, text_size, offset);
+    }
+}
+
+int Prefilter::best_implementation(void)
+{
+    static const int implementation = []() {
+#ifdef HURRICANE_PREFILTER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return avx2;
+        } else if (__builtin_cpu_supports("ssse3")) {
+            return ssse3;
+        }
+#endif
+        return scalar;
+    }();
+
+    return implementation;
+}
+
+}}
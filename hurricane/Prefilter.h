@@ -0,0 +1,80 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_PREFILTER_H
+#define TAKEVOS_HURRICANE_PREFILTER_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <bitset>
+
+namespace takevos {
+namespace hurricane {
+
+/** Find the first byte in a text that is a member of a set.
+ * This is used to skip over text that can not change the state of the DFA.
+ *
+ * The set is encoded into two 16 entry tables indexed by the low and high
+ * nibble of a byte, so that 16 or 32 bytes can be classified at once
+ * with the SSSE3 or AVX2 byte shuffle instruction. The implementation is
+ * selected at run time based on the CPU, with a scalar fallback.
+ */
+class Prefilter {
+public:
+    static const int scalar = 0;            ///< Portable implementation.
+    static const int ssse3  = 1;            ///< 16 bytes at a time using SSSE3.
+    static const int avx2   = 2;            ///< 32 bytes at a time using AVX2.
+
+    uint8_t     members[256];               ///< Non-zero for each byte in the set.
+    uint8_t     low_nibble_table[16];       ///< Bucket bits for each low nibble.
+    uint8_t     high_nibble_table[16];      ///< Bucket bits for each high nibble.
+
+    Prefilter();
+
+    /** Create a prefilter for a set of bytes.
+     * @param stop_bytes    The bytes to search for.
+     */
+    Prefilter(std::bitset<256> const &stop_bytes);
+
+    /** Find the first byte in the set.
+     * @param text          The text to search.
+     * @param text_size     The size of the text.
+     * @param offset        The offset to start searching.
+     * @return The offset of the first byte in the set, or text_size when not found.
+     */
+    size_t find(char const * const text, size_t text_size, size_t offset) const {
+        return find(text, text_size, offset, best_implementation());
+    }
+
+    /** Find the first byte in the set using a specific implementation.
+     * @param implementation    One of scalar, ssse3 or avx2, which must be supported by the CPU.
+     */
+    size_t find(char const * const text, size_t text_size, size_t offset, int implementation) const;
+
+    /** The fastest implementation supported by this CPU.
+     */
+    static int best_implementation(void);
+};
+
+}}
+#endif
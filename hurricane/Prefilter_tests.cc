@@ -0,0 +1,77 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE Prefilter
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <stdlib.h>
+#include <string>
+#include "Prefilter.h"
+
+using namespace takevos::hurricane;
+
+BOOST_AUTO_TEST_CASE(prefilter_newline_1)
+{
+    std::bitset<256>    stop_bytes;
+    stop_bytes['\n'] = true;
+    Prefilter           p(stop_bytes);
+    std::string         test = "-- a comment that is longer than a single vector of 32 bytes\nfoo";
+
+    for (int implementation = 0; implementation <= Prefilter::best_implementation(); implementation++) {
+        BOOST_CHECK_EQUAL(p.find(test.data(), test.size(), 0, implementation), test.find('\n'));
+        BOOST_CHECK_EQUAL(p.find(test.data(), test.size(), test.find('\n') + 1, implementation), test.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(prefilter_random_1)
+{
+    srandom(1);
+
+    for (int round = 0; round < 200; round++) {
+        std::bitset<256>    stop_bytes;
+        std::string         test;
+
+        // Sets with many different low nibble patterns are only approximated by the tables.
+        auto nr_stop_bytes = 1 + random() % 40;
+        for (int i = 0; i < nr_stop_bytes; i++) {
+            stop_bytes[random() % 256] = true;
+        }
+        auto text_size = random() % 300;
+        for (int i = 0; i < text_size; i++) {
+            auto c = (char)(random() % 256);
+            test.push_back(stop_bytes[(uint8_t)c] && random() % 8 ? 'x' : c);
+        }
+
+        Prefilter p(stop_bytes);
+        for (size_t offset = 0; offset <= test.size(); offset += 1 + random() % 40) {
+            auto expected = p.find(test.data(), test.size(), offset, Prefilter::scalar);
+            BOOST_REQUIRE(expected == test.size() || stop_bytes[(uint8_t)test[expected]]);
+
+            for (int implementation = 0; implementation <= Prefilter::best_implementation(); implementation++) {
+                BOOST_CHECK_EQUAL(p.find(test.data(), test.size(), offset, implementation), expected);
+            }
+        }
+    }
+}
@@ -23,17 +23,39 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <exception>
-#include <thread>
+#include <algorithm>
 #include "SourceFile.h"
 #include "Options.h"
 #include "FileHandle.h"
+#include "FileLoader.h"
+#include "FileStatCache.h"
+#include "ThreadPool.h"
+#include "TokenizerCache.h"
 #include "md5.h"
+#include "strings.h"
 
 namespace takevos {
 namespace hurricane {
 
+/** Number of files that are opened and hashed together by SourceFile::process_files().
+ */
+static const size_t SourceFile_batch_size = 64;
+
+/** Size of the blocks in which a text is hashed while it is parsed, small enough to stay in the L2 cache.
+ */
+static const size_t SourceFile_hash_block_size = 64 * 1024;
+
+/** The version of the record of a file.
+ * Increment when the format of the record, or the result of parsing changes.
+ */
+static const uint32_t SourceFile_record_version = 1;
+
+/** Identifies the record of a file.
+ */
+static const char SourceFile_record_magic[8] = {'H', 'R', 'C', 'R', 'E', 'C', 'R', 'D'};
+
 SourceFile::SourceFile(fs::path const &filename) :
-    filename(filename)
+    filename(filename), from_record(false), hasher(NULL), hash_text(NULL), hash_text_size(0), hashed_size(0), has_file_stat(false)
 {
 }
 
@@ -41,23 +63,333 @@ SourceFile::~SourceFile()
 {
 }
 
+void SourceFile::hash_until(size_t offset)
+{
+    if (hasher == NULL || offset < hashed_size + SourceFile_hash_block_size) {
+        return;
+    }
+
+    auto size = std::min(offset, hash_text_size) - hashed_size;
+    size -= size % SourceFile_hash_block_size;
+    hasher->update(&hash_text[hashed_size], size);
+    hashed_size += size;
+}
+
+ContentHasher *SourceFile::take_hasher(void)
+{
+    if (hasher == NULL || hashed_size > 0) {
+        return NULL;
+    }
+
+    hashed_size = hash_text_size;
+    return hasher;
+}
+
+void SourceFile::parse_and_hash(char const * const text, size_t text_size)
+{
+    ContentHasher hasher(options.hash_algorithm);
+
+    this->hasher = &hasher;
+    hash_text = text;
+    hash_text_size = text_size;
+    hashed_size = 0;
+
+    try {
+        parse(text, text_size);
+    } catch (...) {
+        this->hasher = NULL;
+        throw;
+    }
+
+    // The text after the last token.
+    hasher.update(&text[hashed_size], text_size - hashed_size);
+    content_hash = hasher.final();
+    this->hasher = NULL;
+}
+
+/** The key of a record file, which also depends on the format of the file.
+ */
+static uint128_t SourceFile_record_key(uint128_t key)
+{
+    MD5Hasher hasher;
+
+    hasher.value(key);
+    hasher.value(SourceFile_record_version);
+    hasher.value((int32_t)options.hash_algorithm);
+    hasher.value((uint32_t)sizeof (FileStat));
+    hasher.value((uint32_t)sizeof (size_t));
+    return hasher.final();
+}
+
+bool SourceFile::load_record(void)
+{
+    from_record = false;
+    // Always from the file system, a cached result may be from before the file was changed.
+    auto entry = FileStatCache::shared().refresh(filename);
+    has_file_stat = entry.found;
+    file_stat = entry.stat;
+
+    auto record_filename = cache_filename(".record");
+    if (!has_file_stat || record_filename.empty()) {
+        return false;
+    }
+
+    std::string         record_path;
+    FileStat            record_stat;
+    int64_t             recorded_ns;
+    int32_t             record_algorithm;
+    uint128_t           record_hash;
+    std::vector<DQ>     record_needs;
+    std::vector<size_t> record_need_offsets;
+    std::vector<DQMap>  record_provides;
+
+    auto valid = TokenizerCache::read_file(record_filename, SourceFile_record_magic, SourceFile_record_key(record_key()), [&](TokenizerCacheReader &reader) {
+        uint64_t nr_needs;
+        uint64_t nr_provides;
+
+        reader.string(record_path);
+        reader.value(record_stat);
+        reader.value(recorded_ns);
+        reader.value(record_algorithm);
+        reader.value(record_hash);
+
+        reader.value(nr_needs);
+        for (uint64_t i = 0; i < nr_needs; i++) {
+            record_needs.emplace_back();
+            record_needs.back().read(reader);
+        }
+        reader.vector(record_need_offsets);
+
+        reader.value(nr_provides);
+        for (uint64_t i = 0; i < nr_provides; i++) {
+            uint64_t nr_items;
+
+            record_provides.emplace_back();
+            reader.value(nr_items);
+            for (uint64_t j = 0; j < nr_items; j++) {
+                std::string key;
+                std::string value;
+                reader.string(key);
+                reader.string(value);
+                record_provides.back()[key] = value;
+            }
+        }
+    });
+
+    if (!valid || record_path != fs::absolute(filename).string() || !(record_stat == file_stat)) {
+        return false;
+    }
+
+    auto record_content_hash = ContentHash(record_algorithm, record_hash);
+    auto racy = file_stat.is_racy(recorded_ns);
+    if (racy) {
+        // The file may have been modified again after the record was written, without changing its metadata.
+        FileHandle handle(filename);
+
+        handle.open();
+        auto hash = ContentHash::hash(record_algorithm, handle.data, handle.data_size);
+        handle.close();
+        if (hash != record_content_hash) {
+            return false;
+        }
+    }
+
+    content_hash = record_content_hash;
+    needs = std::move(record_needs);
+    need_offsets = std::move(record_need_offsets);
+    provides = std::move(record_provides);
+    from_record = true;
+
+    if (racy) {
+        // With a later time in the record the contents do not need to be verified next time.
+        save_record();
+    }
+    return true;
+}
+
+void SourceFile::save_record(void) const
+{
+    auto record_filename = cache_filename(".record");
+    if (!has_file_stat || record_filename.empty()) {
+        return;
+    }
+
+    TokenizerCacheWriter writer;
+
+    writer.string(fs::absolute(filename).string());
+    writer.value(file_stat);
+    writer.value(FileStat::now_ns());
+    writer.value((int32_t)content_hash.algorithm);
+    writer.value(content_hash.value);
+
+    writer.value((uint64_t)needs.size());
+    for (auto &need: needs) {
+        need.write(writer);
+    }
+    writer.vector(need_offsets);
+
+    writer.value((uint64_t)provides.size());
+    for (auto &provide: provides) {
+        writer.value((uint64_t)provide.size());
+        for (auto &item: provide) {
+            writer.string(item.first.string());
+            writer.string(item.second.string());
+        }
+    }
+
+    // The record is only an optimization, the next invocation will try again.
+    try {
+        fs::create_directories(record_filename.parent_path());
+        TokenizerCache::write_file(record_filename, SourceFile_record_magic, SourceFile_record_key(record_key()), writer);
+    } catch (std::exception &) {
+    }
+}
+
 void SourceFile::process_file(void)
+{
+    if (load_record()) {
+        return;
+    }
+
+    parse_file();
+}
+
+void SourceFile::parse_file(void)
 {
     FileHandle handle(filename);
 
     handle.open();
+    parse_and_hash(handle.data, handle.data_size);
+    handle.close();
+    save_record();
+}
 
-    auto parse_thread = std::thread([this,&handle](){
-        parse(handle.data, handle.data_size);
-    });
+void SourceFile::process_batch(std::vector<SourceFile *> const &source_files, size_t begin, size_t end)
+{
+    auto                                        &pool = ThreadPool::shared();
+    ThreadPoolGroup                             group;
+    std::vector<SourceFile *>                   changed;
+    std::vector<std::unique_ptr<FileHandle>>    handles;
+    std::vector<char const *>                   data;
+    std::vector<size_t>                         data_size;
+
+    for (auto i = begin; i < end; i++) {
+        if (!source_files[i]->load_record()) {
+            changed.push_back(source_files[i]);
+        }
+    }
+
+    std::vector<ContentHash> hashes(changed.size());
+    for (auto source_file: changed) {
+        handles.emplace_back(new FileHandle(source_file->filename));
+        handles.back()->open();
+        data.push_back(handles.back()->data);
+        data_size.push_back(handles.back()->data_size);
+    }
 
-    auto md5hash_thread = std::thread([this,&handle](){
-        md5hash = MD5(handle.data, handle.data_size);
+    pool.submit(group, [&data,&data_size,&hashes]() {
+        ContentHash::hash(options.hash_algorithm, data.size(), data.data(), data_size.data(), hashes.data());
     });
 
-    parse_thread.join();
-    md5hash_thread.join();
+    for (size_t i = 0; i < changed.size(); i++) {
+        pool.submit(group, [&changed,&data,&data_size,i]() {
+            changed[i]->parse(data[i], data_size[i]);
+        });
+    }
+
+    pool.wait(group);
+    for (size_t i = 0; i < changed.size(); i++) {
+        changed[i]->content_hash = hashes[i];
+        handles[i]->close();
+        changed[i]->save_record();
+    }
+}
+
+void SourceFile::process_files(std::vector<SourceFile *> const &source_files)
+{
+    auto            &pool = ThreadPool::shared();
+    ThreadPoolGroup group;
+
+    if (options.hash_algorithm != ContentHash::md5) {
+        std::vector<char>           unchanged(source_files.size());
+        std::vector<SourceFile *>   changed;
+        std::vector<fs::path>       filenames;
+        FileLoader                  loader(options.file_loader);
+
+        pool.parallel_for(source_files.size(), [&source_files,&unchanged](size_t i) {
+            unchanged[i] = source_files[i]->load_record();
+        });
+        for (size_t i = 0; i < source_files.size(); i++) {
+            auto source_file = source_files[i];
+
+            if (unchanged[i]) {
+                continue;
+            }
+
+            // Large files are mapped, instead of being copied into a buffer of the loader.
+            if (source_file->has_file_stat && source_file->file_stat.size >= FileHandle::mmap_threshold) {
+                pool.submit(group, [source_file]() {
+                    source_file->parse_file();
+                });
+            } else {
+                changed.push_back(source_file);
+                filenames.push_back(source_file->filename);
+            }
+        }
+
+        // Each file is parsed by a task as soon as it is read.
+        try {
+            loader.load(filenames, [&changed](size_t i, char const *data, size_t data_size) {
+                changed[i]->parse_and_hash(data, data_size);
+                changed[i]->save_record();
+            });
+        } catch (...) {
+            // The tasks of the mapped files refer to the group.
+            try {
+                pool.wait(group);
+            } catch (...) {
+            }
+            throw;
+        }
+        pool.wait(group);
+
+    } else {
+        for (size_t begin = 0; begin < source_files.size(); begin += SourceFile_batch_size) {
+            auto end = std::min(begin + SourceFile_batch_size, source_files.size());
+
+            pool.submit(group, [&source_files,begin,end]() {
+                process_batch(source_files, begin, end);
+            });
+        }
+        pool.wait(group);
+    }
+}
+
+std::string SourceFile::location(size_t offset)
+{
+    FileHandle handle(filename);
+
+    handle.open();
+    if (!line_index) {
+        line_index.reset(new LineIndex(handle.data, handle.data_size));
+    }
+
+    // The file may have changed since it was parsed.
+    offset = std::min(offset, handle.data_size);
+    auto r = string_format("%s:%zu:%zu", filename.string().c_str(), line_index->line(handle.data, offset), LineIndex::column(handle.data, offset));
+
     handle.close();
+    return r;
+}
+
+fs::path SourceFile::cache_filename(char const *extension) const
+{
+    if (options.cache_directory.empty()) {
+        return fs::path();
+    }
+
+    auto hash = MD5(fs::absolute(filename).string());
+    return options.cache_directory / "files" / string_format("%016llx%016llx%s", (unsigned long long)(hash >> 64), (unsigned long long)hash, extension);
 }
 
 
@@ -30,8 +30,12 @@
 #include <memory.h>
 #include <string>
 #include <map>
+#include <memory>
 #include "MapQuery.h"
 #include "Tokenizer.h"
+#include "LineIndex.h"
+#include "FileStat.h"
+#include "ContentHash.h"
 #include "numbers.h"
 
 namespace fs = boost::filesystem;
@@ -39,19 +43,25 @@ namespace fs = boost::filesystem;
 namespace takevos {
 namespace hurricane {
 
-using DQ = MapQuery<std::string,std::string>;
-using DQMap = std::map<std::string,std::string>;
-
 
 
 /** A source file.
+ *
+ * The results of processing a file are stored in a record in the cache
+ * directory, together with the metadata of the file. When the metadata is
+ * unchanged on the next run the results are taken from the record, without
+ * reading the file. Only when the file was modified within a second of the
+ * record being written, where a later modification may not have changed the
+ * modification time, the contents are hashed and compared with the record.
  */
 class SourceFile {
 public:
     fs::path            filename;   ///< filename of the file
-    uint128_t           md5hash;
+    ContentHash         content_hash; ///< Hash of the contents, with the algorithm of options.hash_algorithm.
     std::vector<DQ>     needs;      ///< Required objects.
+    std::vector<size_t> need_offsets; ///< Byte offset in the file of the statement requiring each object.
     std::vector<DQMap>  provides;   ///< Objects that this file creates.
+    bool                from_record; ///< The results were taken from the record of a previous run.
 
     /** Open a source file.
      * @param filename  A path the a file.
@@ -62,10 +72,27 @@ public:
      */
     virtual ~SourceFile();
 
+    /** Parse the file and calculate its content_hash.
+     * Both are done in a single pass over the file, see hash_until().
+     */
     virtual void process_file(void);
 
-    inline void add_need(const DQ &q) {
+    /** Process several files concurrently, as tasks of the shared ThreadPool.
+     * With MD5 the files of a batch are hashed in parallel lanes, see MD5(size_t, ...),
+     * while they are being parsed; this is faster than hashing each file on its own
+     * for the many small files of a typical project. The fast hash is not limited
+     * by a dependency chain, so with it the files are read by a FileLoader and each
+     * file is parsed and hashed by a task as soon as it is read; files of at least
+     * FileHandle::mmap_threshold are mapped by a task instead, see parse_file().
+     * Files whose record can be used are not read, see load_record().
+     *
+     * @param source_files  The files to process.
+     */
+    static void process_files(std::vector<SourceFile *> const &source_files);
+
+    inline void add_need(const DQ &q, size_t offset) {
         needs.push_back(q);
+        need_offsets.push_back(offset);
     }
 
     inline void add_provide(const DQ &q) {
@@ -73,6 +100,80 @@ public:
     }
 
     virtual void parse(char const * const text, size_t text_size) = 0;
+
+    /** The key of the record of the file.
+     * It must change whenever parse() would give a different result for the same
+     * text, such as for a different grammar or compilation mode.
+     */
+    virtual uint128_t record_key(void) const = 0;
+
+    /** The location of a byte in the file, for diagnostics.
+     * The file is read again and a LineIndex is built on the first call,
+     * so that parsing does not need to keep track of lines.
+     *
+     * @param offset    The byte offset in the file, such as one of need_offsets.
+     * @return The location as "filename:line:column".
+     */
+    std::string location(size_t offset);
+
+    /** A file in the cache directory for information about this source file, which is kept between runs.
+     * @param extension The extension of the file, for the kind of information.
+     * @return The path of the file, or empty when the cache is disabled.
+     */
+    fs::path cache_filename(char const *extension) const;
+
+protected:
+    /** Hash the text up to an offset, while it is still in the cache.
+     * parse() calls this as it progresses through the text, with the offset of
+     * each token; the text is hashed in blocks, the rest after parse() returns.
+     * This way the tokenizer and the hash share a single pass over the text, as
+     * long as the tokens are not much further apart than the cache is large.
+     *
+     * @param offset    An offset in the text up to which the tokenizer has read.
+     */
+    void hash_until(size_t offset);
+
+    /** Take over hashing the whole text, for a parse() that does not pass the text through hash_until() in order.
+     * The text must be passed to the returned hasher in order, from its start to
+     * its end, before parse() returns; hash_until() has no effect afterwards.
+     *
+     * @return The hasher, or NULL when the text is not being hashed.
+     */
+    ContentHasher *take_hasher(void);
+
+private:
+    std::unique_ptr<LineIndex>  line_index; ///< Built on the first call to location().
+    ContentHasher               *hasher;    ///< The hash of the text being parsed by process_file(), or NULL.
+    char const                  *hash_text; ///< The text being hashed.
+    size_t                      hash_text_size; ///< The size of the text being hashed.
+    size_t                      hashed_size; ///< Number of bytes of the text passed to the hasher.
+    FileStat                    file_stat;  ///< The metadata of the file before it was read.
+    bool                        has_file_stat; ///< file_stat is valid.
+
+    /** Take the results from the record of the file, when the file did not change.
+     * Also gets file_stat, for save_record().
+     *
+     * @return true when the results were taken from the record.
+     */
+    bool load_record(void);
+
+    /** Save the results in the record of the file.
+     * Errors are ignored, the record is only an optimization.
+     */
+    void save_record(void) const;
+
+    /** Parse a text and calculate its content_hash in a single pass.
+     */
+    void parse_and_hash(char const * const text, size_t text_size);
+
+    /** Read the file with a FileHandle, parse it and save its record.
+     */
+    void parse_file(void);
+
+    /** Process the files [begin, end) with MD5, see process_files().
+     * Files that are unchanged since their record was saved are not read.
+     */
+    static void process_batch(std::vector<SourceFile *> const &source_files, size_t begin, size_t end);
 };
 
 }}
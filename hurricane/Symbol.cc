@@ -0,0 +1,105 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "Symbol.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** The strings of all symbols.
+ * Strings are added while files are parsed by the tasks of the ThreadPool, but
+ * most lookups find a string that is already in the table; these only take the
+ * mutex shared.
+ */
+struct SymbolTable {
+    std::shared_timed_mutex                     mutex;
+    std::deque<std::string>                     strings;    ///< The string of each symbol, a deque does not move its elements.
+    std::unordered_map<std::string,uint32_t>    ids;        ///< The symbol of each string.
+
+    SymbolTable() {
+        strings.emplace_back();
+        ids.emplace(std::string(), 0);
+    }
+};
+
+static SymbolTable &Symbol_table(void)
+{
+    static SymbolTable table;
+
+    return table;
+}
+
+uint32_t Symbol::intern(char const *x, size_t size)
+{
+    auto        &table = Symbol_table();
+    std::string key(x, size);
+
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(table.mutex);
+
+        auto i = table.ids.find(key);
+        if (i != table.ids.end()) {
+            return i->second;
+        }
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock(table.mutex);
+
+    // Another thread may have added the string after the shared lock was released.
+    auto i = table.ids.find(key);
+    if (i != table.ids.end()) {
+        return i->second;
+    }
+
+    if (table.strings.size() > UINT32_MAX) {
+        throw std::runtime_error("Too many symbols.");
+    }
+    auto id = (uint32_t)table.strings.size();
+    table.strings.push_back(key);
+    table.ids.emplace(std::move(key), id);
+    return id;
+}
+
+std::string const &Symbol::string(void) const
+{
+    auto                                        &table = Symbol_table();
+    std::shared_lock<std::shared_timed_mutex>   lock(table.mutex);
+
+    return table.strings[id];
+}
+
+size_t Symbol::nr_symbols(void)
+{
+    auto                                        &table = Symbol_table();
+    std::shared_lock<std::shared_timed_mutex>   lock(table.mutex);
+
+    return table.strings.size();
+}
+
+}}
@@ -0,0 +1,91 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_SYMBOL_H
+#define TAKEVOS_HURRICANE_SYMBOL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <ostream>
+
+namespace takevos {
+namespace hurricane {
+
+/** An interned string.
+ *
+ * Each distinct string is stored once in a process-wide table, a Symbol is
+ * the 32-bit index of its string in that table. So symbols are compared, and
+ * copied, as integers. The order of symbols is the order in which their
+ * strings were first interned, not the order of the strings.
+ */
+class Symbol {
+public:
+    uint32_t    id;     ///< Index of the string in the table, 0 for the empty string.
+
+    Symbol() : id(0) {
+    }
+
+    Symbol(std::string const &x) : id(intern(x.data(), x.size())) {
+    }
+
+    Symbol(char const *x) : id(intern(x, strlen(x))) {
+    }
+
+    /** The string of the symbol.
+     * The reference stays valid for the lifetime of the process.
+     */
+    std::string const &string(void) const;
+
+    bool operator==(Symbol const &other) const { return id == other.id; }
+    bool operator!=(Symbol const &other) const { return id != other.id; }
+    bool operator<(Symbol const &other) const { return id < other.id; }
+
+    /** The number of strings in the table, including the empty string.
+     */
+    static size_t nr_symbols(void);
+
+private:
+    /** Find or add a string in the table.
+     * @return The index of the string.
+     */
+    static uint32_t intern(char const *x, size_t size);
+};
+
+}}
+
+namespace std {
+
+static inline std::string to_string(const takevos::hurricane::Symbol &x) {
+    return x.string();
+}
+
+static inline ostream &operator<<(ostream &os, const takevos::hurricane::Symbol &x) {
+    os << x.string();
+    return os;
+}
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE Symbol
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Symbol.h"
+
+using namespace takevos::hurricane;
+
+BOOST_AUTO_TEST_CASE(symbol_intern_1)
+{
+    Symbol  a("lib");
+    Symbol  b(std::string("li") + "b");
+    Symbol  c("ent");
+
+    BOOST_CHECK(a == b);
+    BOOST_CHECK(a != c);
+    BOOST_CHECK_EQUAL(a.string(), "lib");
+    BOOST_CHECK_EQUAL(c.string(), "ent");
+    BOOST_CHECK_EQUAL(std::to_string(c), "ent");
+}
+
+BOOST_AUTO_TEST_CASE(symbol_empty_1)
+{
+    BOOST_CHECK_EQUAL(Symbol().id, 0);
+    BOOST_CHECK(Symbol("") == Symbol());
+    BOOST_CHECK_EQUAL(Symbol().string(), "");
+}
+
+BOOST_AUTO_TEST_CASE(symbol_threads_1)
+{
+    auto                        nr_before = Symbol::nr_symbols();
+    std::vector<std::thread>    threads;
+    std::vector<Symbol>         results[4];
+
+    // Each thread interns the same strings, in a different order.
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t,&results]() {
+            for (int i = 0; i < 10000; i++) {
+                auto j = (i * (t + 1)) % 10000;
+                results[t].push_back(Symbol("symbol-" + std::to_string(j)));
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(Symbol::nr_symbols(), nr_before + 10000);
+    for (int t = 0; t < 4; t++) {
+        for (int i = 0; i < 10000; i++) {
+            auto j = (i * (t + 1)) % 10000;
+            if (results[t][i] != Symbol("symbol-" + std::to_string(j)) || results[t][i].string() != "symbol-" + std::to_string(j)) {
+                BOOST_ERROR("Symbol differs between threads.");
+            }
+        }
+    }
+}
@@ -0,0 +1,215 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include "ThreadPool.h"
+
+namespace takevos {
+namespace hurricane {
+
+size_t ThreadPool::shared_nr_jobs = 0;
+
+/** The pool and worker of the calling thread, when it is a worker.
+ */
+static thread_local ThreadPool const    *ThreadPool_current_pool = NULL;
+static thread_local size_t              ThreadPool_current_worker = 0;
+
+ThreadPool::ThreadPool(size_t nr_jobs) :
+    nr_queued(0), stopping(false)
+{
+    if (nr_jobs == 0) {
+        nr_jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Worker 0 is the thread that waits, the other workers get a thread each.
+    for (size_t i = 0; i < nr_jobs; i++) {
+        workers.emplace_back(new ThreadPoolWorker());
+    }
+    for (size_t i = 1; i < nr_jobs; i++) {
+        threads.emplace_back([this,i]() { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+ThreadPool &ThreadPool::shared(void)
+{
+    static ThreadPool pool(shared_nr_jobs);
+
+    return pool;
+}
+
+size_t ThreadPool::self(void) const
+{
+    return ThreadPool_current_pool == this ? ThreadPool_current_worker : 0;
+}
+
+void ThreadPool::submit(ThreadPoolGroup &group, std::function<void()> task)
+{
+    auto &worker = *workers[self()];
+
+    group.nr_pending++;
+
+    // The counter is incremented before the task is pushed, so that take() can not decrement it
+    // first, and while holding the mutex, so that a thread can not miss it before it sleeps.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nr_queued++;
+    }
+
+    try {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(ThreadPoolTask{&group, std::move(task)});
+    } catch (...) {
+        nr_queued--;
+        group.nr_pending--;
+        throw;
+    }
+    wakeup.notify_one();
+}
+
+bool ThreadPool::take(size_t self, ThreadPoolTask &task)
+{
+    if (nr_queued == 0) {
+        return false;
+    }
+
+    {
+        auto &worker = *workers[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            nr_queued--;
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < workers.size(); i++) {
+        auto &victim = *workers[(self + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            nr_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(ThreadPoolTask &task)
+{
+    auto &group = *task.group;
+
+    try {
+        task.function();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(group.mutex);
+        if (!group.exception) {
+            group.exception = std::current_exception();
+        }
+    }
+
+    // Release the resources of the task before the waiting thread may return.
+    task.function = nullptr;
+
+    if (--group.nr_pending == 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        wakeup.notify_all();
+    }
+}
+
+void ThreadPool::wait(ThreadPoolGroup &group)
+{
+    auto            me = self();
+    ThreadPoolTask  task;
+
+    while (group.nr_pending > 0) {
+        if (take(me, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this,&group]() { return group.nr_pending == 0 || nr_queued > 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(group.mutex);
+    if (group.exception) {
+        auto exception = group.exception;
+        group.exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+bool ThreadPool::execute_one(void)
+{
+    ThreadPoolTask task;
+
+    if (!take(self(), task)) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+void ThreadPool::run(size_t self)
+{
+    ThreadPoolTask task;
+
+    ThreadPool_current_pool = this;
+    ThreadPool_current_worker = self;
+
+    while (true) {
+        if (take(self, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this]() { return stopping || nr_queued > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+}}
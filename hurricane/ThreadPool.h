@@ -0,0 +1,169 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_THREADPOOL_H
+#define TAKEVOS_HURRICANE_THREADPOOL_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace takevos {
+namespace hurricane {
+
+/** A set of tasks that are waited for together.
+ */
+class ThreadPoolGroup {
+public:
+    ThreadPoolGroup() : nr_pending(0) { }
+    ThreadPoolGroup(ThreadPoolGroup const &) = delete;
+    ThreadPoolGroup &operator=(ThreadPoolGroup const &) = delete;
+
+private:
+    friend class ThreadPool;
+
+    std::atomic<size_t>     nr_pending; ///< Number of tasks that were submitted and have not finished.
+    std::mutex              mutex;      ///< Protects exception.
+    std::exception_ptr      exception;  ///< The first exception thrown by a task.
+};
+
+/** A pool of threads which execute tasks, with work stealing.
+ *
+ * Each worker has its own deque of tasks. A task submitted by a worker is
+ * pushed on the back of the deque of that worker, which executes the newest
+ * task first, while it is still in the cache. An idle worker steals the
+ * oldest task from the front of the deque of another worker; these are the
+ * largest pieces of work, such as whole files, when a task splits its work in
+ * subtasks. This way a single large file, which is split into several tasks,
+ * does not keep the other workers from processing the remaining files.
+ *
+ * The thread that waits for a group of tasks also executes tasks until the
+ * group is finished, so that waiting inside a task can not deadlock, and a
+ * pool of one job executes all tasks on the calling thread.
+ */
+class ThreadPool {
+public:
+    /** The number of jobs of the pool returned by shared(), 0 for one per CPU.
+     * Set by Options::parse() before the pool is first used.
+     */
+    static size_t shared_nr_jobs;
+
+    /** Create a pool.
+     * @param nr_jobs   Number of tasks that are executed concurrently, including the waiting thread; 0 for one per CPU.
+     */
+    ThreadPool(size_t nr_jobs);
+
+    /** Stop the threads, after waiting for the tasks that are running.
+     */
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    /** The pool shared by the whole process, with shared_nr_jobs jobs.
+     */
+    static ThreadPool &shared(void);
+
+    /** Number of tasks that are executed concurrently.
+     */
+    size_t nr_jobs(void) const {
+        return workers.size();
+    }
+
+    /** Submit a task.
+     * @param group     The group the task belongs to.
+     * @param task      The task to execute.
+     */
+    void submit(ThreadPoolGroup &group, std::function<void()> task);
+
+    /** Wait until all tasks of a group are finished, executing tasks in the meantime.
+     * Rethrows the first exception thrown by a task of the group.
+     *
+     * @param group     The group to wait for.
+     */
+    void wait(ThreadPoolGroup &group);
+
+    /** Execute a single task, when there is one.
+     * For a thread that waits for something else than a group, such as I/O.
+     *
+     * @return true when a task was executed.
+     */
+    bool execute_one(void);
+
+    /** Execute a function for each index, in parallel.
+     * @param size      The number of indices.
+     * @param f         Called as f(size_t i) for each i in [0, size).
+     */
+    template <typename F>
+    void parallel_for(size_t size, F const &f) {
+        ThreadPoolGroup group;
+
+        for (size_t i = 0; i < size; i++) {
+            submit(group, [&f,i]() { f(i); });
+        }
+        wait(group);
+    }
+
+private:
+    struct ThreadPoolTask {
+        ThreadPoolGroup         *group;
+        std::function<void()>   function;
+    };
+
+    /** The tasks of a worker.
+     * Index 0 is shared by all threads that are not workers of this pool.
+     */
+    struct ThreadPoolWorker {
+        std::mutex                  mutex;
+        std::deque<ThreadPoolTask>  tasks;
+    };
+
+    std::vector<std::unique_ptr<ThreadPoolWorker>>  workers;
+    std::vector<std::thread>                        threads;
+    std::atomic<size_t>                             nr_queued;  ///< Number of tasks in the deques.
+    std::mutex                                      mutex;      ///< Protects sleeping and waking up.
+    std::condition_variable                         wakeup;     ///< Notified when a task is submitted or a group finishes.
+    bool                                            stopping;
+
+    /** The index of the worker of the calling thread, 0 when it is not a worker of this pool.
+     */
+    size_t self(void) const;
+
+    /** Take a task, from the back of the own deque or from the front of another deque.
+     */
+    bool take(size_t self, ThreadPoolTask &task);
+
+    void execute(ThreadPoolTask &task);
+    void run(size_t self);
+};
+
+}}
+#endif
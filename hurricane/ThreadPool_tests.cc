@@ -0,0 +1,116 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE ThreadPool
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+
+using namespace takevos::hurricane;
+
+BOOST_AUTO_TEST_CASE(thread_pool_1)
+{
+    for (size_t nr_jobs: {1, 2, 8}) {
+        ThreadPool          pool(nr_jobs);
+        std::vector<int>    results(1000);
+
+        BOOST_CHECK_EQUAL(pool.nr_jobs(), nr_jobs);
+        pool.parallel_for(results.size(), [&results](size_t i) {
+            results[i] = i * 2;
+        });
+        for (size_t i = 0; i < results.size(); i++) {
+            BOOST_CHECK_EQUAL(results[i], i * 2);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(thread_pool_2)
+{
+    // Tasks that wait for their own subtasks, such as a file which is tokenized in chunks.
+    for (size_t nr_jobs: {1, 3}) {
+        ThreadPool          pool(nr_jobs);
+        std::atomic<int>    count(0);
+
+        pool.parallel_for(20, [&pool,&count](size_t) {
+            pool.parallel_for(50, [&count](size_t) {
+                count++;
+            });
+        });
+        BOOST_CHECK_EQUAL(count, 1000);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(thread_pool_3)
+{
+    // A single long task does not keep the other workers from stealing the remaining tasks.
+    ThreadPool                  pool(4);
+    ThreadPoolGroup             group;
+    std::mutex                  mutex;
+    std::set<std::thread::id>   ids;
+
+    pool.submit(group, [&pool,&mutex,&ids]() {
+        ThreadPoolGroup subgroup;
+
+        for (int i = 0; i < 100; i++) {
+            pool.submit(subgroup, [&mutex,&ids]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::lock_guard<std::mutex> lock(mutex);
+                ids.insert(std::this_thread::get_id());
+            });
+        }
+        pool.wait(subgroup);
+    });
+    pool.wait(group);
+    BOOST_CHECK_GT(ids.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(thread_pool_4)
+{
+    // The exception of a task is thrown by wait(), after the other tasks have finished.
+    ThreadPool          pool(3);
+    ThreadPoolGroup     group;
+    std::atomic<int>    count(0);
+
+    for (int i = 0; i < 10; i++) {
+        pool.submit(group, [&count,i]() {
+            count++;
+            if (i == 5) {
+                throw std::runtime_error("task failed");
+            }
+        });
+    }
+    BOOST_CHECK_THROW(pool.wait(group), std::runtime_error);
+    BOOST_CHECK_EQUAL(count, 10);
+
+    // The group can be used again.
+    pool.submit(group, [&count]() { count++; });
+    pool.wait(group);
+    BOOST_CHECK_EQUAL(count, 11);
+}
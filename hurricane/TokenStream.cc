@@ -0,0 +1,253 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <random>
+#include <type_traits>
+#include "TokenStream.h"
+#include "TokenizerCache.h"
+#include "md5.h"
+
+namespace takevos {
+namespace hurricane {
+
+const uint32_t TokenStream::version;
+
+/** Identifies a cache file of a token stream.
+ */
+static const char TokenStream_magic[8] = {'H', 'R', 'C', 'T', 'S', 'T', 'R', 'M'};
+
+/** Chunks are never smaller than this, except at the end of the text.
+ */
+static const size_t TokenStream_min_chunk_size = 2048;
+
+/** Chunks are never larger than this, so that a text without boundaries is still split.
+ */
+static const size_t TokenStream_max_chunk_size = 65536;
+
+/** Number of bits of the rolling hash that must be zero at a boundary, about one boundary per 8 KB.
+ */
+static const int TokenStream_boundary_bits = 13;
+
+static_assert(std::is_trivially_copyable<TokenStreamToken>::value, "TokenStreamToken is stored as bytes");
+static_assert(std::is_trivially_copyable<TokenStreamChunk>::value, "TokenStreamChunk is stored as bytes");
+
+/** A random value for each byte, for the rolling hash.
+ * std::mt19937_64 is fully specified by the standard, so the chunks are the same on every platform.
+ */
+struct TokenStreamGear {
+    uint64_t    values[256];
+
+    TokenStreamGear() {
+        std::mt19937_64 random(0x68757272);
+
+        for (auto &x: values) {
+            x = random();
+        }
+    }
+};
+
+static const TokenStreamGear TokenStream_gear;
+
+static bool operator==(TokenStreamChunk const &a, TokenStreamChunk const &b)
+{
+    return a.size == b.size && a.hash == b.hash;
+}
+
+/** The key of the cache file, which also depends on the format of the file and the hash of the chunks.
+ */
+static uint128_t TokenStream_key(uint128_t key, int hash_algorithm)
+{
+    MD5Hasher hasher;
+
+    hasher.value(key);
+    hasher.value(TokenStream::version);
+    hasher.value((int32_t)hash_algorithm);
+    hasher.value((uint32_t)sizeof (TokenStreamToken));
+    hasher.value((uint32_t)sizeof (TokenStreamChunk));
+    return hasher.final();
+}
+
+std::vector<TokenStreamChunk> TokenStream::split(char const * const text, size_t text_size, int hash_algorithm, ContentHasher *text_hasher)
+{
+    std::vector<TokenStreamChunk>   r;
+    size_t                          begin = 0;
+    uint64_t                        hash = 0;
+
+    for (size_t i = 0; i < text_size; i++) {
+        // Each byte is shifted out of the hash after 64 bytes, the upper bits depend on all of them.
+        hash = (hash << 1) + TokenStream_gear.values[(uint8_t)text[i]];
+
+        auto size = i + 1 - begin;
+        if ((size >= TokenStream_min_chunk_size && (hash >> (64 - TokenStream_boundary_bits)) == 0) || size == TokenStream_max_chunk_size || i + 1 == text_size) {
+            r.push_back(TokenStreamChunk{size, ContentHash::hash(hash_algorithm, &text[begin], size).value});
+            if (text_hasher != NULL) {
+                text_hasher->update(&text[begin], size);
+            }
+            begin = i + 1;
+        }
+    }
+    return r;
+}
+
+bool TokenStream::update(Tokenizer const &tokenizer, char const * const text, size_t text_size, ContentHasher *text_hasher)
+{
+    auto new_chunks = split(text, text_size, hash_algorithm, text_hasher);
+
+    // Find the unchanged chunks at the start and end of the text.
+    size_t  nr_prefix = 0;
+    size_t  prefix_size = 0;
+    while (nr_prefix < chunks.size() && nr_prefix < new_chunks.size() && chunks[nr_prefix] == new_chunks[nr_prefix]) {
+        prefix_size += chunks[nr_prefix++].size;
+    }
+
+    size_t  nr_suffix = 0;
+    size_t  suffix_size = 0;
+    while (
+        nr_prefix + nr_suffix < chunks.size() && nr_prefix + nr_suffix < new_chunks.size() &&
+        chunks[chunks.size() - 1 - nr_suffix] == new_chunks[new_chunks.size() - 1 - nr_suffix]
+    ) {
+        suffix_size += chunks[chunks.size() - 1 - nr_suffix++].size;
+    }
+
+    size_t  old_size = 0;
+    for (auto &chunk: chunks) {
+        old_size += chunk.size;
+    }
+    auto    old_suffix_begin = old_size - suffix_size;
+    auto    new_suffix_begin = text_size - suffix_size;
+
+    chunks = std::move(new_chunks);
+    if (old_suffix_begin == prefix_size && new_suffix_begin == prefix_size) {
+        // The text did not change.
+        nr_scanned = 0;
+        return false;
+    }
+
+    // Keep the tokens that were found by only looking at the unchanged prefix.
+    std::vector<TokenStreamToken>   new_tokens;
+    size_t                          nr_kept = 0;
+    while (nr_kept < tokens.size() && tokens[nr_kept].scan_end <= prefix_size) {
+        nr_kept++;
+    }
+    new_tokens.assign(tokens.begin(), tokens.begin() + nr_kept);
+
+    size_t      begin = nr_kept > 0 ? tokens[nr_kept - 1].resume : 0;
+    size_t      offset = begin;
+    size_t      scan_end = begin;
+    size_t      old_index = nr_kept;
+    TokenView   view;
+
+    while (true) {
+        if (offset >= new_suffix_begin) {
+            // When the previous version resumed at the same place in the unchanged suffix
+            // the same tokens would be found, which only need to be moved.
+            auto old_offset = offset - new_suffix_begin + old_suffix_begin;
+
+            while (old_index < tokens.size() && tokens[old_index].resume < old_offset) {
+                old_index++;
+            }
+
+            // The previous version also started searching at the start of the text.
+            auto resynced = tokens.size() + 1;
+            if (old_offset == 0) {
+                resynced = 0;
+            } else if (old_index < tokens.size() && tokens[old_index].resume == old_offset) {
+                resynced = old_index + 1;
+            }
+
+            if (resynced <= tokens.size()) {
+                for (auto i = resynced; i < tokens.size(); i++) {
+                    auto token = tokens[i];
+                    token.offset = token.offset - old_suffix_begin + new_suffix_begin;
+                    token.resume = token.resume - old_suffix_begin + new_suffix_begin;
+                    token.scan_end = token.scan_end - old_suffix_begin + new_suffix_begin;
+                    for (int j = 0; j < token.nr_groups; j++) {
+                        if (token.groups[j][1] > 0) {
+                            token.groups[j][0] = token.groups[j][0] - old_suffix_begin + new_suffix_begin;
+                        }
+                    }
+                    if (i == resynced) {
+                        token.scan_end = std::max((size_t)token.scan_end, scan_end);
+                    }
+                    new_tokens.push_back(token);
+                }
+                break;
+            }
+        }
+
+        if (!tokenizer.tokenize(text, text_size, offset, view)) {
+            offset = text_size;
+            break;
+        }
+
+        scan_end = std::max(scan_end, view.scan_end);
+        if (view.code == Token::suppress) {
+            continue;
+        }
+
+        TokenStreamToken token = TokenStreamToken();
+        token.code = view.code;
+        token.nr_groups = view.nr_groups;
+        token.offset = view.offset;
+        token.resume = offset;
+        token.scan_end = scan_end;
+        for (int j = 0; j < view.nr_groups; j++) {
+            token.groups[j][0] = view.groups[j].empty() ? 0 : view.groups[j].data() - text;
+            token.groups[j][1] = view.groups[j].size();
+        }
+        new_tokens.push_back(token);
+        scan_end = offset;
+    }
+
+    nr_scanned = offset - begin;
+    tokens = std::move(new_tokens);
+    return true;
+}
+
+bool TokenStream::load(fs::path const &filename, uint128_t key)
+{
+    auto valid = TokenizerCache::read_file(filename, TokenStream_magic, TokenStream_key(key, hash_algorithm), [this](TokenizerCacheReader &reader) {
+        reader.vector(chunks);
+        reader.vector(tokens);
+    });
+
+    if (!valid) {
+        chunks.clear();
+        tokens.clear();
+    }
+    return valid;
+}
+
+void TokenStream::save(fs::path const &filename, uint128_t key) const
+{
+    TokenizerCacheWriter writer;
+
+    writer.vector(chunks);
+    writer.vector(tokens);
+    TokenizerCache::write_file(filename, TokenStream_magic, TokenStream_key(key, hash_algorithm), writer);
+}
+
+}}
@@ -0,0 +1,144 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_TOKENSTREAM_H
+#define TAKEVOS_HURRICANE_TOKENSTREAM_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "Tokenizer.h"
+#include "ContentHash.h"
+#include "numbers.h"
+
+namespace fs = boost::filesystem;
+
+namespace takevos {
+namespace hurricane {
+
+/** A token found in a previous version of a text.
+ * Only offsets are stored, so that the token can be moved when text is inserted
+ * or removed before it.
+ */
+struct TokenStreamToken {
+    int32_t     code;                               ///< Code matching the pattern.
+    int32_t     nr_groups;                          ///< Number of captured sub expressions.
+    uint64_t    offset;                             ///< Byte offset of the token in the text.
+    uint64_t    resume;                             ///< Offset where the tokenizer continued after the token.
+    uint64_t    scan_end;                           ///< Offset one beyond the last byte examined since the previous token.
+    uint64_t    groups[TokenView::max_groups][2];   ///< Offset and size of each captured sub expression.
+};
+
+/** A piece of a text, with a hash of its contents.
+ */
+struct TokenStreamChunk {
+    uint64_t    size;       ///< Number of bytes in the chunk.
+    uint128_t   hash;       ///< Hash of the bytes in the chunk, see TokenStream::hash_algorithm.
+};
+
+/** The tokens of a text, which are updated incrementally when the text is edited.
+ *
+ * The text is split into chunks at boundaries that depend on its content, using
+ * a rolling hash, so that an edit only changes the chunks around it; the chunks
+ * after the edit are the same as before, only at a different offset. Comparing
+ * the chunks with those of the previous version gives the unchanged prefix and
+ * suffix of the text.
+ *
+ * The tokens whose search only examined bytes in the unchanged prefix are kept.
+ * The tokenizer resumes after the last of those tokens, until it reaches an
+ * offset in the unchanged suffix where it also resumed in the previous version;
+ * from there on it would find the same tokens as before, so the remaining
+ * tokens of the previous version are moved and appended instead.
+ */
+class TokenStream {
+public:
+    /** The version of the file format.
+     * Increment when the file format, or the chunking of the text changes.
+     */
+    static const uint32_t version = 1;
+
+    int                             hash_algorithm; ///< The ContentHash algorithm for the chunks, also part of the key of the cache file.
+    std::vector<TokenStreamChunk>   chunks;     ///< The chunks of the text.
+    std::vector<TokenStreamToken>   tokens;     ///< The tokens of the text, without suppressed tokens.
+    size_t                          nr_scanned; ///< Number of bytes that were tokenized again by the last update().
+
+    TokenStream(int hash_algorithm = ContentHash::fast) : hash_algorithm(hash_algorithm), nr_scanned(0) { }
+
+    /** Split a text in chunks.
+     * @param text              The text.
+     * @param text_size         The size of the text.
+     * @param hash_algorithm    The ContentHash algorithm for the hash of each chunk.
+     * @param text_hasher       When not NULL, updated with each chunk right after it was hashed, while it is still in the cache.
+     * @return The chunks, which together cover the whole text.
+     */
+    static std::vector<TokenStreamChunk> split(char const * const text, size_t text_size, int hash_algorithm = ContentHash::fast, ContentHasher *text_hasher = NULL);
+
+    /** Update the tokens for a new version of the text.
+     * @param tokenizer     The tokenizer, which must be the same for every update.
+     * @param text          The new text.
+     * @param text_size     The size of the new text.
+     * @param text_hasher   When not NULL, updated with the whole text as it is split into chunks, see split().
+     * @return true when the text is different from the previous version.
+     */
+    bool update(Tokenizer const &tokenizer, char const * const text, size_t text_size, ContentHasher *text_hasher = NULL);
+
+    /** Pass each token to a visitor, in the same way as Tokenizer::for_each_token().
+     * @param text          The text that was passed to the last update().
+     * @param visitor       Called as visitor(const TokenView &token) for each token.
+     */
+    template <typename F>
+    void for_each_token(char const * const text, F &&visitor) const {
+        TokenView   view;
+
+        for (auto &token: tokens) {
+            view.code = token.code;
+            view.nr_groups = token.nr_groups;
+            view.offset = token.offset;
+            view.scan_end = token.scan_end;
+            for (int i = 0; i < token.nr_groups; i++) {
+                view.groups[i] = token.groups[i][1] > 0 ? boost::string_ref(&text[token.groups[i][0]], token.groups[i][1]) : boost::string_ref();
+            }
+            visitor(view);
+        }
+    }
+
+    /** Load the tokens and chunks of a previous version of the text.
+     * @param filename      The cache file.
+     * @param key           The key of the tokenizer, see TokenizerCache::key().
+     * @return true when the file exists and was valid, otherwise the stream is empty.
+     */
+    bool load(fs::path const &filename, uint128_t key);
+
+    /** Save the tokens and chunks.
+     * Throws std::runtime_error when the file could not be written.
+     *
+     * @param filename      The cache file.
+     * @param key           The key of the tokenizer, see TokenizerCache::key().
+     */
+    void save(fs::path const &filename, uint128_t key) const;
+};
+
+}}
+#endif
@@ -0,0 +1,198 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE TokenStream
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include "TokenStream.h"
+#include "TokenizerCache.h"
+#include "strings.h"
+
+using namespace takevos::hurricane;
+
+static Tokenizer const &TokenStream_tests_tokenizer(void)
+{
+    static const Tokenizer tokenizer({
+        {Token::suppress, "--.*?$"},
+        {1, "use\\s+([_.[:alnum:]]+)\\s*;"},
+        {2, "entity\\s+(\\w+)\\s+is\\s+"},
+        {3, "(\\w+)\\s*:\\s*(?:(\\w+)\\.)?(\\w+)\\s+port\\s+map"}
+    });
+    return tokenizer;
+}
+
+static std::string TokenStream_tests_text(int nr_lines)
+{
+    static char const * const lines[] = {
+        "use work.pkg%i;\n",
+        "entity e%i is\n",
+        "-- entity commented_out%i is\n",
+        "    u%i : work.cell port map (a => b);\n",
+        "    signal s%i : std_logic;\n",
+        "\n",
+    };
+    std::string text;
+
+    for (int i = 0; i < nr_lines; i++) {
+        text += string_format(lines[random() % 6], i);
+    }
+    return text;
+}
+
+static std::vector<Token> TokenStream_tests_tokens(TokenStream const &stream, std::string const &text)
+{
+    std::vector<Token> r;
+
+    stream.for_each_token(text.data(), [&r](TokenView const &token) {
+        r.push_back(Token(token));
+    });
+    return r;
+}
+
+static void TokenStream_tests_check(TokenStream const &stream, std::string const &text)
+{
+    auto expected = TokenStream_tests_tokenizer().tokenize(text.data(), text.size());
+    auto result = TokenStream_tests_tokens(stream, text);
+
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    for (size_t i = 0; i < result.size(); i++) {
+        BOOST_REQUIRE_EQUAL(result[i].offset, expected[i].offset);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(token_stream_split_1)
+{
+    srandom(1);
+    auto text = TokenStream_tests_text(20000);
+    auto chunks = TokenStream::split(text.data(), text.size());
+
+    size_t size = 0;
+    for (auto &chunk: chunks) {
+        size += chunk.size;
+    }
+    BOOST_CHECK_EQUAL(size, text.size());
+    BOOST_CHECK_GT(chunks.size(), 10);
+
+    // Inserting text only changes the chunk where it is inserted.
+    auto edited = text;
+    edited.insert(text.size() / 2, "use work.inserted;\n");
+    auto edited_chunks = TokenStream::split(edited.data(), edited.size());
+    size_t nr_same = 0;
+    for (auto &chunk: edited_chunks) {
+        for (auto &other: chunks) {
+            if (chunk.size == other.size && chunk.hash == other.hash) {
+                nr_same++;
+                break;
+            }
+        }
+    }
+    BOOST_CHECK_GE(nr_same + 2, chunks.size());
+}
+
+BOOST_AUTO_TEST_CASE(token_stream_split_2)
+{
+    srandom(3);
+    auto text = TokenStream_tests_text(20000);
+
+    // The text is hashed as a whole while it is split.
+    for (auto algorithm: {ContentHash::fast, ContentHash::md5}) {
+        ContentHasher hasher(algorithm);
+        TokenStream::split(text.data(), text.size(), ContentHash::fast, &hasher);
+        BOOST_CHECK(hasher.final() == ContentHash::hash(algorithm, text.data(), text.size()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(token_stream_update_1)
+{
+    srandom(2);
+    auto        text = TokenStream_tests_text(20000);
+    TokenStream stream;
+
+    stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    BOOST_CHECK_EQUAL(stream.nr_scanned, text.size());
+    TokenStream_tests_check(stream, text);
+
+    stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    BOOST_CHECK_EQUAL(stream.nr_scanned, 0);
+    TokenStream_tests_check(stream, text);
+
+    for (int round = 0; round < 50; round++) {
+        // Replace, insert or remove a few lines, including across a token or a comment.
+        size_t begin = random() % text.size();
+        size_t size = random() % 3 == 0 ? 0 : random() % 200;
+        auto insert = random() % 3 == 0 ? std::string() : TokenStream_tests_text(random() % 4);
+        text.replace(begin, std::min(size, text.size() - begin), insert);
+
+        stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+        TokenStream_tests_check(stream, text);
+        BOOST_CHECK_LT(stream.nr_scanned, text.size() / 4);
+    }
+
+    // Edits at the start and end of the text.
+    text = "entity first is\n" + text;
+    stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    TokenStream_tests_check(stream, text);
+    BOOST_CHECK_LT(stream.nr_scanned, text.size() / 4);
+
+    text += "use work.last;";
+    stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    TokenStream_tests_check(stream, text);
+    BOOST_CHECK_LT(stream.nr_scanned, text.size() / 4);
+}
+
+BOOST_AUTO_TEST_CASE(token_stream_save_1)
+{
+    srandom(3);
+    auto        text = TokenStream_tests_text(1000);
+    auto        key = TokenizerCache::key(TokenStream_tests_tokenizer());
+    fs::path    filename = string_format("/tmp/TokenStream-tests-%i.cache", (int)getpid());
+    TokenStream stream;
+
+    stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    stream.save(filename, key);
+
+    TokenStream loaded;
+    BOOST_REQUIRE(loaded.load(filename, key));
+    loaded.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    BOOST_CHECK_EQUAL(loaded.nr_scanned, 0);
+    TokenStream_tests_check(loaded, text);
+
+    // The tokens of a different tokenizer are not used.
+    TokenStream other;
+    BOOST_CHECK(!other.load(filename, key + 1));
+    BOOST_CHECK(other.tokens.empty());
+
+    // Nor the chunks of a different hash algorithm.
+    TokenStream md5_stream(ContentHash::md5);
+    BOOST_CHECK(!md5_stream.load(filename, key));
+    md5_stream.update(TokenStream_tests_tokenizer(), text.data(), text.size());
+    BOOST_CHECK_EQUAL(md5_stream.nr_scanned, text.size());
+    TokenStream_tests_check(md5_stream, text);
+
+    fs::remove(filename);
+}
@@ -26,19 +26,21 @@
 #include <iostream>
 #include <future>
 #include <stdarg.h>
-#include <alloca.h>
+#include <stdexcept>
 #include "Tokenizer.h"
 
 namespace takevos {
 namespace hurricane {
 
+const size_t Tokenizer::not_found;
+
 Token::Token() :
-    code(Token::sentinal)
+    code(Token::sentinal), offset(0)
 {
 }
 
 Token::Token(int code, ...) :
-    code(code)
+    code(code), offset(0)
 {
     va_list ap;
 
@@ -56,6 +58,14 @@ Token::Token(int code, ...) :
     va_end(ap);
 }
 
+Token::Token(const TokenView &view) :
+    code(view.code), offset(view.offset)
+{
+    for (int i = 0; i < view.nr_groups; i++) {
+        groups.push_back(view.groups[i].to_string());
+    }
+}
+
 bool Token::operator==(const Token &other) const
 {
     return !(*this != other);
@@ -95,127 +105,115 @@ std::ostream &operator<<(std::ostream &os, const Token &x)
 
 Tokenizer::Tokenizer(int code1, char const * const pattern1, ...)
 {
-    va_list     ap;
-    int         tmp_code        = code1;
-    const char  *tmp_pattern    = pattern1;
-    int         errcode;
-    char        errstr[80];
-
-    std::string combined_pattern = "(";
+    va_list                                 ap;
+    std::vector<std::pair<int,char const *>> patterns;
+    int                                     tmp_code        = code1;
+    const char                              *tmp_pattern    = pattern1;
 
     va_start(ap, pattern1);
     while (true) {
-        regex_t     tmp_pattern_re;
-
-        // Compile each pattern to extract the number of sub-expressions in each pattern.
-        errcode = regcomp(&tmp_pattern_re, tmp_pattern, REG_EXTENDED | REG_ENHANCED | REG_NEWLINE | REG_ICASE);
-        if (errcode != 0) {
-            regerror(errcode, &tmp_pattern_re, errstr, sizeof (errstr) - 1);
-            fprintf(stderr, "ERROR compiling pattern '%s': %s\n", tmp_pattern, errstr);
-            abort();
-        }
-
-        // Append each pattern into a large pattern.
-        SubPattern sub_pattern(tmp_code, (int)tmp_pattern_re.re_nsub);
-        combined_pattern += tmp_pattern;
-
-        sub_patterns.push_back(sub_pattern);
-        regfree(&tmp_pattern_re);
-
+        patterns.push_back(std::make_pair(tmp_code, tmp_pattern));
 
         // Get the next code and pattern.
         tmp_code    = va_arg(ap, int);
         if (tmp_code == Token::sentinal) {
             // Last pattern.
-            combined_pattern += ")";
             break;
-        } else {
-            // More patterns to follow.
-            combined_pattern += ")|(";
         }
         tmp_pattern = va_arg(ap, const char *);
     }
     va_end(ap);
 
-    // Compile the large pattern.
-    errcode = regcomp(&combined_pattern_re, combined_pattern.c_str(), REG_EXTENDED | REG_ENHANCED | REG_NEWLINE);
-    if (errcode != 0) {
-        regerror(errcode, &combined_pattern_re, errstr, sizeof (errstr) - 1);
-        fprintf(stderr, "ERROR compiling combined pattern '%s': %s\n", combined_pattern.c_str(), errstr);
-        abort();
-    }
+    compile(patterns);
 }
 
-Tokenizer::~Tokenizer()
+Tokenizer::Tokenizer(std::vector<std::pair<int,char const *>> const &patterns)
 {
-    regfree(&combined_pattern_re);
+    compile(patterns);
 }
 
-Token Tokenizer::tokenize(char const * const text, size_t text_size, int &offset) const
+void Tokenizer::compile(std::vector<std::pair<int,char const *>> const &patterns)
 {
-    Token       token;
-    int         errcode;
-    char        errstr[80];
-
-    regmatch_t  *match = (regmatch_t *)alloca(sizeof (regmatch_t) * (combined_pattern_re.re_nsub + 1));
-    unsigned int i;
-  
-    switch (errcode = regnexec(&combined_pattern_re, &text[offset], text_size - offset, combined_pattern_re.re_nsub + 1, match, 0)) {
-    case REG_NOMATCH:
-        offset = -1;
-        return token;
-
-    case 0:
-        // The first sub pattern starts at index 1.
-        i = 1;
-        for (auto &sub_pattern: sub_patterns) {
-            // Check if the main sub-expression around each sub-pattern is in use.
-            if (match[i].rm_so >= 0 && match[i].rm_eo >= 0) {
-                token.code = sub_pattern.code;
-
-                // Now walk through each sub-expression of this sub-pattern.
-                for (int j = 0; j < sub_pattern.nsub; j++) {
-                    if (match[i+j+1].rm_so >= 0 && match[i+j+1].rm_eo >= 0) {
-                        std::string group_value(&text[match[i+j+1].rm_so + offset], match[i+j+1].rm_eo - match[i+j+1].rm_so);
-                        token.groups.push_back(group_value);
-                    } else {
-                        token.groups.push_back(std::string());
-                    }
-                }
+    for (auto &pattern: patterns) {
+        // Compile each pattern into the NFA, which also counts the sub-expressions in each pattern.
+        try {
+            SubPattern sub_pattern(pattern.first, nfa.add_pattern(pattern.second), pattern.second);
+            if (sub_pattern.nsub > TokenView::max_groups) {
+                throw std::invalid_argument("Too many sub-expressions");
             }
+            sub_patterns.push_back(sub_pattern);
 
-            // Skip to the main sub-expression of the next sub-pattern.
-            i+= sub_pattern.nsub + 1;
+        } catch (std::invalid_argument &e) {
+            fprintf(stderr, "ERROR compiling pattern '%s': %s\n", pattern.second, e.what());
+            abort();
         }
+    }
 
-        // Update offset to behind the match.
-        offset+= match[0].rm_eo;
-
-        return token;
+    // Convert all patterns together into a single DFA.
+    try {
+        dfa = DFA(nfa);
 
-    default:
-        regerror(errcode, &combined_pattern_re, errstr, sizeof (errstr) - 1);
-        fprintf(stderr, "ERROR executing regex: %s\n", errstr);
+    } catch (std::runtime_error &e) {
+        fprintf(stderr, "ERROR compiling combined pattern: %s\n", e.what());
         abort();
     }
 }
 
-std::vector<Token> Tokenizer::tokenize(char const * const text, size_t text_size) const
+bool Tokenizer::tokenize(char const * const text, size_t text_size, size_t &offset, TokenView &token) const
 {
-    std::vector<Token>  tokens;
-    int                 offset = 0;
+    DFAMatch            match;
+    long                slots[TokenView::max_groups * 2];
 
-    while (true) {
-        // offset is an inout argument.
-        Token token = tokenize(text, text_size, offset);
-        if (offset == -1) {
-            break;
+    if (offset > text_size || !dfa.search(&text[offset], text_size - offset, match)) {
+        offset = not_found;
+        return false;
+    }
+
+    auto &sub_pattern = sub_patterns[match.pattern];
+    token.code = sub_pattern.code;
+    token.nr_groups = sub_pattern.nsub;
+    token.offset = offset + match.begin;
+    token.scan_end = offset + match.scan_end;
+
+    // Only the pattern that matched needs to be executed again to find its sub-expressions.
+    if (sub_pattern.nsub > 0) {
+        if (!nfa.capture(match.pattern, &text[offset], text_size - offset, match.begin, match.end, slots)) {
+            fprintf(stderr, "ERROR extracting sub-expressions of pattern %i.\n", match.pattern);
+            abort();
         }
-        if (token.code != Token::suppress) {
-            // Zero tokens are ignored, used for filtering comments and such.
-            tokens.push_back(token);
+
+        for (int j = 0; j < sub_pattern.nsub; j++) {
+            if (slots[j*2] >= 0 && slots[j*2+1] >= 0) {
+                token.groups[j] = boost::string_ref(&text[slots[j*2] + offset], slots[j*2+1] - slots[j*2]);
+            } else {
+                token.groups[j] = boost::string_ref();
+            }
         }
     }
+
+    // Update offset to behind the match, always making progress on an empty match.
+    offset+= match.end > 0 ? match.end : 1;
+
+    return true;
+}
+
+Token Tokenizer::tokenize(char const * const text, size_t text_size, size_t &offset) const
+{
+    TokenView   token;
+
+    if (!tokenize(text, text_size, offset, token)) {
+        return Token();
+    }
+    return Token(token);
+}
+
+std::vector<Token> Tokenizer::tokenize(char const * const text, size_t text_size) const
+{
+    std::vector<Token>  tokens;
+
+    for_each_token(text, text_size, [&tokens](const TokenView &token) {
+        tokens.push_back(Token(token));
+    });
     return tokens;
 }
 
@@ -27,7 +27,10 @@
 #include <stdbool.h>
 #include <string>
 #include <vector>
-#include <regex.h>
+#include <utility>
+#include <boost/utility/string_ref.hpp>
+#include "NFA.h"
+#include "DFA.h"
 
 namespace takevos {
 namespace hurricane {
@@ -38,25 +41,32 @@ class TokenizerIterator;
 /** Information about a pattern that was loaded into the Tokenizer.
  */
 struct SubPattern {
-    int code;   ///< Code to return when the pattern is found in the text.
-    int nsub;   ///< Number of capturing sub expressions for this pattern.
+    int         code;       ///< Code to return when the pattern is found in the text.
+    int         nsub;       ///< Number of capturing sub expressions for this pattern.
+    std::string pattern;    ///< The pattern, so that other tokenizer backends can compile it.
 
     /** Initialize a SubPattern, with information about a pattern.
-     * @param code  The token code to return when a pattern was found in the text.
-     *              0 when the token should not be returned.
-     *              -1 is used as a sentinal.
-     * @param nsub  Number of capturing sub expressions for this pattern.
+     * @param code      The token code to return when a pattern was found in the text.
+     *                  0 when the token should not be returned.
+     *                  -1 is used as a sentinal.
+     * @param nsub      Number of capturing sub expressions for this pattern.
+     * @param pattern   The pattern in extended regular expression format.
      */
-    SubPattern(int code, int nsub) : code(code), nsub(nsub) { }
+    SubPattern(int code, int nsub, std::string const &pattern) : code(code), nsub(nsub), pattern(pattern) { }
 };
 
+struct TokenView;
+
 /** Token found during parsing.
+ * The token owns copies of its captured sub expressions; it is used for
+ * test benches, the parser uses TokenView instead.
  */
 struct Token {
     static const int            sentinal = -1;
     static const int            suppress = 0;
 
     int                         code;       ///< Code matching the pattern.
+    size_t                      offset;     ///< Byte offset of the token in the text, see LineIndex for line numbers.
     std::vector<std::string>    groups;     ///< Captured sub expressions.
 
     /** Non-initialized token.
@@ -70,6 +80,11 @@ struct Token {
      */
     Token(int code, ...);
 
+    /** Copy a token from a view on the text.
+     * @param view  The token which refers to the text.
+     */
+    explicit Token(const TokenView &view);
+
     /** Compare if not equal.
      * Used in unit test to compare the result with expected.
      */
@@ -81,6 +96,24 @@ struct Token {
     bool operator==(const Token &other) const;
 };
 
+/** Token found during parsing, without copying the text.
+ * The captured sub expressions point directly into the parsed text, for
+ * example a memory mapped file, which must stay available while the token is used.
+ */
+struct TokenView {
+    static const int            max_groups = 8;
+
+    int                         code;               ///< Code matching the pattern.
+    int                         nr_groups;          ///< Number of captured sub expressions.
+    size_t                      offset;             ///< Byte offset of the token in the text.
+    size_t                      scan_end;           ///< Offset one beyond the last byte examined to find the token, see DFAMatch.
+    boost::string_ref           groups[max_groups]; ///< Captured sub expressions, empty when not used.
+
+    /** Non-initialized token.
+     */
+    TokenView() : code(Token::sentinal), nr_groups(0), offset(0), scan_end(0) { }
+};
+
 /** Output information about token.
  * Used in unit test to visually compare result with expected.
  */
@@ -88,12 +121,24 @@ std::ostream &operator<<(std::ostream &os, const Token &x);
 
 /** A sparse tokenizer for source code.
  * This tokenizer is designed to return just pieces of information from a source file at high speed.
+ *
+ * All patterns are compiled into a single DFA which finds the leftmost-longest
+ * match of any of the patterns in one pass over the text. When patterns match
+ * the same text, the pattern that was given first wins. Only for the pattern
+ * that matched are the sub expressions extracted, using the NFA.
  */
 class Tokenizer {
 public:
-    regex_t                     combined_pattern_re;    ///< All patterns are combined in a single regular expression.
+    static const size_t         not_found = (size_t)-1; ///< The offset after the last token.
+
+    NFA                         nfa;                    ///< All patterns compiled into a single NFA.
+    DFA                         dfa;                    ///< The NFA converted to a DFA for fast matching.
     std::vector<SubPattern>     sub_patterns;           ///< Information about each pattern in stored here.
 
+    /** An empty tokenizer, which does not find any tokens until compile() is called.
+     */
+    Tokenizer() { }
+
     /** Initialize the tokenizer with a set of patterns.
      * @param code1     The code to return when this pattern is found in the text.
      * @param str1      The pattern to find in the text. In extended regular expression format.
@@ -101,10 +146,10 @@ public:
      */
     Tokenizer(int code1, char const * const str1, ...);
 
-    /** Destructor.
-     * Free the regular expression.
+    /** Initialize the tokenizer with a set of patterns.
+     * @param patterns  The code and pattern of each token, in priority order.
      */
-    ~Tokenizer();
+    Tokenizer(std::vector<std::pair<int,char const *>> const &patterns);
 
     /** Find a single token in the text starting at offset.
      * Source code will be mapped into memory and there will not be a trailing zero.
@@ -113,10 +158,44 @@ public:
      * @param text          The text to parse.
      * @param text_size     The size of the text.
      * @param offset        The offset to start parsing.
-     *                      Returns the offset after the found pattern, or -1 when pattern is not found.
+     *                      Returns the offset after the found pattern, or not_found when pattern is not found.
      * @return The token found with the captured sub expressions.
      */
-    Token tokenize(char const * const text, size_t text_size, int &offset) const;
+    Token tokenize(char const * const text, size_t text_size, size_t &offset) const;
+
+    /** Find a single token in the text starting at offset, without copying the text.
+     * The captured sub expressions of the token point into the text.
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param offset        The offset to start parsing.
+     *                      Returns the offset after the found pattern, or not_found when pattern is not found.
+     * @param token         Returns the token found with the captured sub expressions.
+     * @return true when a token was found.
+     */
+    bool tokenize(char const * const text, size_t text_size, size_t &offset, TokenView &token) const;
+
+    /** Find all tokens in the text, passing each token to a visitor as soon as it is found.
+     * The tokens are never collected, so memory use does not depend on the size of the text,
+     * and the visitor can be inlined into the matching loop.
+     * Suppressed tokens are not passed to the visitor.
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param visitor       Called as visitor(const TokenView &token) for each token.
+     */
+    template <typename F>
+    void for_each_token(char const * const text, size_t text_size, F &&visitor) const {
+        TokenView   token;
+        size_t      offset = 0;
+
+        while (tokenize(text, text_size, offset, token)) {
+            if (token.code != Token::suppress) {
+                // Zero tokens are ignored, used for filtering comments and such.
+                visitor(token);
+            }
+        }
+    }
 
     /** Find all tokens in the text.
      * Source code will be mapped into memory and there will not be a trailing zero.
@@ -127,6 +206,11 @@ public:
      * @return The tokens found with the captured sub expressions.
      */
     std::vector<Token> tokenize(char const * const text, size_t text_size) const;
+
+    /** Compile a set of patterns into an empty tokenizer.
+     * @param patterns  The code and pattern of each token, in priority order.
+     */
+    void compile(std::vector<std::pair<int,char const *>> const &patterns);
 };
 
 }}
@@ -0,0 +1,200 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "TokenizerBackend.h"
+
+namespace takevos {
+namespace hurricane {
+
+POSIXTokenizerBackend::POSIXTokenizerBackend(Tokenizer const &tokenizer)
+{
+    std::string combined_pattern;
+    size_t      index = 1;
+    int         errcode;
+    char        errstr[80];
+
+    for (auto &sub_pattern: tokenizer.sub_patterns) {
+        POSIXPattern    pattern;
+        auto            translated = translate(sub_pattern.pattern, pattern.groups);
+
+        pattern.code = sub_pattern.code;
+        pattern.index = index;
+        for (auto &group: pattern.groups) {
+            group += index;
+        }
+        patterns.push_back(pattern);
+
+        combined_pattern += (combined_pattern.empty() ? "(" : "|(") + translated + ")";
+
+        // Count every sub expression of the translated pattern, including the skipped ones.
+        regex_t tmp_pattern_re;
+        if ((errcode = regcomp(&tmp_pattern_re, translated.c_str(), REG_EXTENDED | REG_NEWLINE)) != 0) {
+            regerror(errcode, &tmp_pattern_re, errstr, sizeof (errstr) - 1);
+            fprintf(stderr, "ERROR compiling pattern '%s': %s\n", translated.c_str(), errstr);
+            abort();
+        }
+        index += tmp_pattern_re.re_nsub + 1;
+        regfree(&tmp_pattern_re);
+    }
+
+    if ((errcode = regcomp(&combined_pattern_re, combined_pattern.c_str(), REG_EXTENDED | REG_NEWLINE)) != 0) {
+        regerror(errcode, &combined_pattern_re, errstr, sizeof (errstr) - 1);
+        fprintf(stderr, "ERROR compiling combined pattern '%s': %s\n", combined_pattern.c_str(), errstr);
+        abort();
+    }
+}
+
+POSIXTokenizerBackend::~POSIXTokenizerBackend()
+{
+    regfree(&combined_pattern_re);
+}
+
+std::string POSIXTokenizerBackend::translate(std::string const &pattern, std::vector<int> &groups)
+{
+    std::string r;
+    int         nr_groups = 0;
+
+    groups.clear();
+    for (size_t i = 0; i < pattern.size(); i++) {
+        auto c = pattern[i];
+
+        if (c == '\\' && i + 1 < pattern.size()) {
+            c = pattern[++i];
+            switch (c) {
+            case 'd': r += "[[:digit:]]"; break;
+            case 's': r += "[[:space:]]"; break;
+            case 'w': r += "[_[:alnum:]]"; break;
+            case 'D': r += "[^[:digit:]\n]"; break;
+            case 'S': r += "[^[:space:]\n]"; break;
+            case 'W': r += "[^_[:alnum:]\n]"; break;
+            case 'n': r += '\n'; break;
+            case 't': r += '\t'; break;
+            case 'r': r += '\r'; break;
+            case 'f': r += '\f'; break;
+            case 'v': r += '\v'; break;
+            default:
+                // Only special characters may be escaped in an extended regular expression.
+                if (!isalnum((unsigned char)c)) {
+                    r += '\\';
+                }
+                r += c;
+            }
+
+        } else if (c == '[') {
+            // Bracket expressions are copied as is, the NFA uses the same syntax.
+            auto begin = i++;
+            if (i < pattern.size() && pattern[i] == '^') {
+                i++;
+            }
+            if (i < pattern.size() && pattern[i] == ']') {
+                i++;
+            }
+            while (i < pattern.size() && pattern[i] != ']') {
+                if (pattern[i] == '[' && i + 1 < pattern.size() && (pattern[i + 1] == ':' || pattern[i + 1] == '.' || pattern[i + 1] == '=')) {
+                    auto end = pattern.find(std::string(1, pattern[i + 1]) + "]", i + 2);
+                    i = end == std::string::npos ? pattern.size() : end + 2;
+                } else {
+                    i++;
+                }
+            }
+            r += pattern.substr(begin, i - begin + 1);
+
+        } else if (c == '(') {
+            nr_groups++;
+            if (pattern.compare(i, 3, "(?:") == 0) {
+                i += 2;
+            } else {
+                groups.push_back(nr_groups);
+            }
+            r += '(';
+
+        } else if (c == '?' && i > 0 && (pattern[i - 1] == '*' || pattern[i - 1] == '+' || pattern[i - 1] == '?' || pattern[i - 1] == '}') && !(i > 1 && pattern[i - 2] == '\\')) {
+            // Non-greedy quantifier, POSIX only has leftmost-longest matching.
+
+        } else {
+            r += c;
+        }
+    }
+    return r;
+}
+
+void POSIXTokenizerBackend::for_each_token(char const * const text, size_t text_size, std::function<void(TokenView const &)> const &visitor) const
+{
+    std::vector<regmatch_t> match(combined_pattern_re.re_nsub + 1);
+    TokenView               token;
+    size_t                  offset = 0;
+    int                     errcode;
+    char                    errstr[80];
+
+    while (offset <= text_size) {
+        // REG_STARTEND searches between rm_so and rm_eo, the returned offsets are relative to text.
+        match[0].rm_so = offset;
+        match[0].rm_eo = text_size;
+        auto eflags = REG_STARTEND | (offset > 0 && text[offset - 1] != '\n' ? REG_NOTBOL : 0);
+
+        switch (errcode = regexec(&combined_pattern_re, text, match.size(), match.data(), eflags)) {
+        case REG_NOMATCH:
+            return;
+
+        case 0:
+            for (auto &pattern: patterns) {
+                // Check if the main sub-expression around each sub-pattern is in use.
+                if (match[pattern.index].rm_so < 0) {
+                    continue;
+                }
+
+                if (pattern.code != Token::suppress) {
+                    token.code = pattern.code;
+                    token.nr_groups = (int)pattern.groups.size();
+                    token.offset = match[0].rm_so;
+                    for (size_t j = 0; j < pattern.groups.size(); j++) {
+                        auto &group = match[pattern.groups[j]];
+                        if (group.rm_so >= 0 && group.rm_eo >= 0) {
+                            token.groups[j] = boost::string_ref(&text[group.rm_so], group.rm_eo - group.rm_so);
+                        } else {
+                            token.groups[j] = boost::string_ref();
+                        }
+                    }
+                    visitor(token);
+                }
+                break;
+            }
+
+            // Update offset to behind the match, always making progress on an empty match.
+            offset = (size_t)match[0].rm_eo > offset ? match[0].rm_eo : offset + 1;
+            break;
+
+        default:
+            regerror(errcode, &combined_pattern_re, errstr, sizeof (errstr) - 1);
+            fprintf(stderr, "ERROR executing regex: %s\n", errstr);
+            abort();
+        }
+    }
+}
+
+}}
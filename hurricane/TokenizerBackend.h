@@ -0,0 +1,100 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_TOKENIZERBACKEND_H
+#define TAKEVOS_HURRICANE_TOKENIZERBACKEND_H
+#include <stdbool.h>
+#include <regex.h>
+#include <functional>
+#include <vector>
+#include "Tokenizer.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** A method of finding the tokens of a grammar in a text.
+ * Each backend should find the same tokens, so that they can be swapped
+ * with the --tokenizer option and compared with --benchmark-tokenizers.
+ */
+class TokenizerBackend {
+public:
+    virtual ~TokenizerBackend() {}
+
+    /** The name of the backend, as used by the --tokenizer option.
+     */
+    virtual char const *name(void) const = 0;
+
+    /** Find all tokens in the text, passing each token to a visitor as soon as it is found.
+     * Suppressed tokens are not passed to the visitor.
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param visitor       Called as visitor(const TokenView &token) for each token.
+     */
+    virtual void for_each_token(char const * const text, size_t text_size, std::function<void(TokenView const &)> const &visitor) const = 0;
+};
+
+/** A backend using the regcomp() and regexec() functions of the C library.
+ *
+ * The patterns of a Tokenizer are translated to POSIX extended regular
+ * expressions and combined into a single expression, each pattern in its own
+ * sub expression. Non-capturing groups become capturing groups which are
+ * skipped, the \\s, \\w and \\d escapes become bracket expressions and
+ * non-greedy quantifiers become greedy, which only affects sub expressions.
+ * Searching past a NUL byte and without a trailing NUL requires REG_STARTEND.
+ */
+class POSIXTokenizerBackend : public TokenizerBackend {
+public:
+    /** Compile the patterns of a tokenizer.
+     * @param tokenizer     The tokenizer with the patterns, which are copied.
+     */
+    POSIXTokenizerBackend(Tokenizer const &tokenizer);
+    virtual ~POSIXTokenizerBackend();
+
+    virtual char const *name(void) const { return "posix"; }
+    virtual void for_each_token(char const * const text, size_t text_size, std::function<void(TokenView const &)> const &visitor) const;
+
+    /** Translate a pattern to a POSIX extended regular expression.
+     * @param pattern   The pattern in the format accepted by the NFA.
+     * @param groups    Returns, for each capturing sub expression of the pattern, the index of
+     *                  the sub expression in the translated pattern, starting at 1.
+     * @return The translated pattern.
+     */
+    static std::string translate(std::string const &pattern, std::vector<int> &groups);
+
+private:
+    /** A pattern within the combined expression.
+     */
+    struct POSIXPattern {
+        int                 code;       ///< Token code.
+        size_t              index;      ///< Index of the sub expression around the whole pattern.
+        std::vector<int>    groups;     ///< Index of each capturing sub expression.
+    };
+
+    regex_t                     combined_pattern_re;
+    std::vector<POSIXPattern>   patterns;
+};
+
+}}
+#endif
@@ -0,0 +1,242 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <atomic>
+#include <type_traits>
+#include "TokenizerCache.h"
+#include "FileHandle.h"
+#include "strings.h"
+#include "md5.h"
+#include "ContentHash.h"
+
+namespace takevos {
+namespace hurricane {
+
+const uint32_t TokenizerCache::version;
+
+/** Identifies a cache file of a tokenizer.
+ */
+static const char TokenizerCache_magic[8] = {'H', 'R', 'C', 'T', 'O', 'K', 'E', 'N'};
+
+static_assert(std::is_trivially_copyable<NFANode>::value, "NFANode is stored as bytes");
+static_assert(std::is_trivially_copyable<DFATransition>::value, "DFATransition is stored as bytes");
+static_assert(std::is_trivially_copyable<DFAAccelerator>::value, "DFAAccelerator is stored as bytes");
+static_assert(std::is_trivially_copyable<std::bitset<256>>::value, "std::bitset is stored as bytes");
+
+/** The start of a cache file.
+ */
+struct TokenizerCacheHeader {
+    char        magic[8];
+    uint32_t    checksum_algorithm; ///< The ContentHash algorithm of the checksum.
+    uint128_t   key;            ///< Hash of everything the data was derived from.
+    uint128_t   checksum;       ///< Hash of the data following the header.
+    uint64_t    data_size;      ///< Size of the data following the header.
+
+    TokenizerCacheHeader(char const *magic, uint128_t key) {
+        // Also clear the padding, which is written to the file.
+        memset(this, 0, sizeof (*this));
+        memcpy(this->magic, magic, sizeof (this->magic));
+        this->key = key;
+    }
+};
+
+void TokenizerCache::compile(Tokenizer &tokenizer, std::vector<std::pair<int,char const *>> const &patterns, fs::path const &cache_directory)
+{
+    if (cache_directory.empty()) {
+        tokenizer.compile(patterns);
+        return;
+    }
+
+    auto k = key(patterns);
+    auto filename = cache_directory / string_format("tokenizer-%016llx%016llx.cache", (unsigned long long)(k >> 64), (unsigned long long)k);
+    if (load(filename, k, tokenizer)) {
+        return;
+    }
+
+    tokenizer.compile(patterns);
+
+    // The cache is only an optimization, the next invocation will try again.
+    try {
+        fs::create_directories(cache_directory);
+        save(filename, k, tokenizer);
+    } catch (std::exception &) {
+    }
+}
+
+uint128_t TokenizerCache::key(std::vector<std::pair<int,char const *>> const &patterns)
+{
+    MD5Hasher hasher;
+
+    // The sizes of the structures that are stored as bytes are included, so that
+    // a file of an incompatible compiler or architecture is not used.
+    hasher.value(version);
+    hasher.value((uint32_t)sizeof (NFANode));
+    hasher.value((uint32_t)sizeof (DFATransition));
+    hasher.value((uint32_t)sizeof (DFAAccelerator));
+    hasher.value((uint32_t)sizeof (std::bitset<256>));
+    for (auto &pattern: patterns) {
+        hasher.value(pattern.first);
+        hasher.string(pattern.second);
+    }
+    return hasher.final();
+}
+
+uint128_t TokenizerCache::key(Tokenizer const &tokenizer)
+{
+    std::vector<std::pair<int,char const *>> patterns;
+
+    for (auto &sub_pattern: tokenizer.sub_patterns) {
+        patterns.push_back(std::make_pair(sub_pattern.code, sub_pattern.pattern.c_str()));
+    }
+    return key(patterns);
+}
+
+bool TokenizerCache::load(fs::path const &filename, uint128_t key, Tokenizer &tokenizer)
+{
+    auto valid = read_file(filename, TokenizerCache_magic, key, [&tokenizer](TokenizerCacheReader &reader) {
+        Tokenizer   &t = tokenizer;
+        uint64_t    nr_sub_patterns;
+
+        reader.value(nr_sub_patterns);
+        for (uint64_t i = 0; i < nr_sub_patterns; i++) {
+            SubPattern sub_pattern(0, 0, std::string());
+            reader.value(sub_pattern.code);
+            reader.value(sub_pattern.nsub);
+            reader.string(sub_pattern.pattern);
+            t.sub_patterns.push_back(sub_pattern);
+        }
+
+        reader.vector(t.nfa.nodes);
+        reader.vector(t.nfa.char_sets);
+        reader.vector(t.nfa.pattern_starts);
+        reader.vector(t.nfa.pattern_nsubs);
+
+        reader.value(t.dfa.nr_symbols);
+        reader.value(t.dfa.end_of_text);
+        reader.value(t.dfa.max_layers);
+        reader.value(t.dfa.byte_classes);
+        reader.vector(t.dfa.transitions);
+        reader.vector(t.dfa.layer_maps);
+        reader.vector(t.dfa.state_layers);
+        reader.vector(t.dfa.state_accelerators);
+        reader.vector(t.dfa.accelerators);
+    });
+
+    if (!valid) {
+        tokenizer = Tokenizer();
+    }
+    return valid;
+}
+
+void TokenizerCache::save(fs::path const &filename, uint128_t key, Tokenizer const &tokenizer)
+{
+    TokenizerCacheWriter    writer;
+    Tokenizer const         &t = tokenizer;
+
+    writer.value((uint64_t)t.sub_patterns.size());
+    for (auto &sub_pattern: t.sub_patterns) {
+        writer.value(sub_pattern.code);
+        writer.value(sub_pattern.nsub);
+        writer.string(sub_pattern.pattern);
+    }
+
+    writer.vector(t.nfa.nodes);
+    writer.vector(t.nfa.char_sets);
+    writer.vector(t.nfa.pattern_starts);
+    writer.vector(t.nfa.pattern_nsubs);
+
+    writer.value(t.dfa.nr_symbols);
+    writer.value(t.dfa.end_of_text);
+    writer.value(t.dfa.max_layers);
+    writer.value(t.dfa.byte_classes);
+    writer.vector(t.dfa.transitions);
+    writer.vector(t.dfa.layer_maps);
+    writer.vector(t.dfa.state_layers);
+    writer.vector(t.dfa.state_accelerators);
+    writer.vector(t.dfa.accelerators);
+
+    write_file(filename, TokenizerCache_magic, key, writer);
+}
+
+bool TokenizerCache::read_file(fs::path const &filename, char const *magic, uint128_t key, std::function<void(TokenizerCacheReader &)> const &f)
+{
+    TokenizerCacheHeader    expected(magic, key);
+    TokenizerCacheHeader    header(magic, 0);
+    FileHandle              handle(filename);
+
+    try {
+        handle.open();
+    } catch (std::runtime_error &) {
+        return false;
+    }
+
+    try {
+        if (handle.data_size < sizeof (header)) {
+            throw std::runtime_error("Truncated cache file");
+        }
+        memcpy(&header, handle.data, sizeof (header));
+
+        auto data = handle.data + sizeof (header);
+        auto data_size = handle.data_size - sizeof (header);
+        if (
+            memcmp(header.magic, expected.magic, sizeof (header.magic)) != 0 || header.key != expected.key ||
+            header.data_size != data_size || header.checksum_algorithm != ContentHash::fast ||
+            ContentHash::hash(ContentHash::fast, data, data_size).value != header.checksum
+        ) {
+            throw std::runtime_error("Invalid cache file");
+        }
+
+        TokenizerCacheReader reader(data, data_size);
+        f(reader);
+
+    } catch (std::runtime_error &) {
+        handle.close();
+        return false;
+    }
+
+    handle.close();
+    return true;
+}
+
+void TokenizerCache::write_file(fs::path const &filename, char const *magic, uint128_t key, TokenizerCacheWriter const &writer)
+{
+    TokenizerCacheHeader    header(magic, key);
+
+    header.checksum_algorithm = ContentHash::fast;
+    header.checksum = ContentHash::hash(ContentHash::fast, writer.data.data(), writer.data.size()).value;
+    header.data_size = writer.data.size();
+
+    // Threads of this process may write the same file at the same time, each through its own temporary file.
+    static std::atomic<unsigned int> nr_written(0);
+    auto tmp_filename = filename;
+    tmp_filename += string_format(".%i.%u.tmp", (int)getpid(), nr_written++);
+    write_to_file(tmp_filename, std::string((char const *)&header, sizeof (header)) + writer.data);
+    fs::rename(tmp_filename, filename);
+}
+
+}}
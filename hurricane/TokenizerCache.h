@@ -0,0 +1,201 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_TOKENIZERCACHE_H
+#define TAKEVOS_HURRICANE_TOKENIZERCACHE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <boost/filesystem.hpp>
+#include "Tokenizer.h"
+#include "numbers.h"
+
+namespace fs = boost::filesystem;
+
+namespace takevos {
+namespace hurricane {
+
+/** Serialize values into a byte string, for a cache file.
+ */
+struct TokenizerCacheWriter {
+    std::string data;
+
+    template <typename T>
+    void value(T const &x) {
+        data.append((char const *)&x, sizeof (x));
+    }
+
+    template <typename T>
+    void vector(std::vector<T> const &x) {
+        value((uint64_t)x.size());
+        data.append((char const *)x.data(), x.size() * sizeof (T));
+    }
+
+    void string(std::string const &x) {
+        value((uint64_t)x.size());
+        data.append(x);
+    }
+};
+
+/** Deserialize values from a byte string, of a cache file.
+ * Throws std::runtime_error when reading beyond the end of the data.
+ */
+struct TokenizerCacheReader {
+    char const  *data;
+    size_t      data_size;
+    size_t      offset;
+
+    TokenizerCacheReader(char const *data, size_t data_size) : data(data), data_size(data_size), offset(0) {}
+
+    void bytes(void *x, size_t size) {
+        if (size > data_size - offset) {
+            throw std::runtime_error("Truncated cache file");
+        }
+        memcpy(x, &data[offset], size);
+        offset += size;
+    }
+
+    template <typename T>
+    void value(T &x) {
+        bytes(&x, sizeof (x));
+    }
+
+    template <typename T>
+    void vector(std::vector<T> &x) {
+        uint64_t size;
+        value(size);
+        if (size > (data_size - offset) / sizeof (T)) {
+            throw std::runtime_error("Truncated cache file");
+        }
+
+        // The stored types are trivially copyable, but not all are default constructible.
+        x.clear();
+        x.reserve(size);
+        for (uint64_t i = 0; i < size; i++) {
+            typename std::aligned_storage<sizeof (T), alignof (T)>::type tmp;
+            bytes(&tmp, sizeof (T));
+            x.push_back(*reinterpret_cast<T *>(&tmp));
+        }
+    }
+
+    void string(std::string &x) {
+        uint64_t size;
+        value(size);
+        if (size > data_size - offset) {
+            throw std::runtime_error("Truncated cache file");
+        }
+        x.assign(&data[offset], size);
+        offset += size;
+    }
+};
+
+/** Compiled tokenizers stored in files, so that patterns are only compiled once.
+ *
+ * A cache file contains the patterns with their codes and number of sub
+ * expressions, the NFA and the DFA of a Tokenizer. Its name is derived from
+ * a hash of the patterns and the version of the file format, so that a
+ * different set of patterns uses a different file. The file is mapped into
+ * memory and copied into the tables of the Tokenizer; a file that is damaged,
+ * written by a different version or on a different architecture is ignored
+ * and replaced.
+ */
+class TokenizerCache {
+public:
+    /** The version of the file format.
+     * Increment when the file format, or the construction of the NFA or DFA changes.
+     */
+    static const uint32_t version = 3;
+
+    /** Compile the patterns, or load them from the cache.
+     * @param tokenizer         An empty tokenizer, which receives the compiled patterns.
+     * @param patterns          The code and pattern of each token, in priority order.
+     * @param cache_directory   The directory with cache files, or empty to always compile.
+     */
+    static void compile(Tokenizer &tokenizer, std::vector<std::pair<int,char const *>> const &patterns, fs::path const &cache_directory);
+
+    /** The hash of a set of patterns.
+     * @param patterns          The code and pattern of each token, in priority order.
+     */
+    static uint128_t key(std::vector<std::pair<int,char const *>> const &patterns);
+
+    /** The hash of the patterns of a compiled tokenizer.
+     * Files with information derived from the tokens of a tokenizer use this key,
+     * so that they are ignored when the patterns change.
+     *
+     * @param tokenizer         The compiled tokenizer.
+     */
+    static uint128_t key(Tokenizer const &tokenizer);
+
+    /** Load a compiled tokenizer from a cache file.
+     * @param filename          The cache file.
+     * @param key               The hash of the patterns, which must match the file.
+     * @param tokenizer         An empty tokenizer, which receives the compiled patterns.
+     * @return true when the file exists and was valid.
+     */
+    static bool load(fs::path const &filename, uint128_t key, Tokenizer &tokenizer);
+
+    /** Save a compiled tokenizer to a cache file.
+     * The file is written under a temporary name and then renamed, so that concurrent
+     * invocations never see a partially written file.
+     * Throws std::runtime_error when the file could not be written.
+     *
+     * @param filename          The cache file.
+     * @param key               The hash of the patterns.
+     * @param tokenizer         The compiled tokenizer.
+     */
+    static void save(fs::path const &filename, uint128_t key, Tokenizer const &tokenizer);
+
+    /** Read a cache file.
+     * The header of the file is checked, and the checksum of the data.
+     *
+     * @param filename          The cache file.
+     * @param magic             Eight characters identifying the kind of cache file.
+     * @param key               Hash of everything the data was derived from, which must match the file.
+     * @param f                 Called as f(TokenizerCacheReader &reader) to deserialize the data,
+     *                          may throw std::runtime_error when the data is not valid.
+     * @return true when the file exists and was valid.
+     */
+    static bool read_file(fs::path const &filename, char const *magic, uint128_t key, std::function<void(TokenizerCacheReader &)> const &f);
+
+    /** Write a cache file.
+     * The file is written under a temporary name and then renamed, so that concurrent
+     * invocations never see a partially written file.
+     * Throws std::runtime_error when the file could not be written.
+     *
+     * @param filename          The cache file.
+     * @param magic             Eight characters identifying the kind of cache file.
+     * @param key               Hash of everything the data was derived from.
+     * @param writer            The serialized data.
+     */
+    static void write_file(fs::path const &filename, char const *magic, uint128_t key, TokenizerCacheWriter const &writer);
+};
+
+}}
+#endif
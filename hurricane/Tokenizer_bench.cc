@@ -0,0 +1,369 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "VHDLLexer.h"
+
+using namespace takevos::hurricane;
+
+/** Number of calls to operator new since the start of the program.
+ */
+static std::atomic<size_t> Tokenizer_bench_allocations(0);
+
+void *operator new(size_t size)
+{
+    Tokenizer_bench_allocations++;
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/** A set of synthetic source files.
+ */
+struct Corpus {
+    std::string                 name;
+    std::vector<std::string>    files;
+
+    size_t size(void) const {
+        size_t r = 0;
+        for (auto const &file: files) {
+            r += file.size();
+        }
+        return r;
+    }
+};
+
+/** Generator of deterministic VHDL fragments.
+ * std::minstd_rand is fully specified by the standard, so every platform
+ * generates the same corpora.
+ */
+struct Generator {
+    std::minstd_rand    random;
+    int                 counter;
+
+    Generator() : random(1), counter(0) {}
+
+    int pick(int n) {
+        return random() % n;
+    }
+
+    std::string name(char const *prefix) {
+        return prefix + std::to_string(counter++);
+    }
+
+    std::string comment(void) {
+        static char const * const comments[] = {
+            "    -- The entity foo is not instantiated here.\n",
+            "    -- u1 : entity work.old_cell port map (a => b);\n",
+            "    -- TODO: check the timing of this path after synthesis.\n",
+            "    --------------------------------------------------------------------\n",
+            "    /* A block comment which\n       spans several lines. */\n",
+        };
+        return comments[pick(5)];
+    }
+
+    std::string header(void) {
+        return "library ieee;\nuse ieee.std_logic_1164.all;\nuse ieee.numeric_std.all;\nlibrary work;\nuse work.cells.all;\n\n";
+    }
+
+    std::string entity(std::string const &entity_name, int nr_ports) {
+        std::string r = "entity " + entity_name + " is\n    port (\n";
+        for (int i = 0; i < nr_ports; i++) {
+            r += "        p" + std::to_string(i) + " : in std_logic;\n";
+        }
+        r += "        y : out std_logic\n    );\nend entity;\n\n";
+        return r;
+    }
+
+    std::string statement(void) {
+        auto s = name("s");
+        switch (pick(4)) {
+        case 0: return "    " + s + " <= a and b;\n";
+        case 1: return "    " + s + " <= '1' when en = '1' else '0';\n";
+        case 2: return "    assert " + s + " = '0' report \"entity x is missing\" severity note;\n";
+        default: return "    " + s + " <= (c xor d) or not e;\n";
+        }
+    }
+
+    std::string instance(int nr_associations) {
+        std::string r = "    " + name("u") + " : ";
+        switch (pick(3)) {
+        case 0: r += "entity work." + name("cell") + "(rtl)"; break;
+        case 1: r += "entity work." + name("cell"); break;
+        default: r += "component " + name("cell"); break;
+        }
+        r += "\n        port map (";
+        for (int i = 0; i < nr_associations; i++) {
+            r += (i ? ", " : "") + std::string("p") + std::to_string(i) + " => " + name("n");
+        }
+        r += ");\n";
+        return r;
+    }
+
+    std::string architecture(std::string const &entity_name) {
+        return "architecture rtl of " + entity_name + " is\n    signal a, b, c, d, e, en : std_logic;\nbegin\n";
+    }
+};
+
+/** Many small files, as found in a typical project.
+ */
+static Corpus Tokenizer_bench_small_files(size_t size)
+{
+    Corpus      corpus;
+    Generator   g;
+
+    corpus.name = "small_files";
+    for (size_t total = 0; total < size;) {
+        auto entity_name = g.name("e");
+        auto text = g.header() + g.entity(entity_name, 1 + g.pick(8)) + g.architecture(entity_name);
+        for (int i = g.pick(30); i > 0; i--) {
+            switch (g.pick(3)) {
+            case 0: text += g.comment(); break;
+            case 1: text += g.instance(1 + g.pick(4)); break;
+            default: text += g.statement(); break;
+            }
+        }
+        text += "end architecture;\n";
+
+        total += text.size();
+        corpus.files.push_back(std::move(text));
+    }
+    return corpus;
+}
+
+/** A single huge flattened netlist, as written by a synthesis tool.
+ */
+static Corpus Tokenizer_bench_netlist(size_t size)
+{
+    Corpus      corpus;
+    Generator   g;
+
+    corpus.name = "netlist";
+    std::string text = g.header() + g.entity("top", 64) + g.architecture("top");
+    while (text.size() < size) {
+        if (g.pick(4) == 0) {
+            text += "    signal " + g.name("n") + " : std_logic;\n";
+        } else {
+            text += g.instance(2 + g.pick(4));
+        }
+    }
+    text += "end architecture;\n";
+    corpus.files.push_back(std::move(text));
+    return corpus;
+}
+
+/** A file which is mostly comments, including commented-out statements.
+ */
+static Corpus Tokenizer_bench_comments(size_t size)
+{
+    Corpus      corpus;
+    Generator   g;
+
+    corpus.name = "comments";
+    std::string text = g.header() + g.entity("commented", 4) + g.architecture("commented");
+    while (text.size() < size) {
+        text += g.pick(10) < 8 ? g.comment() : g.statement();
+    }
+    text += "end architecture;\n";
+    corpus.files.push_back(std::move(text));
+    return corpus;
+}
+
+/** A file which consists of instantiations with short port maps.
+ */
+static Corpus Tokenizer_bench_instances(size_t size)
+{
+    Corpus      corpus;
+    Generator   g;
+
+    corpus.name = "instances";
+    std::string text = g.header() + g.entity("instances", 4) + g.architecture("instances");
+    while (text.size() < size) {
+        text += g.instance(1);
+    }
+    text += "end architecture;\n";
+    corpus.files.push_back(std::move(text));
+    return corpus;
+}
+
+/** The results of the runs of a method, passed from the child process that ran them.
+ */
+struct Tokenizer_bench_result {
+    double  best;               ///< Seconds of the fastest run.
+    size_t  nr_tokens;          ///< Number of tokens found in the corpus.
+    size_t  nr_allocations;     ///< Number of allocations of the last run.
+};
+
+/** Peak resident set size of a child process in bytes.
+ * @param usage     The resource usage of the child, from wait4().
+ */
+static size_t Tokenizer_bench_peak_rss(struct rusage const &usage)
+{
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+}
+
+/** Run a tokenizer over every file of a corpus and print the results as a JSON object.
+ * The best of a number of runs is reported, to reduce noise from the rest of the system.
+ * The runs are done by a child process, so that the peak resident set size is of this
+ * method and corpus only; the maximum of the process only grows between methods.
+ *
+ * @param corpus    The files to tokenize.
+ * @param method    Name of the tokenizer.
+ * @param nr_runs   Number of runs.
+ * @param last      true for the last result, which is not followed by a comma.
+ * @param f         Called as f(text, text_size), returns the number of tokens found.
+ */
+template <typename F>
+static void Tokenizer_bench_run(Corpus const &corpus, char const *method, int nr_runs, bool last, F &&f)
+{
+    Tokenizer_bench_result  result = {1e99, 0, 0};
+    struct rusage           usage;
+    int                     status;
+    int                     fds[2];
+    pid_t                   pid;
+
+    fflush(stdout);
+    if (pipe(fds) == -1 || (pid = fork()) == -1) {
+        perror("Cannot start a process for a method");
+        exit(1);
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        for (int run = 0; run < nr_runs; run++) {
+            size_t allocations_before = Tokenizer_bench_allocations;
+            auto start = std::chrono::steady_clock::now();
+
+            result.nr_tokens = 0;
+            for (auto const &file: corpus.files) {
+                result.nr_tokens += f(file.data(), file.size());
+            }
+
+            auto end = std::chrono::steady_clock::now();
+            result.nr_allocations = Tokenizer_bench_allocations - allocations_before;
+            result.best = std::min(result.best, std::chrono::duration<double>(end - start).count());
+        }
+        _exit(write(fds[1], &result, sizeof (result)) == sizeof (result) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    auto nr_read = read(fds[0], &result, sizeof (result));
+    close(fds[0]);
+    if (wait4(pid, &status, 0, &usage) == -1 || nr_read != sizeof (result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "ERROR running method %s on corpus %s.\n", method, corpus.name.c_str());
+        exit(1);
+    }
+
+    printf("        {\"method\": \"%s\", \"tokens\": %zu, \"seconds\": %.6f, \"mb_per_s\": %.1f, \"tokens_per_s\": %.0f, \"allocations_per_token\": %.3f, \"peak_rss\": %zu}%s\n",
+        method, result.nr_tokens, result.best,
+        corpus.size() / result.best / 1e6,
+        result.nr_tokens / result.best,
+        result.nr_tokens ? (double)result.nr_allocations / result.nr_tokens : 0.0,
+        Tokenizer_bench_peak_rss(usage),
+        last ? "" : ","
+    );
+}
+
+static void Tokenizer_bench_corpus(Corpus const &corpus, int nr_runs, bool last)
+{
+    auto const &grammar = VHDLSourceFile::vhdl_grammar();
+
+    printf("    {\"corpus\": \"%s\", \"files\": %zu, \"bytes\": %zu, \"results\": [\n", corpus.name.c_str(), corpus.files.size(), corpus.size());
+
+    Tokenizer_bench_run(corpus, "tokenize", nr_runs, false, [&grammar](char const *text, size_t text_size) {
+        return grammar.tokenizer.tokenize(text, text_size).size();
+    });
+    Tokenizer_bench_run(corpus, "for_each_token", nr_runs, false, [&grammar](char const *text, size_t text_size) {
+        size_t nr_tokens = 0;
+        grammar.for_each_token(text, text_size, [&nr_tokens](auto, auto...) { nr_tokens++; });
+        return nr_tokens;
+    });
+    Tokenizer_bench_run(corpus, "lexer", nr_runs, true, [](char const *text, size_t text_size) {
+        size_t nr_tokens = 0;
+        VHDLLexer::for_each_token(text, text_size, [&nr_tokens](auto, auto...) { nr_tokens++; });
+        return nr_tokens;
+    });
+
+    printf("    ]}%s\n", last ? "" : ",");
+}
+
+static void Tokenizer_bench_usage(void)
+{
+    fprintf(stderr, "Usage: Tokenizer_bench [-s <megabytes>] [-r <runs>]\n");
+    fprintf(stderr, "  -s <megabytes>    Size of each corpus, default 32.\n");
+    fprintf(stderr, "  -r <runs>         Number of runs of which the best is reported, default 5.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t  size = 32;
+    int     nr_runs = 5;
+    int     ch;
+
+    while ((ch = getopt(argc, argv, "hs:r:")) != -1) {
+        switch (ch) {
+        case 's': size = strtoul(optarg, NULL, 10); break;
+        case 'r': nr_runs = std::max(1, atoi(optarg)); break;
+        default: Tokenizer_bench_usage(); return 2;
+        }
+    }
+    size *= 1024 * 1024;
+
+    // Build the grammar before measuring, the DFA is compiled on first use.
+    VHDLSourceFile::vhdl_grammar();
+
+    printf("{\"corpora\": [\n");
+    Tokenizer_bench_corpus(Tokenizer_bench_small_files(size), nr_runs, false);
+    Tokenizer_bench_corpus(Tokenizer_bench_netlist(size), nr_runs, false);
+    Tokenizer_bench_corpus(Tokenizer_bench_comments(size), nr_runs, false);
+    Tokenizer_bench_corpus(Tokenizer_bench_instances(size), nr_runs, true);
+    printf("]}\n");
+    return 0;
+}
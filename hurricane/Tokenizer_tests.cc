@@ -26,7 +26,12 @@
 #define BOOST_TEST_MODULE Tokenizer
 #include <boost/test/unit_test.hpp>
 #include <boost/test/execution_monitor.hpp>
+#include <unistd.h>
+#include <fcntl.h>
 #include "Tokenizer.h"
+#include "Grammar.h"
+#include "FileHandle.h"
+#include "strings.h"
 
 using namespace takevos::hurricane;
 
@@ -120,3 +125,355 @@ BOOST_AUTO_TEST_CASE(tokenizer_groups_4)
 
 
 
+
+BOOST_AUTO_TEST_CASE(tokenizer_leftmost_longest_1)
+{
+    Tokenizer           p(
+        1, R"||(ab)||",
+        2, R"||(bcdef)||",
+        3, R"||(abc)||",
+        Token::sentinal
+    );
+    const char          *test = "abcdef";
+    std::vector<Token>  expected;
+
+    auto result = p.tokenize(test, strlen(test));
+    expected.push_back(Token(3, NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_priority_1)
+{
+    Tokenizer           p(
+        1, R"__(--\s+pragma\s+([a-z]+))__",
+        0, R"__(--.*?$)__",
+        2, R"__(use\s+([a-z]+);)__",
+        Token::sentinal
+    );
+    const char          *test =
+        "-- pragma foo\n"
+        "-- use bar;\n"
+        "use baz;\n";
+    std::vector<Token>  expected;
+
+    auto result = p.tokenize(test, strlen(test));
+    expected.push_back(Token(1, "foo", NULL));
+    expected.push_back(Token(2, "baz", NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_optional_groups_1)
+{
+    Tokenizer           p(
+        1, R"__((?:(\w+)\.)?(\w+)(?:\((\w+)\))?\s+port)__",
+        Token::sentinal
+    );
+    const char          *test = "work.foo(rtl) port; bar port;";
+    std::vector<Token>  expected;
+
+    auto result = p.tokenize(test, strlen(test));
+    expected.push_back(Token(1, "work", "foo", "rtl", NULL));
+    expected.push_back(Token(1, "", "bar", "", NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_view_1)
+{
+    Tokenizer           p(
+        1, R"__(use\s+([a-z.]+)\s*;)__",
+        Token::sentinal
+    );
+    const char          *test = "library foo;\nuse foo.bar;\n";
+    TokenView           token;
+    size_t              offset = 0;
+
+    BOOST_CHECK(p.tokenize(test, strlen(test), offset, token));
+    BOOST_CHECK_EQUAL(token.code, 1);
+    BOOST_CHECK_EQUAL(token.nr_groups, 1);
+    BOOST_CHECK(token.groups[0].data() == &test[17]);
+    BOOST_CHECK_EQUAL(token.groups[0].to_string(), "foo.bar");
+    BOOST_CHECK_EQUAL(Token(token), Token(1, "foo.bar", NULL));
+
+    BOOST_CHECK(!p.tokenize(test, strlen(test), offset, token));
+    BOOST_CHECK_EQUAL(offset, Tokenizer::not_found);
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_for_each_token_1)
+{
+    Tokenizer           p(
+        0, R"__(--.*$)__",
+        1, R"__(library\s+(\w+)\s*;)__",
+        Token::sentinal
+    );
+    const char          *test = "library foo;\n-- library baz;\nlibrary bar;\n";
+    std::vector<Token>  result;
+    std::vector<Token>  expected;
+
+    p.for_each_token(test, strlen(test), [&result](const TokenView &token) {
+        result.push_back(Token(token));
+    });
+    expected.push_back(Token(1, "foo", NULL));
+    expected.push_back(Token(1, "bar", NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_accelerated_1)
+{
+    Tokenizer           p(
+        1, "--.*$",
+        2, "entity\\s+(\\w+)",
+        Token::sentinal
+    );
+    std::string         test;
+    std::vector<Token>  expected;
+
+    // Long comments and whitespace are skipped by the prefilter of the DFA.
+    for (int i = 0; i < 10; i++) {
+        test += "-- entity comment with many words that do not match anything at all\n";
+        test += "                                                  entity foo" + std::to_string(i) + "\n";
+        expected.push_back(Token(1, NULL));
+        expected.push_back(Token(2, ("foo" + std::to_string(i)).data(), NULL));
+    }
+
+    auto result = p.tokenize(test.data(), test.size());
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    BOOST_CHECK(!p.dfa.accelerators.empty());
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_large_file_1)
+{
+    if (sizeof (size_t) < 8) {
+        return;
+    }
+
+    Tokenizer           p(
+        1, "entity\\s+(\\w+)",
+        Token::sentinal
+    );
+    fs::path            path = string_format("/tmp/Tokenizer-tests-%i.vhd", (int)getpid());
+    size_t              size = 0x120000000;
+    std::vector<size_t> offsets = {0, 0x7ffffff8, 0xfffffff8, 0x100001000, size - 16};
+    std::vector<size_t> result_offsets;
+    std::vector<Token>  result;
+
+    // A sparse file, with tokens across the 2GB and 4GB boundaries.
+    int fd = open(path.string().c_str(), O_CREAT | O_TRUNC | O_RDWR, 0600);
+    BOOST_REQUIRE(fd != -1);
+    BOOST_REQUIRE(ftruncate(fd, size) == 0);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        auto text = "entity e" + std::to_string(i) + "\n";
+        BOOST_REQUIRE(pwrite(fd, text.data(), text.size(), offsets[i]) == (ssize_t)text.size());
+    }
+    close(fd);
+
+    FileHandle handle(path);
+    handle.open();
+    BOOST_CHECK_EQUAL(handle.data_size, size);
+    p.for_each_token(handle.data, handle.data_size, [&](const TokenView &token) {
+        result_offsets.push_back(token.offset);
+        result.push_back(Token(token));
+    });
+    handle.close();
+    fs::remove(path);
+
+    BOOST_REQUIRE_EQUAL(result.size(), offsets.size());
+    for (size_t i = 0; i < offsets.size(); i++) {
+        BOOST_CHECK_EQUAL(result_offsets[i], offsets[i]);
+        BOOST_CHECK_EQUAL(result[i], Token(1, ("e" + std::to_string(i)).data(), NULL));
+    }
+}
+
+static_assert(count_groups("a(b)(?:c)\\(d") == 1, "Escaped and non-capturing groups are not counted");
+static_assert(count_groups("[(][[:alnum:](]+([]()])") == 1, "Parenthesis in brackets are not counted");
+
+struct GrammarTestHandler {
+    std::vector<Token> tokens;
+
+    void operator()(TokenCode<1>) {
+        tokens.push_back(Token(1, NULL));
+    }
+
+    void operator()(TokenCode<2>, boost::string_ref a, boost::string_ref b) {
+        tokens.push_back(Token(2, a.to_string().data(), b.to_string().data(), NULL));
+    }
+};
+
+BOOST_AUTO_TEST_CASE(grammar_1)
+{
+    using TestGrammar = Grammar<
+        TokenRule<Token::suppress, 0>,
+        TokenRule<1, 0>,
+        TokenRule<2, 2>
+    >;
+    static constexpr TestGrammar::RuleTuple rules {
+        "--.*$",
+        "foo",
+        "([0-9]+)-([a-z]*)"
+    };
+    TestGrammar         p(rules);
+    GrammarTestHandler  handler;
+    const char          *test = "foo 12-ab -- foo 1-a\n3- foo";
+    std::vector<Token>  expected;
+
+    p.for_each_token(test, strlen(test), handler);
+    expected.push_back(Token(1, NULL));
+    expected.push_back(Token(2, "12", "ab", NULL));
+    expected.push_back(Token(2, "3", "", NULL));
+    expected.push_back(Token(1, NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(handler.tokens.begin(), handler.tokens.end(), expected.begin(), expected.end());
+
+    // The tokens of the plain tokenizer are passed to the same handler.
+    GrammarTestHandler  view_handler;
+    p.tokenizer.for_each_token(test, strlen(test), [&p,&view_handler](TokenView const &token) {
+        p.visit_token(token, view_handler);
+    });
+    BOOST_CHECK_EQUAL_COLLECTIONS(view_handler.tokens.begin(), view_handler.tokens.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(grammar_parallel_1)
+{
+    using TestGrammar = Grammar<
+        TokenRule<Token::suppress, 0>,
+        TokenRule<1, 0>,
+        TokenRule<2, 2>
+    >;
+    static constexpr TestGrammar::RuleTuple rules {
+        "--.*$",
+        "foo\\s+bar",
+        "([0-9]+)\\s*-\\s*([a-z]*)"
+    };
+    TestGrammar         p(rules);
+    std::string         test;
+
+    // Tokens span several lines, so that they cross the boundaries of the chunks.
+    srandom(1);
+    char const *pieces[] = {"foo", "bar", "\n", " ", "-", "--", "12", "a", "foo\n\nbar", "3\n-\nx"};
+    for (int i = 0; i < 5000; i++) {
+        test += pieces[random() % 10];
+    }
+
+    std::vector<Token> expected;
+    p.for_each_token(test.data(), test.size(), [&expected](auto code, auto... groups) {
+        expected.push_back(Token(decltype(code)::value, groups.to_string().data()..., NULL));
+    });
+
+    for (size_t nr_chunks = 1; nr_chunks < 64; nr_chunks = nr_chunks * 2 + 1) {
+        std::vector<Token> result;
+        p.parallel_for_each_token(test.data(), test.size(), nr_chunks, [&result](auto code, auto... groups) {
+            result.push_back(Token(decltype(code)::value, groups.to_string().data()..., NULL));
+        });
+        BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(grammar_parallel_2)
+{
+    using TestGrammar = Grammar<
+        TokenRule<1, 0>
+    >;
+    static constexpr TestGrammar::RuleTuple rules {
+        "foo"
+    };
+    TestGrammar         p(rules);
+    std::string         test;
+
+    for (int i = 0; i < 20000; i++) {
+        test += "foo\n";
+    }
+
+    // The chunks that are still being tokenized are waited for before the exception is passed on.
+    for (size_t nr_chunks = 2; nr_chunks < 64; nr_chunks = nr_chunks * 2 + 1) {
+        size_t nr_tokens = 0;
+        BOOST_CHECK_THROW(p.parallel_for_each_token(test.data(), test.size(), nr_chunks, [&nr_tokens](TokenCode<1>) {
+            if (++nr_tokens == 10) {
+                throw std::logic_error("handler");
+            }
+        }), std::logic_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(backend_posix_translate_1)
+{
+    std::vector<int> groups;
+
+    BOOST_CHECK_EQUAL(POSIXTokenizerBackend::translate("a(?:b|c)(\\w+)\\(x\\)[(]*?", groups), "a(b|c)([_[:alnum:]]+)\\(x\\)[(]*");
+    BOOST_REQUIRE_EQUAL(groups.size(), 1);
+    BOOST_CHECK_EQUAL(groups[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE(backend_agreement_1)
+{
+    using TestGrammar = Grammar<
+        TokenRule<Token::suppress, 0>,
+        TokenRule<1, 0>,
+        TokenRule<2, 2>
+    >;
+    static constexpr TestGrammar::RuleTuple rules {
+        "--.*?$",
+        "foo\\s+bar",
+        "([0-9]+)\\s*-\\s*(?:x|y)?([a-z]*)"
+    };
+    TestGrammar         p(rules);
+    std::string         test;
+
+    srandom(1);
+    char const *pieces[] = {"foo", "bar", "\n", " ", "-", "--", "12", "a", "foo\n\nbar", "3\n-\nx"};
+    for (int i = 0; i < 5000; i++) {
+        test += pieces[random() % 10];
+    }
+
+    GrammarTokenizerBackend<TestGrammar>    dfa_backend(p, 1024);
+    POSIXTokenizerBackend                   posix_backend(p.tokenizer);
+    std::vector<Token>                      expected;
+    std::vector<Token>                      result;
+    std::vector<size_t>                     expected_offsets;
+    std::vector<size_t>                     result_offsets;
+
+    dfa_backend.for_each_token(test.data(), test.size(), [&](TokenView const &token) {
+        expected.push_back(Token(token));
+        expected_offsets.push_back(token.offset);
+    });
+    posix_backend.for_each_token(test.data(), test.size(), [&](TokenView const &token) {
+        result.push_back(Token(token));
+        result_offsets.push_back(token.offset);
+    });
+    BOOST_CHECK(!expected.empty());
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(result_offsets.begin(), result_offsets.end(), expected_offsets.begin(), expected_offsets.end());
+}
+
+BOOST_AUTO_TEST_CASE(tokenizer_cache_1)
+{
+    using TestGrammar = Grammar<
+        TokenRule<Token::suppress, 0>,
+        TokenRule<2, 2>
+    >;
+    static constexpr TestGrammar::RuleTuple rules {
+        "--.*$",
+        "([0-9]+)\\s*-\\s*([a-z]*)"
+    };
+    fs::path            cache_directory = string_format("/tmp/Tokenizer-tests-cache-%i", (int)getpid());
+    const char          *test = "12-ab -- 1-a\n3- x";
+
+    // The first grammar compiles the patterns and writes the cache, the second one loads it.
+    TestGrammar         compiled(rules, cache_directory);
+    BOOST_REQUIRE_EQUAL(std::distance(fs::directory_iterator(cache_directory), fs::directory_iterator()), 1);
+    auto                filename = fs::directory_iterator(cache_directory)->path();
+    TestGrammar         loaded(rules, cache_directory);
+
+    auto expected = compiled.tokenizer.tokenize(test, strlen(test));
+    auto result = loaded.tokenizer.tokenize(test, strlen(test));
+    BOOST_CHECK_EQUAL(expected.size(), 2);
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(loaded.tokenizer.dfa.size(), compiled.tokenizer.dfa.size());
+
+    // A damaged cache file is ignored.
+    write_to_file(filename, "HRCTOKEN garbage");
+    Tokenizer damaged;
+    BOOST_CHECK(!TokenizerCache::load(filename, TokenizerCache::key({{0, "--.*$"}, {2, "([0-9]+)\\s*-\\s*([a-z]*)"}}), damaged));
+    TestGrammar         recompiled(rules, cache_directory);
+    result = recompiled.tokenizer.tokenize(test, strlen(test));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+
+    fs::remove_all(cache_directory);
+}
@@ -0,0 +1,704 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include "VHDLLexer.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** Classes of bytes, which select how a lexical element is scanned.
+ */
+const uint8_t VHDLLexer_other       = 0;
+const uint8_t VHDLLexer_letter      = 1;
+const uint8_t VHDLLexer_digit       = 2;
+const uint8_t VHDLLexer_space       = 3;
+const uint8_t VHDLLexer_dash        = 4;
+const uint8_t VHDLLexer_slash       = 5;
+const uint8_t VHDLLexer_quote       = 6;
+const uint8_t VHDLLexer_tick        = 7;
+const uint8_t VHDLLexer_backslash   = 8;
+const uint8_t VHDLLexer_colon       = 9;
+const uint8_t VHDLLexer_underscore  = 10;
+
+/** States of the statement recognizer.
+ */
+const int VHDLLexer_idle                    = 0;
+const int VHDLLexer_library                 = 1;
+const int VHDLLexer_library_name            = 2;
+const int VHDLLexer_use                     = 3;
+const int VHDLLexer_use_name                = 4;
+const int VHDLLexer_use_dot                 = 5;
+const int VHDLLexer_package                 = 6;
+const int VHDLLexer_package_name            = 7;
+const int VHDLLexer_entity                  = 8;
+const int VHDLLexer_entity_name             = 9;
+const int VHDLLexer_architecture            = 10;
+const int VHDLLexer_architecture_name       = 11;
+const int VHDLLexer_architecture_of         = 12;
+const int VHDLLexer_architecture_entity     = 13;
+const int VHDLLexer_label                   = 14;
+const int VHDLLexer_instance                = 15;
+const int VHDLLexer_instance_unit        = 16;
+const int VHDLLexer_instance_name           = 17;
+const int VHDLLexer_instance_dot            = 18;
+const int VHDLLexer_instance_architecture   = 19;
+const int VHDLLexer_instance_close          = 20;
+const int VHDLLexer_instance_after_close    = 21;
+const int VHDLLexer_instance_port           = 22;
+const int VHDLLexer_instance_map            = 23;
+
+/** The reserved words used by the statements that are recognized.
+ * The index in this table is the keyword of a lexical element.
+ */
+static char const * const VHDLLexer_keywords[] = {
+    "", "library", "use", "package", "body", "entity", "architecture", "of", "is",
+    "component", "generic", "port", "map"
+};
+const int VHDLLexer_nr_keywords = sizeof (VHDLLexer_keywords) / sizeof (VHDLLexer_keywords[0]);
+const int VHDLLexer_library_keyword       = 1;
+const int VHDLLexer_use_keyword           = 2;
+const int VHDLLexer_package_keyword       = 3;
+const int VHDLLexer_body_keyword          = 4;
+const int VHDLLexer_entity_keyword        = 5;
+const int VHDLLexer_architecture_keyword  = 6;
+const int VHDLLexer_of_keyword            = 7;
+const int VHDLLexer_is_keyword            = 8;
+const int VHDLLexer_component_keyword     = 9;
+const int VHDLLexer_generic_keyword       = 10;
+const int VHDLLexer_port_keyword          = 11;
+const int VHDLLexer_map_keyword           = 12;
+
+struct VHDLLexerClasses {
+    uint8_t     classes[256];
+
+    VHDLLexerClasses() {
+        for (int c = 0; c < 256; c++) {
+            if (isalpha(c) || (c >= 0xc0 && c != 0xd7 && c != 0xf7)) {
+                classes[c] = VHDLLexer_letter;
+            } else if (isdigit(c)) {
+                classes[c] = VHDLLexer_digit;
+            } else if (isspace(c) || c == 0xa0) {
+                classes[c] = VHDLLexer_space;
+            } else {
+                classes[c] = VHDLLexer_other;
+            }
+        }
+        classes['-'] = VHDLLexer_dash;
+        classes['/'] = VHDLLexer_slash;
+        classes['"'] = VHDLLexer_quote;
+        classes['\''] = VHDLLexer_tick;
+        classes['\\'] = VHDLLexer_backslash;
+        classes[':'] = VHDLLexer_colon;
+        classes['_'] = VHDLLexer_underscore;
+    }
+};
+
+static const VHDLLexerClasses VHDLLexer_table;
+
+/** The reserved words of VHDL-2008, sorted.
+ * A tick after a reserved word starts a character literal instead of an attribute.
+ */
+static char const * const VHDLLexer_reserved_words[] = {
+    "abs", "access", "after", "alias", "all", "and", "architecture", "array", "assert", "assume",
+    "assume_guarantee", "attribute", "begin", "block", "body", "buffer", "bus", "case", "component",
+    "configuration", "constant", "context", "cover", "default", "disconnect", "downto", "else",
+    "elsif", "end", "entity", "exit", "fairness", "file", "for", "force", "function", "generate",
+    "generic", "group", "guarded", "if", "impure", "in", "inertial", "inout", "is", "label",
+    "library", "linkage", "literal", "loop", "map", "mod", "nand", "new", "next", "nor", "not",
+    "null", "of", "on", "open", "or", "others", "out", "package", "parameter", "port", "postponed",
+    "procedure", "process", "property", "protected", "pure", "range", "record", "register",
+    "reject", "release", "rem", "report", "restrict", "restrict_guarantee", "return", "rol", "ror",
+    "select", "sequence", "severity", "shared", "signal", "sla", "sll", "sra", "srl", "strong",
+    "subtype", "then", "to", "transport", "type", "unaffected", "units", "until", "use", "variable",
+    "vmode", "vprop", "vunit", "wait", "when", "while", "with", "xnor", "xor"
+};
+
+static inline bool VHDLLexer_is_word(uint8_t c)
+{
+    auto cls = VHDLLexer_table.classes[c];
+    return cls == VHDLLexer_letter || cls == VHDLLexer_digit || cls == VHDLLexer_underscore;
+}
+
+static inline bool VHDLLexer_is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/** Find which of VHDLLexer_keywords an identifier is, ignoring case.
+ * @return The index in VHDLLexer_keywords, or 0 when not a keyword.
+ */
+static int VHDLLexer_keyword(char const * const text, size_t begin, size_t end)
+{
+    auto size = end - begin;
+
+    for (int keyword = 1; keyword < VHDLLexer_nr_keywords; keyword++) {
+        auto word = VHDLLexer_keywords[keyword];
+        if (word[0] != (text[begin] | 0x20) || strlen(word) != size) {
+            continue;
+        }
+
+        size_t i = 1;
+        while (i < size && word[i] == tolower((uint8_t)text[begin + i])) {
+            i++;
+        }
+        if (i == size) {
+            return keyword;
+        }
+    }
+    return 0;
+}
+
+static bool VHDLLexer_is_reserved(char const * const text, VHDLLexeme const &lexeme)
+{
+    char word[20];
+    auto size = lexeme.end - lexeme.begin;
+
+    if (lexeme.kind != VHDLLexeme::identifier || size >= sizeof (word)) {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++) {
+        word[i] = tolower((uint8_t)text[lexeme.begin + i]);
+    }
+    word[size] = '\0';
+
+    auto end = VHDLLexer_reserved_words + sizeof (VHDLLexer_reserved_words) / sizeof (VHDLLexer_reserved_words[0]);
+    return std::binary_search(VHDLLexer_reserved_words, end, word, [](char const *a, char const *b) {
+        return strcmp(a, b) < 0;
+    });
+}
+
+/** Read a word of letters, digits and underscores from a comment.
+ */
+static boost::string_ref VHDLLexer_word(char const * const text, size_t &i, size_t end, bool with_dots)
+{
+    auto begin = i;
+    while (i < end && (VHDLLexer_is_word(text[i]) || (with_dots && text[i] == '.'))) {
+        i++;
+    }
+    return boost::string_ref(&text[begin], i - begin);
+}
+
+/** Skip at least one blank in a comment.
+ */
+static bool VHDLLexer_blanks(char const * const text, size_t &i, size_t end)
+{
+    auto begin = i;
+    while (i < end && VHDLLexer_is_blank(text[i])) {
+        i++;
+    }
+    return i > begin;
+}
+
+/** Look for a pragma in the text of a comment after the '--'.
+ */
+static bool VHDLLexer_pragma(char const * const text, size_t begin, size_t end, TokenView &token)
+{
+    auto i = begin;
+
+    if (!VHDLLexer_blanks(text, i, end)) {
+        return false;
+    }
+
+    // Most comments are not pragmas.
+    if (i == end || !(text[i] == 'p' || text[i] == 's' || text[i] == 'e' || text[i] == 'r')) {
+        return false;
+    }
+
+    auto word = VHDLLexer_word(text, i, end, false);
+    if (word == "rtl_synthesis") {
+        if (!VHDLLexer_blanks(text, i, end)) {
+            return false;
+        }
+        auto value = VHDLLexer_word(text, i, end, false);
+        if (value == "off" || value == "on") {
+            token.code = VHDLSourceFile::translate_pragma;
+            token.nr_groups = 1;
+            token.groups[0] = value;
+            return true;
+        }
+        return false;
+    }
+
+    if (!(word == "pragma" || word == "synthesis" || word == "synopsys" || word == "exemplar")) {
+        return false;
+    }
+    if (!VHDLLexer_blanks(text, i, end)) {
+        return false;
+    }
+
+    auto directive = VHDLLexer_word(text, i, end, false);
+    if (directive == "library") {
+        if (!VHDLLexer_blanks(text, i, end)) {
+            return false;
+        }
+        auto name = VHDLLexer_word(text, i, end, true);
+        if (name.empty()) {
+            return false;
+        }
+        token.code = VHDLSourceFile::library_pragma;
+        token.nr_groups = 1;
+        token.groups[0] = name;
+        return true;
+    }
+
+    for (auto prefix: {"translate_", "synthesis_"}) {
+        if (directive.starts_with(prefix)) {
+            auto value = directive.substr(strlen(prefix));
+            if (value == "off" || value == "on") {
+                token.code = VHDLSourceFile::translate_pragma;
+                token.nr_groups = 1;
+                token.groups[0] = value;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void VHDLLexer::scan(char const * const text, size_t text_size, Cursor &cursor, VHDLLexeme &lexeme, TokenView &token)
+{
+    auto i = cursor.offset;
+
+    while (true) {
+        // Skip whitespace.
+        while (i < text_size && VHDLLexer_table.classes[(uint8_t)text[i]] == VHDLLexer_space) {
+            i++;
+        }
+
+        lexeme.begin = i;
+        lexeme.character = 0;
+        lexeme.keyword = 0;
+        if (i >= text_size) {
+            lexeme.kind = VHDLLexeme::end_of_text;
+            lexeme.end = i;
+            cursor.offset = i;
+            return;
+        }
+
+        auto c = text[i];
+        switch (VHDLLexer_table.classes[(uint8_t)c]) {
+        case VHDLLexer_letter:
+            // Basic identifier or reserved word; a following string makes it a bit string literal.
+            i++;
+            while (i < text_size && VHDLLexer_is_word(text[i])) {
+                i++;
+            }
+            lexeme.kind = VHDLLexeme::identifier;
+            lexeme.keyword = VHDLLexer_keyword(text, lexeme.begin, i);
+            break;
+
+        case VHDLLexer_digit:
+            // Decimal or based literal, including exponents and the '#' of a base.
+            i++;
+            while (i < text_size && (VHDLLexer_is_word(text[i]) || text[i] == '#' || text[i] == '.')) {
+                i++;
+            }
+            lexeme.kind = VHDLLexeme::literal;
+            break;
+
+        case VHDLLexer_backslash:
+            // Extended identifier, a backslash inside is written twice.
+            i++;
+            while (i < text_size && text[i] != '\n') {
+                if (text[i] == '\\') {
+                    if (i + 1 < text_size && text[i + 1] == '\\') {
+                        i+= 2;
+                        continue;
+                    }
+                    i++;
+                    break;
+                }
+                i++;
+            }
+            lexeme.kind = VHDLLexeme::identifier;
+            break;
+
+        case VHDLLexer_quote:
+            // String literal, a quote inside is written twice.
+            i++;
+            while (i < text_size && text[i] != '\n') {
+                if (text[i] == '"') {
+                    if (i + 1 < text_size && text[i + 1] == '"') {
+                        i+= 2;
+                        continue;
+                    }
+                    i++;
+                    break;
+                }
+                i++;
+            }
+            lexeme.kind = VHDLLexeme::literal;
+            break;
+
+        case VHDLLexer_tick: {
+            // After a name or closing parenthesis a tick starts an attribute, otherwise a character literal.
+            auto &previous = cursor.previous;
+            bool after_name =
+                (previous.kind == VHDLLexeme::identifier && !VHDLLexer_is_reserved(text, previous)) ||
+                (previous.kind == VHDLLexeme::delimiter && (previous.character == ')' || previous.character == ']'));
+
+            if (!after_name && i + 2 < text_size && text[i + 2] == '\'') {
+                i+= 3;
+                lexeme.kind = VHDLLexeme::literal;
+            } else {
+                i++;
+                lexeme.kind = VHDLLexeme::delimiter;
+                lexeme.character = c;
+            }
+            break;
+        }
+
+        case VHDLLexer_dash:
+            if (i + 1 < text_size && text[i + 1] == '-') {
+                // Comment until the end of the line, which may contain a pragma.
+                auto newline = (char const *)memchr(&text[i], '\n', text_size - i);
+                auto end = newline != NULL ? (size_t)(newline - text) : text_size;
+                auto found = VHDLLexer_pragma(text, i + 2, end, token);
+
+                i = end;
+                if (found) {
+                    token.offset = lexeme.begin;
+                    lexeme.kind = VHDLLexeme::pragma;
+                    lexeme.end = i;
+                    cursor.offset = i;
+                    return;
+                }
+                continue;
+            }
+            i++;
+            lexeme.kind = VHDLLexeme::delimiter;
+            lexeme.character = c;
+            break;
+
+        case VHDLLexer_slash:
+            if (i + 1 < text_size && text[i + 1] == '*') {
+                // Block comment.
+                i+= 2;
+                while (i + 1 < text_size && !(text[i] == '*' && text[i + 1] == '/')) {
+                    i++;
+                }
+                i = std::min(i + 2, text_size);
+                continue;
+            }
+            i++;
+            lexeme.kind = VHDLLexeme::delimiter;
+            lexeme.character = c;
+            break;
+
+        case VHDLLexer_colon:
+            // The variable assignment ':=' is not a label.
+            i++;
+            lexeme.kind = VHDLLexeme::delimiter;
+            lexeme.character = c;
+            if (i < text_size && text[i] == '=') {
+                i++;
+                lexeme.character = '=';
+            }
+            break;
+
+        default:
+            i++;
+            lexeme.kind = VHDLLexeme::delimiter;
+            lexeme.character = c;
+        }
+
+        lexeme.end = i;
+        cursor.offset = i;
+        cursor.previous = lexeme;
+        return;
+    }
+}
+
+bool VHDLLexer::next(char const * const text, size_t text_size, Cursor &cursor, TokenView &token)
+{
+    VHDLLexeme  lexeme;
+
+    while (true) {
+        scan(text, text_size, cursor, lexeme, token);
+
+        if (lexeme.kind == VHDLLexeme::pragma) {
+            return true;
+        } else if (lexeme.kind == VHDLLexeme::end_of_text) {
+            return false;
+        }
+
+        auto name = boost::string_ref(&text[lexeme.begin], lexeme.end - lexeme.begin);
+        auto is_name = lexeme.kind == VHDLLexeme::identifier;
+        auto is = [&](int keyword) {
+            return lexeme.keyword == keyword;
+        };
+        auto is_delimiter = [&](char delimiter) {
+            return lexeme.kind == VHDLLexeme::delimiter && lexeme.character == delimiter;
+        };
+        auto emit = [&](int code, int nr_groups, int next_state) {
+            token.code = code;
+            token.nr_groups = nr_groups;
+            token.offset = cursor.start;
+            for (int i = 0; i < nr_groups; i++) {
+                token.groups[i] = cursor.names[i];
+            }
+            cursor.state = next_state;
+            return true;
+        };
+
+        // A lexical element that does not fit the statement is tried again as the start of a new statement.
+        for (bool retry = true; retry; ) {
+            retry = false;
+
+            switch (cursor.state) {
+            case VHDLLexer_idle:
+                cursor.start = lexeme.begin;
+                if (is(VHDLLexer_library_keyword)) {
+                    cursor.state = VHDLLexer_library;
+                } else if (is(VHDLLexer_use_keyword)) {
+                    cursor.state = VHDLLexer_use;
+                } else if (is(VHDLLexer_package_keyword)) {
+                    cursor.state = VHDLLexer_package;
+                } else if (is(VHDLLexer_entity_keyword)) {
+                    cursor.state = VHDLLexer_entity;
+                } else if (is(VHDLLexer_architecture_keyword)) {
+                    cursor.state = VHDLLexer_architecture;
+                } else if (is_name) {
+                    cursor.state = VHDLLexer_label;
+                }
+                continue;
+
+            case VHDLLexer_library:
+                if (is_name) {
+                    cursor.names[0] = name;
+                    cursor.state = VHDLLexer_library_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_library_name:
+                if (is_delimiter(',')) {
+                    return emit(VHDLSourceFile::library_statement, 1, VHDLLexer_library);
+                } else if (is_delimiter(';')) {
+                    return emit(VHDLSourceFile::library_statement, 1, VHDLLexer_idle);
+                }
+                break;
+
+            case VHDLLexer_use:
+                if (is_name) {
+                    cursor.names[0] = name;
+                    cursor.state = VHDLLexer_use_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_use_name:
+                if (is_delimiter('.')) {
+                    cursor.state = VHDLLexer_use_dot;
+                    continue;
+                } else if (is_delimiter(',')) {
+                    return emit(VHDLSourceFile::use_statement, 1, VHDLLexer_use);
+                } else if (is_delimiter(';')) {
+                    return emit(VHDLSourceFile::use_statement, 1, VHDLLexer_idle);
+                }
+                break;
+
+            case VHDLLexer_use_dot:
+                if (is_name) {
+                    // The selected name runs from the library up to and including this suffix.
+                    auto begin = cursor.names[0].data();
+                    cursor.names[0] = boost::string_ref(begin, &text[lexeme.end] - begin);
+                    cursor.state = VHDLLexer_use_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_package:
+                if (is_name && !is(VHDLLexer_body_keyword)) {
+                    cursor.names[0] = name;
+                    cursor.state = VHDLLexer_package_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_package_name:
+                if (is(VHDLLexer_is_keyword)) {
+                    return emit(VHDLSourceFile::package_declaration, 1, VHDLLexer_idle);
+                }
+                break;
+
+            case VHDLLexer_entity:
+                if (is_name) {
+                    cursor.names[0] = name;
+                    cursor.state = VHDLLexer_entity_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_entity_name:
+                if (is(VHDLLexer_is_keyword)) {
+                    return emit(VHDLSourceFile::entity_declaration, 1, VHDLLexer_idle);
+                }
+                break;
+
+            case VHDLLexer_architecture:
+                if (is_name) {
+                    cursor.names[0] = name;
+                    cursor.state = VHDLLexer_architecture_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_architecture_name:
+                if (is(VHDLLexer_of_keyword)) {
+                    cursor.state = VHDLLexer_architecture_of;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_architecture_of:
+                if (is_name) {
+                    cursor.names[1] = name;
+                    cursor.state = VHDLLexer_architecture_entity;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_architecture_entity:
+                if (is(VHDLLexer_is_keyword)) {
+                    return emit(VHDLSourceFile::architecture_declaration, 2, VHDLLexer_idle);
+                }
+                break;
+
+            case VHDLLexer_label:
+                if (is_delimiter(':')) {
+                    cursor.names[0] = boost::string_ref();
+                    cursor.names[1] = boost::string_ref();
+                    cursor.names[2] = boost::string_ref();
+                    cursor.state = VHDLLexer_instance;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance:
+                if (is(VHDLLexer_entity_keyword) || is(VHDLLexer_component_keyword)) {
+                    cursor.state = VHDLLexer_instance_unit;
+                    continue;
+                }
+                // Fall through.
+            case VHDLLexer_instance_unit:
+                if (is_name) {
+                    cursor.names[1] = name;
+                    cursor.state = VHDLLexer_instance_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_name:
+                if (is_delimiter('.') && cursor.names[0].empty()) {
+                    cursor.names[0] = cursor.names[1];
+                    cursor.state = VHDLLexer_instance_dot;
+                    continue;
+                } else if (is_delimiter('(')) {
+                    cursor.state = VHDLLexer_instance_architecture;
+                    continue;
+                } else if (is(VHDLLexer_generic_keyword) || is(VHDLLexer_port_keyword)) {
+                    cursor.state = VHDLLexer_instance_port;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_dot:
+                if (is_name) {
+                    cursor.names[1] = name;
+                    cursor.state = VHDLLexer_instance_name;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_architecture:
+                if (is_name) {
+                    cursor.names[2] = name;
+                    cursor.state = VHDLLexer_instance_close;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_close:
+                if (is_delimiter(')')) {
+                    cursor.state = VHDLLexer_instance_after_close;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_after_close:
+                if (is(VHDLLexer_generic_keyword) || is(VHDLLexer_port_keyword)) {
+                    cursor.state = VHDLLexer_instance_port;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_port:
+                if (is(VHDLLexer_map_keyword)) {
+                    cursor.state = VHDLLexer_instance_map;
+                    continue;
+                }
+                break;
+
+            case VHDLLexer_instance_map:
+                if (is_delimiter('(')) {
+                    return emit(VHDLSourceFile::entity_instantiation, 3, VHDLLexer_idle);
+                }
+                break;
+            }
+
+            // The statement was not recognized.
+            cursor.state = VHDLLexer_idle;
+            retry = true;
+        }
+    }
+}
+
+std::vector<Token> VHDLLexer::tokenize(char const * const text, size_t text_size)
+{
+    std::vector<Token>  tokens;
+    Cursor              cursor;
+    TokenView           token;
+
+    while (next(text, text_size, cursor, token)) {
+        tokens.push_back(Token(token));
+    }
+    return tokens;
+}
+
+void VHDLLexerBackend::for_each_token(char const * const text, size_t text_size, std::function<void(TokenView const &)> const &visitor) const
+{
+    VHDLLexer::Cursor   cursor;
+    TokenView           token;
+
+    while (VHDLLexer::next(text, text_size, cursor, token)) {
+        visitor(token);
+    }
+}
+
+}}
@@ -0,0 +1,166 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_VHDLLEXER_H
+#define TAKEVOS_HURRICANE_VHDLLEXER_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <boost/utility/string_ref.hpp>
+#include "Tokenizer.h"
+#include "Grammar.h"
+#include "TokenizerBackend.h"
+#include "VHDLSourceFile.h"
+
+namespace takevos {
+namespace hurricane {
+
+/** A lexical element of VHDL.
+ */
+struct VHDLLexeme {
+    static const int end_of_text    = 0;
+    static const int identifier     = 1;    ///< A basic or extended identifier, or a reserved word.
+    static const int delimiter      = 2;    ///< A delimiter, compound delimiters are reported by their last character.
+    static const int literal        = 3;    ///< A string, character, bit string or abstract literal.
+    static const int pragma         = 4;    ///< A comment with a pragma, which was returned as a token.
+
+    int         kind;       ///< The kind of lexical element.
+    char        character;  ///< The character of a delimiter.
+    int         keyword;    ///< The reserved word used by the statements that are recognized, 0 for other identifiers.
+    size_t      begin;      ///< Offset of the first byte.
+    size_t      end;        ///< Offset one beyond the last byte.
+};
+
+/** A hand-written scanner for VHDL, as an alternative to the patterns of VHDLSourceFile::vhdl_grammar().
+ *
+ * The text is split into lexical elements using a table of byte classes,
+ * so that comments, string literals, character literals, extended
+ * identifiers and VHDL-2008 block comments are skipped as a whole; a
+ * keyword inside a string or comment does not produce a token. The
+ * lexical elements drive a state machine which recognizes the same
+ * statements as the patterns and produces the same token codes.
+ *
+ * Unlike the patterns, reserved words are case insensitive, a library
+ * or use clause may name several libraries or packages, and
+ * instantiations with the 'component' keyword are recognized.
+ */
+class VHDLLexer {
+public:
+    /** Position and state of the scan through a text.
+     */
+    struct Cursor {
+        size_t              offset;     ///< Offset of the next lexical element.
+        int                 state;      ///< The state of the statement being recognized.
+        size_t              start;      ///< Offset of the first lexical element of the statement being recognized.
+        VHDLLexeme          previous;   ///< The previous lexical element, to tell character literals from attributes.
+        boost::string_ref   names[3];   ///< Names found in the statement being recognized.
+
+        Cursor() : offset(0), state(0), start(0) {
+            previous.kind = VHDLLexeme::end_of_text;
+            previous.character = 0;
+            previous.keyword = 0;
+            previous.begin = 0;
+            previous.end = 0;
+        }
+    };
+
+    /** Find the next lexical element.
+     * Whitespace and comments are skipped, except comments with a pragma.
+     *
+     * @param text          The text to scan.
+     * @param text_size     The size of the text.
+     * @param cursor        The position in the text, which is advanced beyond the lexical element.
+     * @param lexeme        Returns the lexical element.
+     * @param token         Returns the token when the lexical element is a pragma.
+     */
+    static void scan(char const * const text, size_t text_size, Cursor &cursor, VHDLLexeme &lexeme, TokenView &token);
+
+    /** Find the next token.
+     * @param text          The text to scan.
+     * @param text_size     The size of the text.
+     * @param cursor        The position and state of the scan, which is updated.
+     * @param token         Returns the token, the captured sub expressions point into the text.
+     * @return true when a token was found.
+     */
+    static bool next(char const * const text, size_t text_size, Cursor &cursor, TokenView &token);
+
+    /** Find all tokens in the text, passing each token to a handler as soon as it is found.
+     * The handler is called in the same way as by Grammar::for_each_token().
+     *
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @param handler       Called as handler(TokenCode<code>(), boost::string_ref group...) for each token.
+     */
+    template <typename F>
+    static void for_each_token(char const * const text, size_t text_size, F &&handler) {
+        Cursor      cursor;
+        TokenView   token;
+
+        while (next(text, text_size, cursor, token)) {
+            switch (token.code) {
+            case VHDLSourceFile::library_pragma:
+                handler(TokenCode<VHDLSourceFile::library_pragma>(), token.groups[0]);
+                break;
+            case VHDLSourceFile::translate_pragma:
+                handler(TokenCode<VHDLSourceFile::translate_pragma>(), token.groups[0]);
+                break;
+            case VHDLSourceFile::library_statement:
+                handler(TokenCode<VHDLSourceFile::library_statement>(), token.groups[0]);
+                break;
+            case VHDLSourceFile::use_statement:
+                handler(TokenCode<VHDLSourceFile::use_statement>(), token.groups[0]);
+                break;
+            case VHDLSourceFile::entity_instantiation:
+                handler(TokenCode<VHDLSourceFile::entity_instantiation>(), token.groups[0], token.groups[1], token.groups[2]);
+                break;
+            case VHDLSourceFile::package_declaration:
+                handler(TokenCode<VHDLSourceFile::package_declaration>(), token.groups[0]);
+                break;
+            case VHDLSourceFile::entity_declaration:
+                handler(TokenCode<VHDLSourceFile::entity_declaration>(), token.groups[0]);
+                break;
+            case VHDLSourceFile::architecture_declaration:
+                handler(TokenCode<VHDLSourceFile::architecture_declaration>(), token.groups[0], token.groups[1]);
+                break;
+            }
+        }
+    }
+
+    /** Find all tokens in the text.
+     * @param text          The text to parse.
+     * @param text_size     The size of the text.
+     * @return The tokens found with the captured sub expressions.
+     */
+    static std::vector<Token> tokenize(char const * const text, size_t text_size);
+};
+
+/** A tokenizer backend using the VHDLLexer.
+ */
+class VHDLLexerBackend : public TokenizerBackend {
+public:
+    virtual char const *name(void) const { return "lexer"; }
+    virtual void for_each_token(char const * const text, size_t text_size, std::function<void(TokenView const &)> const &visitor) const;
+};
+
+}}
+#endif
@@ -0,0 +1,97 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define BOOST_TEST_MODULE VHDLLexer_tests
+#include <boost/test/unit_test.hpp>
+#include <boost/test/execution_monitor.hpp>
+#include "VHDLLexer.h"
+
+using namespace takevos::hurricane;
+
+BOOST_AUTO_TEST_CASE(lexer_same_as_grammar_1)
+{
+    const char *text =
+        "--\n"
+        "-- pragma library testlib\n"
+        "library foo;\n"
+        "use work.use1;\n"
+        "-- synthesis translate_off\n"
+        "package testpkg is\n"
+        "end package;\n"
+        "-- rtl_synthesis on\n"
+        "entity testentity is\n"
+        "   port (\n"
+        "   );\n"
+        "end;\n"
+        "architecture rtl of testentity is\n"
+        "begin\n"
+        "   i1: entity work.instance1 port map(clk => clk);\n"
+        "   i2 : entity instance2 port map(clk => clk);\n"
+        "   i3: entity work.instance3(rtl)\n"
+        "       generic map(N => 1);\n"
+        "   i4: instance4 port map(clk => clk);\n"
+        "end;\n";
+
+    auto result = VHDLLexer::tokenize(text, strlen(text));
+    auto expected = VHDLSourceFile::vhdl_grammar().tokenizer.tokenize(text, strlen(text));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(lexer_literals_1)
+{
+    const char          *text =
+        "x <= \"library foo; \"\" entity bar is \";\n"
+        "c <= '\"'; d <= s'length; -- entity baz is\n"
+        "/* entity block is\n"
+        "   comment */ e <= '-';\n"
+        "\\entity ext is\\ <= '1';\n"
+        "v := a; w: entity work.e1 port map (a);\n";
+    std::vector<Token>  expected;
+
+    auto result = VHDLLexer::tokenize(text, strlen(text));
+    expected.push_back(Token(VHDLSourceFile::entity_instantiation, "work", "e1", "", NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(lexer_clauses_1)
+{
+    const char          *text =
+        "LIBRARY ieee, work;\n"
+        "Use ieee.std_logic_1164.all, work.pkg;\n"
+        "package body p is end;\n"
+        "u1: component c1 port map (a);\n"
+        "-- pragma translate_offset\n"
+        "-- synopsys synthesis_off\n";
+    std::vector<Token>  expected;
+
+    auto result = VHDLLexer::tokenize(text, strlen(text));
+    expected.push_back(Token(VHDLSourceFile::library_statement, "ieee", NULL));
+    expected.push_back(Token(VHDLSourceFile::library_statement, "work", NULL));
+    expected.push_back(Token(VHDLSourceFile::use_statement, "ieee.std_logic_1164.all", NULL));
+    expected.push_back(Token(VHDLSourceFile::use_statement, "work.pkg", NULL));
+    expected.push_back(Token(VHDLSourceFile::entity_instantiation, "", "c1", "", NULL));
+    expected.push_back(Token(VHDLSourceFile::translate_pragma, "off", NULL));
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+}
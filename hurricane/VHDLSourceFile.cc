@@ -23,41 +23,141 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
+#include <chrono>
 #include "VHDLSourceFile.h"
+#include "VHDLLexer.h"
 #include "Tokenizer.h"
+#include "TokenizerCache.h"
+#include "TokenStream.h"
 #include "Options.h"
+#include "FileHandle.h"
+#include "md5.h"
 #include "utils.h"
 
 namespace takevos {
 namespace hurricane {
 
-const Tokenizer VHDLSourceFile::vhdl_tokenizer(
-    library_pragma,             R"__(--\s+(?:pragma|synthesis|synopsys|exemplar)\s+library\s+([_.[:alnum:]]+))__",
-    translate_pragma,           R"__(--\s+(?:pragma|synthesis|synopsys|exemplar)\s+translate_(off|on))__",
-    translate_pragma,           R"__(--\s+(?:pragma|synthesis|synopsys|exemplar)\s+synthesis_(off|on))__",
-    translate_pragma,           R"__(--\s+rtl_synthesis\s+(off|on))__",
-    Token::suppress,            R"__(--.*?$)__",
-    library_statement,          R"__(library\s+([_[:alnum:]]+)\s*;)__",
-    use_statement,              R"__(use\s+([_.[:alnum:]]+)\s*;)__",
-    entity_instantiation,       R"__(\w+\s*:\s*(?:entity\s+)?(?:([_[:alnum:]]+)\.)?([_[:alnum:]]+)(?:\(([_[:alnum:]]+)\))?\s+(?:generic|port)\s+map\s*\()__",
-    package_declaration,        R"__(package\s+(\w+)\s+is\s+)__",
-    entity_declaration,         R"__(entity\s+(\w+)\s+is\s+)__",
-    architecture_declaration,   R"__(architecture\s+(\w+)\s+of\s+(\w+)\s+is\s+)__",
-    Token::sentinal
-);
+/** The smallest part of a file that is tokenized by a separate thread.
+ */
+const size_t VHDLSourceFile_min_chunk_size = 16 * 1024 * 1024;
+
+VHDLSourceFile::VHDLGrammar const &VHDLSourceFile::vhdl_grammar(void)
+{
+    // The number of sub-expressions of each pattern is checked by the compiler.
+    static constexpr VHDLGrammar::RuleTuple rules {
+        R"__(--\s+(?:pragma|synthesis|synopsys|exemplar)\s+library\s+([_.[:alnum:]]+))__",
+        R"__(--\s+(?:pragma|synthesis|synopsys|exemplar)\s+translate_(off|on))__",
+        R"__(--\s+(?:pragma|synthesis|synopsys|exemplar)\s+synthesis_(off|on))__",
+        R"__(--\s+rtl_synthesis\s+(off|on))__",
+        R"__(--.*?$)__",
+        R"__(library\s+([_[:alnum:]]+)\s*;)__",
+        R"__(use\s+([_.[:alnum:]]+)\s*;)__",
+        R"__(\w+\s*:\s*(?:entity\s+)?(?:([_[:alnum:]]+)\.)?([_[:alnum:]]+)(?:\(([_[:alnum:]]+)\))?\s+(?:generic|port)\s+map\s*\()__",
+        R"__(package\s+(\w+)\s+is\s+)__",
+        R"__(entity\s+(\w+)\s+is\s+)__",
+        R"__(architecture\s+(\w+)\s+of\s+(\w+)\s+is\s+)__"
+    };
+    static const VHDLGrammar grammar(rules, options.cache_directory);
+
+    return grammar;
+}
+
+TokenizerBackend const &VHDLSourceFile::vhdl_backend(int tokenizer)
+{
+    static const GrammarTokenizerBackend<VHDLGrammar>   dfa_backend(vhdl_grammar(), VHDLSourceFile_min_chunk_size);
+    static const VHDLLexerBackend                       lexer_backend;
+
+    switch (tokenizer) {
+    case Options::posix_tokenizer: {
+            // regcomp() is slow for these patterns, so it is only done when asked for.
+            static const POSIXTokenizerBackend posix_backend(vhdl_grammar().tokenizer);
+            return posix_backend;
+        }
+    case Options::lexer_tokenizer:
+        return lexer_backend;
+    default:
+        return dfa_backend;
+    }
+}
+
+void VHDLSourceFile::benchmark_tokenizers(std::vector<fs::path> const &filenames)
+{
+    static const int tokenizers[] = {Options::dfa_tokenizer, Options::posix_tokenizer, Options::lexer_tokenizer};
+    static const int nr_tokenizers = sizeof (tokenizers) / sizeof (tokenizers[0]);
+
+    size_t  total_size = 0;
+    size_t  nr_tokens[nr_tokenizers] = {};
+    size_t  nr_agree[nr_tokenizers] = {};
+    double  seconds[nr_tokenizers] = {};
+
+    // The patterns are compiled on first use, which should not be measured.
+    for (auto tokenizer: tokenizers) {
+        vhdl_backend(tokenizer);
+    }
+
+    // Each file is read once and tokenized by each backend, so that all backends see a warm cache.
+    for (auto &filename: filenames) {
+        FileHandle                          handle(filename);
+        std::vector<std::vector<Token>>     results(nr_tokenizers);
+
+        handle.open();
+        total_size += handle.data_size;
+
+        for (int i = 0; i < nr_tokenizers; i++) {
+            auto &result = results[i];
+            auto start = std::chrono::steady_clock::now();
+
+            vhdl_backend(tokenizers[i]).for_each_token(handle.data, handle.data_size, [&result](TokenView const &token) {
+                result.push_back(Token(token));
+            });
+
+            seconds[i] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            nr_tokens[i] += result.size();
+            if (result == results[0]) {
+                nr_agree[i]++;
+            } else {
+                options.log(LOG_INFO "Tokenizer %s differs from %s on '%s'.", vhdl_backend(tokenizers[i]).name(), vhdl_backend(tokenizers[0]).name(), filename.string().c_str());
+            }
+        }
+
+        handle.close();
+    }
+
+    printf("%-8s %10s %12s %12s %10s %14s\n", "backend", "tokens", "seconds", "MB/s", "tokens/s", "files agree");
+    for (int i = 0; i < nr_tokenizers; i++) {
+        printf("%-8s %10zu %12.3f %12.1f %10.0f %7zu/%-6zu\n",
+            vhdl_backend(tokenizers[i]).name(), nr_tokens[i], seconds[i],
+            total_size / seconds[i] / 1e6, nr_tokens[i] / seconds[i],
+            nr_agree[i], filenames.size()
+        );
+    }
+}
 
 VHDLSourceFile::VHDLSourceFile(fs::path const &filename) :
-    SourceFile(filename), destination_library("work"), translating(true)
+    SourceFile(filename), destination_library("work"), translating(true), parse_text(NULL)
 {
     //imported_libraries.push_back("work");
 }
 
-void VHDLSourceFile::handle_library_pragma(std::string name)
+uint128_t VHDLSourceFile::record_key(void) const
+{
+    static const auto   grammar_key = TokenizerCache::key(vhdl_grammar().tokenizer);
+    MD5Hasher           hasher;
+
+    // The translate pragmas are only followed during synthesis; the backends may tokenize differently.
+    hasher.value(grammar_key);
+    hasher.value((int32_t)options.compilation_mode);
+    hasher.value((int32_t)options.tokenizer);
+    return hasher.final();
+}
+
+void VHDLSourceFile::handle(TokenCode<library_pragma>, boost::string_ref name)
 {
-    destination_library = name;
+    destination_library = name.to_string();
 }
 
-void VHDLSourceFile::handle_translate_pragma(std::string value)
+void VHDLSourceFile::handle(TokenCode<translate_pragma>, boost::string_ref value)
 {
     // The translate_on and translate_off pragmas only function during synthesis.
     if (options.compilation_mode == Options::synthesis) {
@@ -72,22 +172,22 @@ void VHDLSourceFile::handle_translate_pragma(std::string value)
     }
 }
 
-void VHDLSourceFile::handle_library_statement(std::string name)
+void VHDLSourceFile::handle(TokenCode<library_statement>, boost::string_ref name)
 {
     if (!translating) {
         return;
     }
 
-    imported_libraries.push_back(name);
+    imported_libraries.push_back(name.to_string());
 }
 
-void VHDLSourceFile::handle_use_statement(std::string path)
+void VHDLSourceFile::handle(TokenCode<use_statement>, boost::string_ref path)
 {
     if (!translating) {
         return;
     }
 
-    auto parts = split_string(path, ".");
+    auto parts = split_string(path.to_string(), ".");
 
     // The first part is a library if it was imported, otherwise it is a package/entity
     // in the work library.
@@ -104,19 +204,19 @@ void VHDLSourceFile::handle_use_statement(std::string path)
     auto name = parts[i++];
 
     // We don't care about the third part of the use statement.
-    add_need(DQ("lib", library) & (DQ("pkg", name) | DQ("ent", name)));
+    add_need(DQ("lib", library) & (DQ("pkg", name) | DQ("ent", name)), offset_of(path));
 }
 
 
-void VHDLSourceFile::handle_entity_instantiation(std::string library_name, std::string entity_name, std::string architecture_name)
+void VHDLSourceFile::handle(TokenCode<entity_instantiation>, boost::string_ref library_name, boost::string_ref entity_name, boost::string_ref architecture_name)
 {
     if (!translating) {
         return;
     }
 
     DQ library_q;
-    if (library_name != "") {
-        library_q = DQ("lib", library_name);
+    if (!library_name.empty()) {
+        library_q = DQ("lib", library_name.to_string());
     } else {
         for (auto &x: imported_libraries) {
             library_q |= DQ("lib", x);
@@ -124,34 +224,34 @@ void VHDLSourceFile::handle_entity_instantiation(std::string library_name, std::
     }
 
     DQ architecture_q;
-    if (architecture_name != "") {
-        architecture_q = DQ("arch", architecture_name);
+    if (!architecture_name.empty()) {
+        architecture_q = DQ("arch", architecture_name.to_string());
     } else {
         architecture_q = DQ("arch");
     }
 
-    add_need(library_q & DQ("ent", entity_name) & architecture_q);
+    add_need(library_q & DQ("ent", entity_name.to_string()) & architecture_q, offset_of(entity_name));
 }
 
-void VHDLSourceFile::handle_package_declaration(std::string name)
+void VHDLSourceFile::handle(TokenCode<package_declaration>, boost::string_ref name)
 {
     if (!translating) {
         return;
     }
 
-    add_provide(DQ("lib", destination_library) & DQ("pkg", name));
+    add_provide(DQ("lib", destination_library) & DQ("pkg", name.to_string()));
 }
 
-void VHDLSourceFile::handle_entity_declaration(std::string name)
+void VHDLSourceFile::handle(TokenCode<entity_declaration>, boost::string_ref name)
 {
     if (!translating) {
         return;
     }
 
-    add_provide(DQ("lib", destination_library) & DQ("ent", name));
+    add_provide(DQ("lib", destination_library) & DQ("ent", name.to_string()));
 }
 
-void VHDLSourceFile::handle_architecture_declaration(std::string name, std::string entity_name)
+void VHDLSourceFile::handle(TokenCode<architecture_declaration>, boost::string_ref name, boost::string_ref entity_name)
 {
     if (!translating) {
         return;
@@ -162,41 +262,84 @@ void VHDLSourceFile::handle_architecture_declaration(std::string name, std::stri
         library_q |= DQ("lib", x);
     }
 
-    add_need(library_q & DQ("ent", entity_name));
-    add_provide(DQ("lib", destination_library) & DQ("ent", entity_name) & DQ("arch", name));
+    add_need(library_q & DQ("ent", entity_name.to_string()), offset_of(entity_name));
+    add_provide(DQ("lib", destination_library) & DQ("ent", entity_name.to_string()) & DQ("arch", name.to_string()));
 }
 
 
 void VHDLSourceFile::parse(char const * const text, size_t text_size)
 {
-    for (auto &token: vhdl_tokenizer.tokenize(text, text_size)) {
-        switch (token.code) {
-        case library_pragma:
-            handle_library_pragma(token.groups[0]);
-            break;
-        case translate_pragma:
-            handle_translate_pragma(token.groups[0]);
-            break;
-        case library_statement:
-            handle_library_statement(token.groups[0]);
-            break;
-        case use_statement:
-            handle_use_statement(token.groups[0]);
-            break;
-        case entity_instantiation:
-            handle_entity_instantiation(token.groups[0], token.groups[1], token.groups[2]);
-            break;
-        case package_declaration:
-            handle_package_declaration(token.groups[0]);
-            break;
-        case entity_declaration:
-            handle_entity_declaration(token.groups[0]);
-            break;
-        case architecture_declaration:
-            handle_architecture_declaration(token.groups[0], token.groups[1]);
-            break;
+    // Only the offset of each token is remembered, lines are counted when a diagnostic needs them.
+    parse_text = text;
+
+    // Each token is handled as soon as it is found, in order, because the pragmas change
+    // the state of the parser; the tokens point directly into the text.
+    auto handler = [this](auto code, auto... groups) {
+        handle(code, groups...);
+        hash_until(offset_of_token(groups...));
+    };
+
+    // The tokens of the other tokenizers, and of the stream, are passed as a TokenView.
+    auto on_token = [&handler](TokenView const &token) {
+        vhdl_grammar().visit_token(token, handler);
+    };
+
+    switch (options.tokenizer) {
+    case Options::lexer_tokenizer:
+        VHDLLexer::for_each_token(text, text_size, handler);
+        return;
+    case Options::posix_tokenizer:
+        vhdl_backend(options.tokenizer).for_each_token(text, text_size, on_token);
+        return;
+    }
+
+    // A file that is edited by hand is only tokenized again around the edits. Larger files
+    // are tokenized by several threads instead, they are usually generated as a whole.
+    auto stream_filename = cache_filename(".tokens");
+    if (!stream_filename.empty() && text_size < VHDLSourceFile_min_chunk_size) {
+        static const auto   key = TokenizerCache::key(vhdl_grammar().tokenizer);
+        TokenStream         stream(options.hash_algorithm);
+
+        // The text is hashed along with its chunks, before the tokens are replayed.
+        auto loaded = stream.load(stream_filename, key);
+        if (stream.update(vhdl_grammar().tokenizer, text, text_size, take_hasher()) || !loaded) {
+            // The cache is only an optimization, the next invocation will try again.
+            try {
+                fs::create_directories(stream_filename.parent_path());
+                stream.save(stream_filename, key);
+            } catch (std::exception &) {
+            }
+        }
+
+        stream.for_each_token(text, on_token);
+        return;
+    }
+
+    auto            &pool = ThreadPool::shared();
+    ThreadPoolGroup group;
+    size_t          nr_chunks = std::min(pool.nr_jobs(), text_size / VHDLSourceFile_min_chunk_size);
+
+    // The chunks are tokenized by other threads before their tokens are handled here, so hashing
+    // along with the tokens would be a second pass after the tokenizer. Instead the text is hashed
+    // by a task of its own, at the same time as the chunks are tokenized.
+    ContentHasher *hasher = nr_chunks > 1 ? take_hasher() : NULL;
+    if (hasher != NULL) {
+        pool.submit(group, [hasher,text,text_size]() {
+            hasher->update(text, text_size);
+        });
+    }
+
+    try {
+        vhdl_grammar().parallel_for_each_token(text, text_size, nr_chunks, handler);
+    } catch (...) {
+        // The task refers to the hasher of the caller.
+        try {
+            pool.wait(group);
+        } catch (...) {
         }
+        throw;
     }
+    pool.wait(group);
 }
 
 
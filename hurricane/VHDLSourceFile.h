@@ -24,7 +24,11 @@
  */
 #ifndef TAKEVOS_HURRICANE_VHDLSOURCEFILE_H
 #define TAKEVOS_HURRICANE_VHDLSOURCEFILE_H
+#include <algorithm>
+#include <initializer_list>
 #include "SourceFile.h"
+#include "Grammar.h"
+#include "TokenizerBackend.h"
 
 namespace takevos {
 namespace hurricane {
@@ -39,23 +43,73 @@ public:
     static const int package_declaration        = 6;
     static const int entity_declaration         = 7;
     static const int architecture_declaration   = 8;
-    static const Tokenizer vhdl_tokenizer;
+
+    using VHDLGrammar = Grammar<
+        TokenRule<library_pragma, 1>,
+        TokenRule<translate_pragma, 1>,
+        TokenRule<translate_pragma, 1>,
+        TokenRule<translate_pragma, 1>,
+        TokenRule<Token::suppress, 0>,
+        TokenRule<library_statement, 1>,
+        TokenRule<use_statement, 1>,
+        TokenRule<entity_instantiation, 3>,
+        TokenRule<package_declaration, 1>,
+        TokenRule<entity_declaration, 1>,
+        TokenRule<architecture_declaration, 2>
+    >;
+
+    /** The grammar of VHDL, which is compiled on first use.
+     */
+    static VHDLGrammar const &vhdl_grammar(void);
+
+    /** The tokenizer backend for VHDL.
+     * @param tokenizer     One of Options::dfa_tokenizer, posix_tokenizer or lexer_tokenizer.
+     */
+    static TokenizerBackend const &vhdl_backend(int tokenizer);
+
+    /** Run every tokenizer backend on a set of files.
+     * For each backend the throughput is printed, and the number of files for which
+     * the tokens are the same as those of the default backend.
+     *
+     * @param filenames     The VHDL files to tokenize.
+     */
+    static void benchmark_tokenizers(std::vector<fs::path> const &filenames);
 
     VHDLSourceFile(fs::path const &filename);
-    
+
+    virtual uint128_t record_key(void) const;
+
 private:
     bool                        translating;
     std::string                 destination_library;
     std::vector<std::string>    imported_libraries;
+    char const                  *parse_text;        ///< The text being parsed, to find the offset of a token.
+
+    size_t offset_of(boost::string_ref group) const {
+        return group.data() - parse_text;
+    }
+
+    /** The offset of the last sub expression of a token that was found, or zero.
+     */
+    template <typename... G>
+    size_t offset_of_token(G... groups) const {
+        size_t r = 0;
+        for (auto group: std::initializer_list<boost::string_ref>{groups...}) {
+            if (group.data() != NULL) {
+                r = std::max(r, offset_of(group));
+            }
+        }
+        return r;
+    }
 
-    void handle_library_pragma(std::string name);
-    void handle_translate_pragma(std::string value);
-    void handle_library_statement(std::string name);
-    void handle_use_statement(std::string name);
-    void handle_entity_instantiation(std::string library_name, std::string entity_name, std::string architecture_name);
-    void handle_package_declaration(std::string name);
-    void handle_entity_declaration(std::string name);
-    void handle_architecture_declaration(std::string name, std::string entity_name);
+    void handle(TokenCode<library_pragma>, boost::string_ref name);
+    void handle(TokenCode<translate_pragma>, boost::string_ref value);
+    void handle(TokenCode<library_statement>, boost::string_ref name);
+    void handle(TokenCode<use_statement>, boost::string_ref name);
+    void handle(TokenCode<entity_instantiation>, boost::string_ref library_name, boost::string_ref entity_name, boost::string_ref architecture_name);
+    void handle(TokenCode<package_declaration>, boost::string_ref name);
+    void handle(TokenCode<entity_declaration>, boost::string_ref name);
+    void handle(TokenCode<architecture_declaration>, boost::string_ref name, boost::string_ref entity_name);
     virtual void parse(char const * const text, size_t text_size);
 };
 
@@ -28,6 +28,8 @@
 #include <boost/test/execution_monitor.hpp>
 #include <boost/filesystem.hpp>
 #include "VHDLSourceFile.h"
+#include "FileHandle.h"
+#include "Options.h"
 
 using namespace std;
 using namespace boost::filesystem;
@@ -35,6 +37,7 @@ using namespace takevos::hurricane;
 
 struct F {
     fs::path base_path;
+    fs::path user_cache_directory;
 
     static const char *text;
     static const size_t text_size;
@@ -42,10 +45,16 @@ struct F {
     F() {
         base_path = string_format("/tmp/VHDLSourceFile-tests-%i.vhd", (int)getpid());
         write_to_file(base_path, std::string(text, text_size));
+
+        // Records of earlier runs must not be used, nor written into the cache of the user.
+        user_cache_directory = options.cache_directory;
+        options.cache_directory = string_format("/tmp/VHDLSourceFile-tests-fixture-%i", (int)getpid());
     }
 
     ~F() {
         remove_all(base_path);
+        remove_all(options.cache_directory);
+        options.cache_directory = user_cache_directory;
     }
 };
 
@@ -89,7 +98,7 @@ BOOST_FIXTURE_TEST_SUITE(VHDLSourceFile_tests, F)
 BOOST_AUTO_TEST_CASE(tokenizer_simple_1)
 {
     VHDLSourceFile      source_file(base_path);
-    std::vector<Token>  result = source_file.vhdl_tokenizer.tokenize(text, text_size);
+    std::vector<Token>  result = source_file.vhdl_grammar().tokenizer.tokenize(text, text_size);
     std::vector<Token>  expected;
     
     expected.push_back(Token(VHDLSourceFile::library_pragma,            "testlib", NULL));
@@ -104,6 +113,11 @@ BOOST_AUTO_TEST_CASE(tokenizer_simple_1)
     expected.push_back(Token(VHDLSourceFile::entity_instantiation,      "work", "instance3", "rtl", NULL));
     expected.push_back(Token(VHDLSourceFile::entity_instantiation,      "", "instance4", "", NULL));
     BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+
+    // Only the offset of a token is known, the line is found through the index.
+    LineIndex index(text, text_size);
+    BOOST_CHECK_EQUAL(result[3].offset, strstr(text, "use work.use1") - text);
+    BOOST_CHECK_EQUAL(index.line(text, result[3].offset), 6);
 }
 
 BOOST_AUTO_TEST_CASE(parser_1)
@@ -111,7 +125,17 @@ BOOST_AUTO_TEST_CASE(parser_1)
     VHDLSourceFile source_file(base_path);
 
     source_file.process_file();
-    BOOST_CHECK_EQUAL(source_file.md5hash, 0x228ca5807f98eae320eb3bd5869a115a_ULLL);
+    BOOST_CHECK_EQUAL(source_file.content_hash.algorithm, ContentHash::fast);
+    BOOST_CHECK_NE(source_file.content_hash.value, 0x228ca5807f98eae320eb3bd5869a115a_ULLL);
+
+    // The known MD5 of the file.
+    options.hash_algorithm = ContentHash::md5;
+    source_file.process_file();
+    options.hash_algorithm = ContentHash::fast;
+    BOOST_CHECK_EQUAL(source_file.content_hash, ContentHash(ContentHash::md5, 0x228ca5807f98eae320eb3bd5869a115a_ULLL));
+    BOOST_REQUIRE_EQUAL(source_file.need_offsets.size(), source_file.needs.size());
+    BOOST_CHECK_EQUAL(source_file.location(source_file.need_offsets[0]), base_path.string() + ":6:5");
+    BOOST_CHECK_EQUAL(source_file.location(source_file.need_offsets.back()), base_path.string() + ":28:8");
     for (auto &x: source_file.needs) {
         std::cerr << "needs:" << x << std::endl;
     }
@@ -120,5 +144,202 @@ BOOST_AUTO_TEST_CASE(parser_1)
     }
 }
 
+BOOST_AUTO_TEST_CASE(parser_hash_1)
+{
+    // A file of several hash blocks gives the same hash as hashing it on its own.
+    fs::path    large_path = string_format("/tmp/VHDLSourceFile-tests-large-%i.vhd", (int)getpid());
+    std::string large_text;
+
+    while (large_text.size() < 300000) {
+        large_text.append(text, text_size);
+    }
+    large_text += "-- no token after this comment\n";
+    write_to_file(large_path, large_text);
+
+    for (auto algorithm: {ContentHash::fast, ContentHash::md5}) {
+        VHDLSourceFile source_file(large_path);
+
+        options.hash_algorithm = algorithm;
+        source_file.process_file();
+        BOOST_CHECK(!source_file.from_record);
+        BOOST_CHECK_EQUAL(source_file.content_hash, ContentHash::hash(algorithm, large_text.data(), large_text.size()));
+    }
+    options.hash_algorithm = ContentHash::fast;
+    fs::remove(large_path);
+}
+
+BOOST_AUTO_TEST_CASE(parser_hash_2)
+{
+    // A file that is tokenized in chunks by several threads is hashed by a separate task.
+    fs::path    large_path = string_format("/tmp/VHDLSourceFile-tests-huge-%i.vhd", (int)getpid());
+    std::string large_text(text, text_size);
+
+    while (large_text.size() < 40 * 1024 * 1024) {
+        large_text += "    q <= d and not reset;\n";
+    }
+    large_text.append(text, text_size);
+    write_to_file(large_path, large_text);
+
+    VHDLSourceFile source_file(large_path);
+    source_file.process_file();
+    BOOST_CHECK_EQUAL(source_file.content_hash, ContentHash::hash(options.hash_algorithm, large_text.data(), large_text.size()));
+    fs::remove(large_path);
+}
+
+BOOST_AUTO_TEST_CASE(parser_batch_1)
+{
+    // Separate files, so that none is taken from the record of another.
+    fs::path directory = string_format("/tmp/VHDLSourceFile-tests-batch-%i", (int)getpid());
+    create_directories(directory);
+    for (int i = 0; i < 100; i++) {
+        write_to_file(directory / string_format("file-%i.vhd", i), std::string(text, text_size));
+    }
+
+    // Files of at least the threshold are mapped, smaller files are read by the FileLoader.
+    for (auto threshold: {FileHandle::default_mmap_threshold, text_size}) {
+        for (auto algorithm: {ContentHash::fast, ContentHash::md5}) {
+            VHDLSourceFile                                  expected(base_path);
+            std::vector<std::unique_ptr<VHDLSourceFile>>    source_files;
+            std::vector<SourceFile *>                       batch;
+
+            FileHandle::mmap_threshold = threshold;
+            options.hash_algorithm = algorithm;
+            expected.process_file();
+
+            // Without a record each file is read, hashed and parsed by the batch.
+            remove_all(options.cache_directory / "files");
+            for (int i = 0; i < 100; i++) {
+                source_files.emplace_back(new VHDLSourceFile(directory / string_format("file-%i.vhd", i)));
+                batch.push_back(source_files.back().get());
+            }
+            SourceFile::process_files(batch);
+
+            for (auto &source_file: source_files) {
+                BOOST_CHECK(!source_file->from_record);
+                BOOST_CHECK_EQUAL(source_file->content_hash, expected.content_hash);
+                BOOST_CHECK_EQUAL(source_file->needs.size(), expected.needs.size());
+                BOOST_CHECK(source_file->provides == expected.provides);
+            }
+        }
+    }
+    FileHandle::mmap_threshold = FileHandle::default_mmap_threshold;
+    options.hash_algorithm = ContentHash::fast;
+    remove_all(directory);
+}
+
+BOOST_AUTO_TEST_CASE(parser_incremental_1)
+{
+    auto        cache_directory = options.cache_directory;
+    std::string current(text, text_size);
+    auto        needs_of = [this, &current](fs::path const &cache_directory) {
+        options.cache_directory = cache_directory;
+        VHDLSourceFile source_file(base_path);
+        source_file.process_file();
+        BOOST_CHECK_EQUAL(source_file.content_hash, ContentHash::hash(options.hash_algorithm, current.data(), current.size()));
+
+        std::vector<std::string> r;
+        for (size_t i = 0; i < source_file.needs.size(); i++) {
+            r.push_back(source_file.needs[i].string() + string_format("@%zu", source_file.need_offsets[i]));
+        }
+        return r;
+    };
+
+    fs::path directory = string_format("/tmp/VHDLSourceFile-tests-cache-%i", (int)getpid());
+    auto expected = needs_of(fs::path());
+    auto first = needs_of(directory);
+    auto second = needs_of(directory);
+    BOOST_CHECK_EQUAL_COLLECTIONS(first.begin(), first.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(second.begin(), second.end(), expected.begin(), expected.end());
+
+    // The tokens of the edited file are the same as when tokenizing the whole file.
+    std::string edited(text, text_size);
+    edited.insert(edited.find("   i2:"), "   i5: entity work.instance5 port map(clk => clk);\n");
+    write_to_file(base_path, edited);
+    current = edited;
+    expected = needs_of(fs::path());
+    auto third = needs_of(directory);
+    BOOST_CHECK_EQUAL(third.size(), first.size() + 1);
+    BOOST_CHECK_EQUAL_COLLECTIONS(third.begin(), third.end(), expected.begin(), expected.end());
+
+    remove_all(directory);
+    options.cache_directory = cache_directory;
+}
+
+BOOST_AUTO_TEST_CASE(parser_record_1)
+{
+    auto    cache_directory = options.cache_directory;
+    auto    process = [this]() {
+        std::unique_ptr<VHDLSourceFile> source_file(new VHDLSourceFile(base_path));
+        source_file->process_file();
+        return source_file;
+    };
+
+    options.cache_directory = string_format("/tmp/VHDLSourceFile-tests-record-%i", (int)getpid());
+    auto expected = process();
+    BOOST_CHECK(!expected->from_record);
+
+    // The file was written less than a second ago, so the record is only used after verifying the contents.
+    auto verified = process();
+    BOOST_CHECK(verified->from_record);
+
+    // A file modified long ago is not read.
+    last_write_time(base_path, time(NULL) - 3600);
+    BOOST_CHECK(!process()->from_record);
+    auto reused = process();
+    BOOST_CHECK(reused->from_record);
+
+    for (auto &x: {verified.get(), reused.get()}) {
+        BOOST_CHECK_EQUAL(x->content_hash, expected->content_hash);
+        BOOST_CHECK_EQUAL_COLLECTIONS(x->need_offsets.begin(), x->need_offsets.end(), expected->need_offsets.begin(), expected->need_offsets.end());
+        BOOST_REQUIRE_EQUAL(x->needs.size(), expected->needs.size());
+        for (size_t i = 0; i < x->needs.size(); i++) {
+            BOOST_CHECK_EQUAL(x->needs[i].string(), expected->needs[i].string());
+        }
+        BOOST_CHECK(x->provides == expected->provides);
+    }
+
+    // The result of parsing depends on the compilation mode.
+    options.compilation_mode = Options::synthesis;
+    BOOST_CHECK(!process()->from_record);
+    options.compilation_mode = Options::simulation;
+
+    // A modified file is parsed again.
+    write_to_file(base_path, std::string(text, text_size) + "entity appended is\n");
+    auto modified = process();
+    BOOST_CHECK(!modified->from_record);
+    BOOST_CHECK_EQUAL(modified->provides.size(), expected->provides.size() + 1);
+
+    remove_all(options.cache_directory);
+    options.cache_directory = cache_directory;
+}
+
+BOOST_AUTO_TEST_CASE(parser_record_2)
+{
+    auto    cache_directory = options.cache_directory;
+    auto    tokenizer = options.tokenizer;
+    auto    process = [this]() {
+        std::unique_ptr<VHDLSourceFile> source_file(new VHDLSourceFile(base_path));
+        source_file->process_file();
+        return source_file;
+    };
+
+    options.cache_directory = string_format("/tmp/VHDLSourceFile-tests-record-%i", (int)getpid());
+    last_write_time(base_path, time(NULL) - 3600);
+
+    // A record written by one tokenizer is not used by another, which may tokenize differently.
+    for (auto backend: {Options::dfa_tokenizer, Options::lexer_tokenizer, Options::posix_tokenizer}) {
+        options.tokenizer = backend;
+        auto first = process();
+        BOOST_CHECK(!first->from_record);
+        BOOST_CHECK(process()->from_record);
+    }
+
+    options.tokenizer = Options::dfa_tokenizer;
+    BOOST_CHECK(!process()->from_record);
+
+    remove_all(options.cache_directory);
+    options.cache_directory = cache_directory;
+    options.tokenizer = tokenizer;
+}
 
 BOOST_AUTO_TEST_SUITE_END()
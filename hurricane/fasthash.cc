@@ -0,0 +1,292 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HURRICANE_FASTHASH_X86 1
+#endif
+#include "fasthash.h"
+
+namespace takevos {
+namespace hurricane {
+
+static const size_t FastHash_stripe_size = 64;
+static const size_t FastHash_nr_lanes = 8;
+
+/** Number of stripes after which the accumulators are scrambled.
+ */
+static const size_t FastHash_block_stripes = 16;
+
+static const uint64_t FastHash_prime32_1 = 0x9e3779b1;
+static const uint64_t FastHash_prime32_2 = 0x85ebca77;
+static const uint64_t FastHash_prime32_3 = 0xc2b2ae3d;
+static const uint64_t FastHash_prime64_1 = 0x9e3779b185ebca87;
+static const uint64_t FastHash_prime64_2 = 0xc2b2ae3d27d4eb4f;
+static const uint64_t FastHash_prime64_3 = 0x165667b19e3779f9;
+static const uint64_t FastHash_prime64_4 = 0x85ebca77c2b2ae63;
+static const uint64_t FastHash_prime64_5 = 0x27d4eb2f165667c5;
+
+/** Keys which are mixed with the data.
+ * Each stripe of a block starts at a different key, the eight lanes use consecutive keys.
+ */
+static const uint64_t FastHash_secret[FastHash_block_stripes + FastHash_nr_lanes] = {
+    0xbe4ba423396cfeb8, 0x1cad21f72c81017c, 0xdb979083e96dd4de, 0x1f67b3b7a4a44072,
+    0x78e5c0cc4ee679cb, 0x2172ffcc7dd05a82, 0x8e2443f7744608b8, 0x4c263a81e69035e0,
+    0xcb00c391bb52283c, 0xa32e531b8b65d088, 0x4ef90da297486471, 0xd8acdea946ef1938,
+    0x3f349ce33f76faa8, 0x1d4f0bc7c7bbdcf9, 0x3159b4cd4be0518a, 0x647378d9c97e9fc8,
+    0x4c1e07d6e785c4d4, 0x902eeb413fe8a3d3, 0x8e77e22e43f6d319, 0x9589b756c0159fbe,
+    0x9872dc10e3c0cb99, 0x04980bdef2c8dd0e, 0xf0898d49fea6c3d8, 0xb59973e1492fbd9f
+};
+
+static inline uint64_t FastHash_read64(const char *p)
+{
+    uint64_t x;
+
+    memcpy(&x, p, sizeof (x));
+    return le64toh(x);
+}
+
+/** Multiply two 64 bit values into 128 bits and fold the halves together.
+ */
+static inline uint64_t FastHash_fold(uint64_t a, uint64_t b)
+{
+    uint128_t product = (uint128_t)a * b;
+
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static inline uint64_t FastHash_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919e3779f9;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline void FastHash_accumulate(uint64_t acc[FastHash_nr_lanes], const char *stripe, size_t key)
+{
+    for (size_t i = 0; i < FastHash_nr_lanes; i++) {
+        uint64_t value = FastHash_read64(&stripe[i * sizeof (uint64_t)]);
+        uint64_t keyed = value ^ FastHash_secret[key + i];
+
+        // The data itself is added to the neighbouring lane, so that it is not lost when the key cancels it out.
+        acc[i ^ 1] += value;
+        acc[i] += (keyed & 0xffffffff) * (keyed >> 32);
+    }
+}
+
+static inline void FastHash_scramble(uint64_t acc[FastHash_nr_lanes])
+{
+    for (size_t i = 0; i < FastHash_nr_lanes; i++) {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= FastHash_secret[FastHash_block_stripes + i];
+        acc[i] *= FastHash_prime32_1;
+    }
+}
+
+static inline uint64_t FastHash_merge(uint64_t const acc[FastHash_nr_lanes], size_t key, uint64_t start)
+{
+    uint64_t r = start;
+
+    for (size_t i = 0; i < FastHash_nr_lanes; i += 2) {
+        r += FastHash_fold(acc[i] ^ FastHash_secret[key + i], acc[i + 1] ^ FastHash_secret[key + i + 1]);
+    }
+    return FastHash_avalanche(r);
+}
+
+/** Accumulate whole stripes, scrambling after each block.
+ * @param first_stripe  The index of the first stripe in the whole data, which selects the keys.
+ */
+static void FastHash_stripes_scalar(uint64_t acc[FastHash_nr_lanes], const char *data, size_t nr_stripes, uint64_t first_stripe)
+{
+    for (size_t i = 0; i < nr_stripes; i++) {
+        auto stripe_in_block = (first_stripe + i) % FastHash_block_stripes;
+
+        FastHash_accumulate(acc, &data[i * FastHash_stripe_size], stripe_in_block);
+        if (stripe_in_block == FastHash_block_stripes - 1) {
+            FastHash_scramble(acc);
+        }
+    }
+}
+
+#ifdef HURRICANE_FASTHASH_X86
+__attribute__((target("avx2"),always_inline))
+static inline __m256i FastHash_scramble_avx2(__m256i acc, __m256i key, __m256i prime)
+{
+    acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+    acc = _mm256_xor_si256(acc, key);
+
+    // A 64 by 32 bit multiply from two 32 by 32 bit multiplies.
+    auto low = _mm256_mul_epu32(acc, prime);
+    auto high = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+    return _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+}
+
+/** Accumulate whole stripes, with the eight lanes in two AVX2 registers.
+ * The result is the same as FastHash_stripes_scalar(); x86 is little endian.
+ */
+__attribute__((target("avx2")))
+static void FastHash_stripes_avx2(uint64_t acc[FastHash_nr_lanes], const char *data, size_t nr_stripes, uint64_t first_stripe)
+{
+    auto acc0 = _mm256_loadu_si256((__m256i const *)&acc[0]);
+    auto acc1 = _mm256_loadu_si256((__m256i const *)&acc[4]);
+    auto scramble_key0 = _mm256_loadu_si256((__m256i const *)&FastHash_secret[FastHash_block_stripes]);
+    auto scramble_key1 = _mm256_loadu_si256((__m256i const *)&FastHash_secret[FastHash_block_stripes + 4]);
+    auto prime = _mm256_set1_epi64x(FastHash_prime32_1);
+
+    for (size_t i = 0; i < nr_stripes; i++) {
+        auto stripe = &data[i * FastHash_stripe_size];
+        auto stripe_in_block = (first_stripe + i) % FastHash_block_stripes;
+        auto key = &FastHash_secret[stripe_in_block];
+        auto value0 = _mm256_loadu_si256((__m256i const *)&stripe[0]);
+        auto value1 = _mm256_loadu_si256((__m256i const *)&stripe[32]);
+        auto keyed0 = _mm256_xor_si256(value0, _mm256_loadu_si256((__m256i const *)&key[0]));
+        auto keyed1 = _mm256_xor_si256(value1, _mm256_loadu_si256((__m256i const *)&key[4]));
+
+        // Swap the 64 bit words of each pair to add the data to the neighbouring lane.
+        acc0 = _mm256_add_epi64(acc0, _mm256_shuffle_epi32(value0, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_shuffle_epi32(value1, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc0 = _mm256_add_epi64(acc0, _mm256_mul_epu32(keyed0, _mm256_srli_epi64(keyed0, 32)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_mul_epu32(keyed1, _mm256_srli_epi64(keyed1, 32)));
+
+        if (stripe_in_block == FastHash_block_stripes - 1) {
+            acc0 = FastHash_scramble_avx2(acc0, scramble_key0, prime);
+            acc1 = FastHash_scramble_avx2(acc1, scramble_key1, prime);
+        }
+    }
+
+    _mm256_storeu_si256((__m256i *)&acc[0], acc0);
+    _mm256_storeu_si256((__m256i *)&acc[4], acc1);
+}
+#endif
+
+int FastHash_best_implementation(void)
+{
+    static const int implementation = []() {
+#ifdef HURRICANE_FASTHASH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return FastHash_avx2;
+        }
+#endif
+        return FastHash_scalar;
+    }();
+
+    return implementation;
+}
+
+static void FastHash_stripes(int implementation, uint64_t acc[FastHash_nr_lanes], const char *data, size_t nr_stripes, uint64_t first_stripe)
+{
+    switch (implementation) {
+#ifdef HURRICANE_FASTHASH_X86
+    case FastHash_avx2:
+        return FastHash_stripes_avx2(acc, data, nr_stripes, first_stripe);
+#endif
+    default:
+        return FastHash_stripes_scalar(acc, data, nr_stripes, first_stripe);
+    }
+}
+
+void FastHasher::init(void)
+{
+    static const uint64_t initial_acc[FastHash_nr_lanes] = {
+        FastHash_prime32_3, FastHash_prime64_1, FastHash_prime64_2, FastHash_prime64_3,
+        FastHash_prime64_4, FastHash_prime32_2, FastHash_prime64_5, FastHash_prime32_1
+    };
+
+    memcpy(acc, initial_acc, sizeof (acc));
+    buffer_size = 0;
+    nr_stripes = 0;
+    data_size = 0;
+}
+
+void FastHasher::update(const char *data, size_t size)
+{
+    data_size += size;
+
+    // The stripe with the last byte is handled by final(), so a stripe is only
+    // accumulated when more data follows it.
+    if (buffer_size + size <= FastHash_stripe_size) {
+        memcpy(&buffer[buffer_size], data, size);
+        buffer_size += size;
+        return;
+    }
+
+    if (buffer_size > 0) {
+        auto n = FastHash_stripe_size - buffer_size;
+        memcpy(&buffer[buffer_size], data, n);
+        data += n;
+        size -= n;
+
+        FastHash_stripes(implementation, acc, buffer, 1, nr_stripes++);
+        memcpy(last_stripe, buffer, FastHash_stripe_size);
+        buffer_size = 0;
+    }
+
+    auto n = (size - 1) / FastHash_stripe_size;
+    if (n > 0) {
+        FastHash_stripes(implementation, acc, data, n, nr_stripes);
+        nr_stripes += n;
+        memcpy(last_stripe, &data[(n - 1) * FastHash_stripe_size], FastHash_stripe_size);
+        data += n * FastHash_stripe_size;
+        size -= n * FastHash_stripe_size;
+    }
+
+    memcpy(buffer, data, size);
+    buffer_size = size;
+}
+
+uint128_t FastHasher::final(void)
+{
+    char stripe[FastHash_stripe_size] = {};
+
+    if (data_size < FastHash_stripe_size) {
+        // A short text is padded with zeros, the size is mixed in at the end.
+        memcpy(stripe, buffer, buffer_size);
+        FastHash_accumulate(acc, stripe, 0);
+
+    } else {
+        // The last stripe overlaps with the previous stripe instead of being padded.
+        auto n = FastHash_stripe_size - buffer_size;
+        memcpy(stripe, &last_stripe[FastHash_stripe_size - n], n);
+        memcpy(&stripe[n], buffer, buffer_size);
+        FastHash_accumulate(acc, stripe, 7);
+    }
+
+    uint64_t low = FastHash_merge(acc, 3, data_size * FastHash_prime64_1);
+    uint64_t high = FastHash_merge(acc, 11, ~(data_size * FastHash_prime64_2));
+    return ((uint128_t)high << 64) | low;
+}
+
+uint128_t FastHash(const char *data, size_t data_size, int implementation)
+{
+    FastHasher hasher(implementation);
+
+    hasher.update(data, data_size);
+    return hasher.final();
+}
+
+}}
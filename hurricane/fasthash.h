@@ -0,0 +1,96 @@
+/* Copyright (c) 2014-2014, Take Vos
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TAKEVOS_HURRICANE_FASTHASH_H
+#define TAKEVOS_HURRICANE_FASTHASH_H
+
+#include <string>
+#include "numbers.h"
+
+namespace takevos {
+namespace hurricane {
+
+static const int FastHash_scalar = 0;  ///< One 64 bit lane at a time.
+static const int FastHash_avx2   = 1;  ///< Four 64 bit lanes at a time using AVX2.
+
+/** The fastest implementation of FastHash supported by this CPU.
+ */
+int FastHash_best_implementation(void);
+
+/** Calculate a fast 128 bit non-cryptographic hash.
+ * The design follows XXH3: the data is processed in 64 byte stripes by
+ * eight 64 bit accumulators, each multiplying the two halves of a data
+ * word mixed with a key; this maps onto 32x32->64 bit vector multiplies.
+ * It is much faster than MD5 and good enough to detect changes to files,
+ * but it is not compatible with XXH3 and not suitable against an adversary.
+ *
+ * @param data              The data to hash.
+ * @param data_size         The size of the data.
+ * @param implementation    One of FastHash_scalar or FastHash_avx2, which must be supported by the CPU.
+ * @return The hash value, which is the same for every implementation.
+ */
+uint128_t FastHash(const char *data, size_t data_size, int implementation = FastHash_best_implementation());
+
+static inline uint128_t FastHash(std::string text)
+{
+   return FastHash(text.c_str(), text.length());
+}
+
+/** Calculate the FastHash of data that is passed in pieces.
+ * The result is the same as FastHash() of the concatenated pieces.
+ */
+class FastHasher {
+public:
+    FastHasher(int implementation = FastHash_best_implementation()) : implementation(implementation) { init(); }
+
+    /** Start a new hash.
+     */
+    void init(void);
+
+    /** Add a piece of data.
+     * @param data          The data to add.
+     * @param data_size     The size of the data.
+     */
+    void update(const char *data, size_t data_size);
+
+    /** Finish the hash.
+     * The hasher must be initialized again before it is reused.
+     *
+     * @return The FastHash of all the data passed to update() since init().
+     */
+    uint128_t final(void);
+
+private:
+    int         implementation;     ///< One of FastHash_scalar or FastHash_avx2.
+    uint64_t    acc[8];             ///< The accumulators.
+    char        buffer[64];         ///< Data that is not accumulated yet, at most a stripe.
+    size_t      buffer_size;        ///< Number of bytes in the buffer.
+    char        last_stripe[64];    ///< The last stripe that was accumulated, the end of the hash may overlap it.
+    uint64_t    nr_stripes;         ///< Number of stripes that were accumulated.
+    uint64_t    data_size;          ///< Number of bytes passed to update().
+};
+
+}}
+
+#endif
@@ -26,18 +26,32 @@
 #include <sysexits.h>
 #include "options.h"
 #include "Project.h"
+#include "VHDLSourceFile.h"
+#include "utils.h"
+#include "FileStatCache.h"
 
 using namespace takevos::hurricane;
 
 int main(int argc, char *argv[])
 {
     options.parse(argc, argv);
+
+    if (options.benchmark_tokenizers) {
+        // Benchmarking does not need a project, any directory with VHDL files will do.
+        VHDLSourceFile::benchmark_tokenizers(search_file_in_subdirectories(options.working_directory, {".vhd", ".vhdl"}));
+        return EX_OK;
+    }
+
     options.post_process();
 
     Project project = options.project_directory;
      
     project.walk();
 
+    auto &file_stat_cache = FileStatCache::shared();
+    options.log(LOG_INFO "File metadata: %zu lookups, %zu system calls, %zu saved",
+        (size_t)file_stat_cache.nr_lookups, (size_t)file_stat_cache.nr_syscalls, file_stat_cache.nr_saved()
+    );
     return EX_OK;
 }
 
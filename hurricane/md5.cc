@@ -27,84 +27,98 @@
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
+#include <algorithm>
+#include <vector>
 #include "utils.h"
 #include "md5.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define HURRICANE_MD5_X86 1
+#endif
+
 namespace takevos {
 namespace hurricane {
 
 
 const unsigned int MD5_chunk_size = 64;
 
-void MD5_round(int i, uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d, uint32_t &f, int &g, uint32_t chunk[])
+static const int MD5_shift_table[64] = {
+    7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
+    5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
+    4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
+    6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21
+};
+
+static const uint32_t MD5_random_table[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint32_t MD5_initial_hash[4] = {
+    0x67452301,
+    0xefcdab89,
+    0x98badcfe,
+    0x10325476
+};
+
+/** A 32 bit word for each lane, using the vector extension of the compiler.
+ * uint32_t itself is used for a single lane.
+ */
+typedef uint32_t MD5_v4 __attribute__((vector_size(16)));
+typedef uint32_t MD5_v8 __attribute__((vector_size(32)));
+typedef uint32_t MD5_v16 __attribute__((vector_size(64)));
+
+template <typename V>
+__attribute__((always_inline)) static inline void MD5_round(int i, V &a, V &b, V &c, V &d, V const &f, V const m[16], int g)
 {
-    uint32_t tmp;
-    const int shift_table[64] = {
-        7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
-        5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
-        4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
-        6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21
-    };
-    const uint32_t random_table[64] = {
-        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
-        0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
-        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
-        0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
-        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
-        0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
-        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
-        0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
-        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
-        0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
-        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
-        0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
-        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
-        0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
-        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
-        0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
-    };
+    V tmp = d;
+    V x = a + f + MD5_random_table[i] + m[g];
 
-    tmp = d;
     d = c;
     c = b;
-    b = b + rol32(a + f + random_table[i] + chunk[g], shift_table[i]);
+    b = b + ((x << MD5_shift_table[i]) | (x >> (32 - MD5_shift_table[i])));
     a = tmp;
 }
 
-void MD5_sign_chunk(uint32_t hash[4], const uint32_t *_chunk)
+/** Add a 64 byte chunk to the hash, of one buffer for each lane of V.
+ * This function is inlined into functions which are compiled for a specific instruction set.
+ *
+ * @param hash      The hash of each lane.
+ * @param m         The 16 little endian words of the chunk of each lane.
+ */
+template <typename V>
+__attribute__((always_inline)) static inline void MD5_compress(V hash[4], V const m[16])
 {
-    uint32_t    chunk[16];
-    uint32_t    a = hash[0];
-    uint32_t    b = hash[1];
-    uint32_t    c = hash[2];
-    uint32_t    d = hash[3];
-    uint32_t    f;
-    int         g;
-    int         i;
-
-    for (i = 0; i < 16; i++) {
-        chunk[i] = le32toh(_chunk[i]);
-    }
+    V   a = hash[0];
+    V   b = hash[1];
+    V   c = hash[2];
+    V   d = hash[3];
 
-    for (i = 0; i < 16; i++) {
-        f = (b & c) | ((~b) & d);
-        g = i;
-        MD5_round(i, a, b, c, d, f, g, chunk);
+    for (int i = 0; i < 16; i++) {
+        MD5_round(i, a, b, c, d, (b & c) | (~b & d), m, i);
     }
-    for (i = 16; i < 32; i++) {
-        f = (d & b) | ((~d) & c);
-        g = (5 * i + 1) & 0xf;
-        MD5_round(i, a, b, c, d, f, g, chunk);
+    for (int i = 16; i < 32; i++) {
+        MD5_round(i, a, b, c, d, (d & b) | (~d & c), m, (5 * i + 1) & 0xf);
     }
-    for (i = 32; i < 48; i++) {
-        f = b ^ c ^ d;
-        g = (3 * i + 5) & 0xf;
-        MD5_round(i, a, b, c, d, f, g, chunk);
+    for (int i = 32; i < 48; i++) {
+        MD5_round(i, a, b, c, d, b ^ c ^ d, m, (3 * i + 5) & 0xf);
     }
-    for (i = 48; i < 64; i++) {
-        f = c ^ (b | (~d));
-        g = (7 * i) & 0xf;
-        MD5_round(i, a, b, c, d, f, g, chunk);
+    for (int i = 48; i < 64; i++) {
+        MD5_round(i, a, b, c, d, c ^ (b | ~d), m, (7 * i) & 0xf);
     }
 
     hash[0] += a;
@@ -113,18 +127,32 @@ void MD5_sign_chunk(uint32_t hash[4], const uint32_t *_chunk)
     hash[3] += d;
 }
 
+void MD5_sign_chunk(uint32_t hash[4], const char *_chunk)
+{
+    uint32_t    chunk[16];
+
+    // The data is copied instead of cast, as it may be unaligned and a cast breaks strict aliasing.
+    memcpy(chunk, _chunk, sizeof (chunk));
+    for (int i = 0; i < 16; i++) {
+        chunk[i] = le32toh(chunk[i]);
+    }
+
+    MD5_compress<uint32_t>(hash, chunk);
+}
+
 /**
  * The last fragment is one or two 64 byte chunks containing:
  * - The last piece of data.
  * - A terminating 0x80 byte.
  * - Padding 0x00 bytes
- * - 64 bit big endian length of data, aligned to the end-edge of a chunk.
+ * - 64 bit little endian length of data, aligned to the end-edge of a chunk.
+ *
+ * @return The number of chunks.
  */
-void MD5_sign_last_fragment(uint32_t hash[4], const char *fragment, size_t fragment_size, size_t data_size)
+static int MD5_last_chunks(char last_chunks[2 * MD5_chunk_size], const char *fragment, size_t fragment_size, size_t data_size)
 {
-    char    last_chunks[2 * MD5_chunk_size];
     size_t  last_chunks_size; // The size of the last_chunks is unknown until padding is calculated.
-    off_t   offset = 0;
+    size_t  offset = 0;
 
     memcpy(last_chunks, fragment, fragment_size);
     offset += fragment_size;
@@ -133,7 +161,7 @@ void MD5_sign_last_fragment(uint32_t hash[4], const char *fragment, size_t fragm
     last_chunks[offset++] = 0x80;
 
     // The last 64 bit of the last chunk is the length.
-    if (offset < (MD5_chunk_size - sizeof (uint64_t))) {
+    if (offset <= (MD5_chunk_size - sizeof (uint64_t))) {
         // There enough room in the current chunk.
         last_chunks_size = MD5_chunk_size;
     } else {
@@ -145,38 +173,259 @@ void MD5_sign_last_fragment(uint32_t hash[4], const char *fragment, size_t fragm
     memset(&last_chunks[offset], 0, padding_size);
     offset += padding_size;
 
-    // Save the size as big endian.
-    *((uint64_t *)&last_chunks[offset]) = htole64(data_size);
+    // Save the size as little endian.
+    uint64_t size = htole64(data_size);
+    memcpy(&last_chunks[offset], &size, sizeof (size));
 
-    MD5_sign_chunk(hash, (uint32_t *)&last_chunks[0]);
-    if (last_chunks_size > MD5_chunk_size) {
-        MD5_sign_chunk(hash, (uint32_t *)&last_chunks[MD5_chunk_size]);
-    }
+    return last_chunks_size / MD5_chunk_size;
 }
 
-uint128_t MD5(const char *data, size_t data_size)
+void MD5_sign_last_fragment(uint32_t hash[4], const char *fragment, size_t fragment_size, size_t data_size)
 {
-    unsigned int offset;
-    uint32_t hash[4] = {
-        0x67452301,
-        0xefcdab89,
-        0x98badcfe,
-        0x10325476
-    };
+    char    last_chunks[2 * MD5_chunk_size];
+    int     nr_chunks = MD5_last_chunks(last_chunks, fragment, fragment_size, data_size);
 
-    for (offset = 0; offset + MD5_chunk_size - 1 < data_size ; offset += MD5_chunk_size) {
-        MD5_sign_chunk(hash, (uint32_t *)&data[offset]);
+    for (int i = 0; i < nr_chunks; i++) {
+        MD5_sign_chunk(hash, &last_chunks[i * MD5_chunk_size]);
     }
-    MD5_sign_last_fragment(hash, &data[offset], data_size - offset, data_size * 8);
+}
 
+/** Convert the state of the hash to the MD5 value.
+ */
+static uint128_t MD5_result(uint32_t const hash[4])
+{
     uint32_t result_hash[4];
+    uint128_t result;
 
     result_hash[0] = htole32(hash[0]);
     result_hash[1] = htole32(hash[1]);
     result_hash[2] = htole32(hash[2]);
     result_hash[3] = htole32(hash[3]);
 
-    return be128toh(*(uint128_t *)result_hash);
+    memcpy(&result, result_hash, sizeof (result));
+    return be128toh(result);
+}
+
+uint128_t MD5(const char *data, size_t data_size)
+{
+    size_t offset;
+    uint32_t hash[4];
+
+    memcpy(hash, MD5_initial_hash, sizeof (hash));
+    for (offset = 0; offset + MD5_chunk_size - 1 < data_size ; offset += MD5_chunk_size) {
+        MD5_sign_chunk(hash, &data[offset]);
+    }
+    MD5_sign_last_fragment(hash, &data[offset], data_size - offset, data_size * 8);
+
+    return MD5_result(hash);
+}
+
+void MD5Hasher::init(void)
+{
+    memcpy(hash, MD5_initial_hash, sizeof (hash));
+    buffer_size = 0;
+    data_size = 0;
+}
+
+void MD5Hasher::update(const char *data, size_t size)
+{
+    data_size += size;
+
+    // Complete the chunk that was started by a previous update.
+    if (buffer_size > 0) {
+        auto n = std::min(size, MD5_chunk_size - buffer_size);
+        memcpy(&buffer[buffer_size], data, n);
+        buffer_size += n;
+        data += n;
+        size -= n;
+
+        if (buffer_size < MD5_chunk_size) {
+            return;
+        }
+        MD5_sign_chunk(hash, buffer);
+        buffer_size = 0;
+    }
+
+    // Whole chunks are hashed directly from the data.
+    for (; size >= MD5_chunk_size; data += MD5_chunk_size, size -= MD5_chunk_size) {
+        MD5_sign_chunk(hash, data);
+    }
+
+    memcpy(buffer, data, size);
+    buffer_size = size;
+}
+
+uint128_t MD5Hasher::final(void)
+{
+    MD5_sign_last_fragment(hash, buffer, buffer_size, data_size * 8);
+    return MD5_result(hash);
+}
+
+/** A buffer which is being hashed in a lane.
+ */
+struct MD5Lane {
+    size_t      buffer;                         ///< Index of the buffer, or nr_buffers when the lane is idle.
+    size_t      offset;                         ///< Offset in the buffer of the next chunk.
+    size_t      nr_chunks;                      ///< Number of chunks left, including the last chunks.
+    char        last_chunks[2 * MD5_chunk_size];///< The padded last fragment of the buffer.
+};
+
+/** Hash buffers in W lanes at once, each lane hashing a different buffer.
+ * When a lane has finished its buffer it continues with the next buffer,
+ * longest buffers first, so that lanes are rarely idle.
+ *
+ * @param order     The index of each buffer, from long to short.
+ */
+template <typename V, int W>
+__attribute__((always_inline)) static inline void MD5_lanes(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], std::vector<size_t> const &order)
+{
+    static_assert(sizeof (V) == W * sizeof (uint32_t), "A lane is a 32 bit word");
+
+    MD5Lane     lanes[W];
+    uint32_t    hash[4][W];
+    uint32_t    message[16][W];
+    V           hash_v[4];
+    V           message_v[16];
+    size_t      next = 0;
+    int         nr_idle = 0;
+    static const char idle_chunk[MD5_chunk_size] = {};
+
+    auto start = [&](int l) {
+        auto &lane = lanes[l];
+
+        if (next == nr_buffers) {
+            lane.buffer = nr_buffers;
+            nr_idle++;
+            return;
+        }
+
+        lane.buffer = order[next++];
+        lane.offset = 0;
+        auto size = data_size[lane.buffer];
+        auto nr_full_chunks = size / MD5_chunk_size;
+        auto fragment_offset = nr_full_chunks * MD5_chunk_size;
+        lane.nr_chunks = nr_full_chunks + MD5_last_chunks(lane.last_chunks, &data[lane.buffer][fragment_offset], size - fragment_offset, size * 8);
+        for (int i = 0; i < 4; i++) {
+            hash[i][l] = MD5_initial_hash[i];
+        }
+    };
+
+    for (int l = 0; l < W; l++) {
+        start(l);
+    }
+
+    while (nr_idle < W) {
+        // Gather the next chunk of each lane, transposed so that each word of the message is a vector.
+        for (int l = 0; l < W; l++) {
+            auto &lane = lanes[l];
+            char const *chunk;
+
+            if (lane.buffer == nr_buffers) {
+                chunk = idle_chunk;
+            } else if (lane.offset + MD5_chunk_size <= data_size[lane.buffer]) {
+                chunk = &data[lane.buffer][lane.offset];
+            } else {
+                chunk = &lane.last_chunks[lane.offset - data_size[lane.buffer] / MD5_chunk_size * MD5_chunk_size];
+            }
+
+            for (int i = 0; i < 16; i++) {
+                uint32_t word;
+                memcpy(&word, &chunk[i * sizeof (word)], sizeof (word));
+                message[i][l] = le32toh(word);
+            }
+        }
+
+        memcpy(hash_v, hash, sizeof (hash_v));
+        memcpy(message_v, message, sizeof (message_v));
+        MD5_compress<V>(hash_v, message_v);
+        memcpy(hash, hash_v, sizeof (hash));
+
+        for (int l = 0; l < W; l++) {
+            auto &lane = lanes[l];
+
+            if (lane.buffer == nr_buffers) {
+                continue;
+            }
+
+            lane.offset += MD5_chunk_size;
+            if (--lane.nr_chunks == 0) {
+                uint32_t result[4] = {hash[0][l], hash[1][l], hash[2][l], hash[3][l]};
+                hashes[lane.buffer] = MD5_result(result);
+                start(l);
+            }
+        }
+    }
+}
+
+static void MD5_lanes_scalar(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], std::vector<size_t> const &)
+{
+    for (size_t i = 0; i < nr_buffers; i++) {
+        hashes[i] = MD5(data[i], data_size[i]);
+    }
+}
+
+#ifdef HURRICANE_MD5_X86
+__attribute__((target("sse2")))
+static void MD5_lanes_sse2(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], std::vector<size_t> const &order)
+{
+    MD5_lanes<MD5_v4, 4>(nr_buffers, data, data_size, hashes, order);
+}
+
+__attribute__((target("avx2")))
+static void MD5_lanes_avx2(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], std::vector<size_t> const &order)
+{
+    MD5_lanes<MD5_v8, 8>(nr_buffers, data, data_size, hashes, order);
+}
+
+__attribute__((target("avx512f")))
+static void MD5_lanes_avx512(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], std::vector<size_t> const &order)
+{
+    MD5_lanes<MD5_v16, 16>(nr_buffers, data, data_size, hashes, order);
+}
+#endif
+
+void MD5(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], int implementation)
+{
+    std::vector<size_t> order(nr_buffers);
+
+    for (size_t i = 0; i < nr_buffers; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [data_size](size_t a, size_t b) {
+        return data_size[a] > data_size[b];
+    });
+
+    switch (implementation) {
+#ifdef HURRICANE_MD5_X86
+    case MD5_avx512:
+        return MD5_lanes_avx512(nr_buffers, data, data_size, hashes, order);
+    case MD5_avx2:
+        return MD5_lanes_avx2(nr_buffers, data, data_size, hashes, order);
+    case MD5_sse2:
+        return MD5_lanes_sse2(nr_buffers, data, data_size, hashes, order);
+#endif
+    default:
+        return MD5_lanes_scalar(nr_buffers, data, data_size, hashes, order);
+    }
+}
+
+int MD5_best_implementation(void)
+{
+    static const int implementation = []() {
+#ifdef HURRICANE_MD5_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return MD5_avx512;
+        } else if (__builtin_cpu_supports("avx2")) {
+            return MD5_avx2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            return MD5_sse2;
+        }
+#endif
+        return MD5_scalar;
+    }();
+
+    return implementation;
 }
 
 }}
@@ -25,6 +25,7 @@
 #ifndef TAKEVOS_HURRICANE_MD5_H
 #define TAKEVOS_HURRICANE_MD5_H
 
+#include <string.h>
 #include <string>
 #include <vector>
 #include <tuple>
@@ -35,11 +36,89 @@ namespace hurricane {
 
 uint128_t MD5(const char *data, size_t data_size);
 
+static const int MD5_scalar = 0;    ///< One buffer at a time.
+static const int MD5_sse2   = 1;    ///< 4 buffers at a time using SSE2.
+static const int MD5_avx2   = 2;    ///< 8 buffers at a time using AVX2.
+static const int MD5_avx512 = 3;    ///< 16 buffers at a time using AVX-512.
+
+/** The fastest implementation of the multi-buffer MD5 supported by this CPU.
+ */
+int MD5_best_implementation(void);
+
+/** Calculate the MD5 of several independent buffers at once.
+ * MD5 can not be calculated in parallel within a single buffer, but the
+ * buffers can be hashed in parallel, each in a lane of a SIMD register.
+ * This is most useful for many small files. The implementation is selected
+ * at run time based on the CPU, with a scalar fallback.
+ *
+ * @param nr_buffers        The number of buffers.
+ * @param data              The data of each buffer.
+ * @param data_size         The size of each buffer.
+ * @param hashes            Returns the MD5 of each buffer.
+ * @param implementation    One of MD5_scalar, MD5_sse2, MD5_avx2 or MD5_avx512, which must be supported by the CPU.
+ */
+void MD5(size_t nr_buffers, char const * const data[], size_t const data_size[], uint128_t hashes[], int implementation = MD5_best_implementation());
+
 static inline uint128_t MD5(std::string text)
 {
    return MD5(text.c_str(), text.length());
 }
 
+/** Calculate the MD5 of data that is passed in pieces.
+ * The result is the same as MD5() of the concatenated pieces, without
+ * concatenating them first; for data that is read in blocks and for keys
+ * that are composed of several values.
+ */
+class MD5Hasher {
+public:
+    MD5Hasher() { init(); }
+
+    /** Start a new hash.
+     */
+    void init(void);
+
+    /** Add a piece of data.
+     * @param data          The data to add.
+     * @param data_size     The size of the data.
+     */
+    void update(const char *data, size_t data_size);
+
+    /** Finish the hash.
+     * The hasher must be initialized again before it is reused.
+     *
+     * @return The MD5 of all the data passed to update() since init().
+     */
+    uint128_t final(void);
+
+    /** Add the bytes of a trivially copyable value.
+     */
+    template <typename T>
+    void value(T const &x) {
+        update((char const *)&x, sizeof (x));
+    }
+
+    /** Add a string, preceded by its size so that consecutive strings can not be confused.
+     */
+    void string(char const *x, size_t size) {
+        value((uint64_t)size);
+        update(x, size);
+    }
+
+    void string(char const *x) {
+        string(x, strlen(x));
+    }
+
+    void string(std::string const &x) {
+        string(x.data(), x.size());
+    }
+
+private:
+    uint32_t    hash[4];        ///< The state of the hash.
+    char        buffer[64];     ///< The start of a chunk, which is hashed when it is complete.
+    size_t      buffer_size;    ///< Number of bytes in the buffer.
+    uint64_t    data_size;      ///< Number of bytes passed to update().
+};
+
 }}
 
 #endif
@@ -26,6 +26,8 @@
 #define BOOST_TEST_MODULE utils
 #include <boost/test/unit_test.hpp>
 #include <boost/test/execution_monitor.hpp>
+#include <stdlib.h>
+#include <vector>
 #include "md5.h"
 
 using namespace takevos::hurricane;
@@ -103,5 +105,76 @@ BOOST_AUTO_TEST_CASE(MD5_hash_9)
     BOOST_CHECK_EQUAL(result, expected);
 }
 
+BOOST_AUTO_TEST_CASE(MD5_hash_10)
+{
+    // The length fits in the same chunk as the last 55 bytes of data.
+    __uint128_t result = MD5(std::string(55, 'x'));
+    __uint128_t expected = 0x04364420e25c512fd958a70738aa8f72_ULLL;
 
+    BOOST_CHECK_EQUAL(result, expected);
+}
 
+BOOST_AUTO_TEST_CASE(MD5_multi_buffer_1)
+{
+    std::vector<std::string>    buffers;
+    std::vector<char const *>   data;
+    std::vector<size_t>         data_size;
+
+    srandom(1);
+    for (int i = 0; i < 200; i++) {
+        // Sizes around the chunk boundaries, and a few large buffers.
+        std::string buffer;
+        size_t size = i < 130 ? i : random() % (i % 10 == 0 ? 100000 : 1000);
+        for (size_t j = 0; j < size; j++) {
+            buffer.push_back(random());
+        }
+        buffers.push_back(buffer);
+    }
+    for (auto &buffer: buffers) {
+        data.push_back(buffer.data());
+        data_size.push_back(buffer.size());
+    }
+
+    for (int implementation = MD5_scalar; implementation <= MD5_best_implementation(); implementation++) {
+        std::vector<uint128_t> hashes(buffers.size());
+
+        MD5(buffers.size(), data.data(), data_size.data(), hashes.data(), implementation);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            BOOST_CHECK_EQUAL(hashes[i], MD5(buffers[i]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MD5_hasher_1)
+{
+    MD5Hasher hasher;
+
+    hasher.update("a", 1);
+    hasher.update("", 0);
+    hasher.update("bc", 2);
+    BOOST_CHECK_EQUAL(hasher.final(), 0x900150983cd24fb0d6963f7d28e17f72_ULLL);
+
+    hasher.init();
+    BOOST_CHECK_EQUAL(hasher.final(), 0xd41d8cd98f00b204e9800998ecf8427e_ULLL);
+}
+
+BOOST_AUTO_TEST_CASE(MD5_hasher_2)
+{
+    srandom(2);
+    for (int i = 0; i < 300; i++) {
+        // Pieces of random sizes, which start and end anywhere in a chunk.
+        std::string buffer;
+        size_t size = i < 200 ? i : random() % 10000;
+        for (size_t j = 0; j < size; j++) {
+            buffer.push_back(random());
+        }
+
+        MD5Hasher hasher;
+        for (size_t offset = 0; offset < size;) {
+            size_t piece = std::min(size - offset, (size_t)(random() % 150));
+            hasher.update(&buffer[offset], piece);
+            offset += piece;
+        }
+        BOOST_CHECK_EQUAL(hasher.final(), MD5(buffer));
+    }
+}
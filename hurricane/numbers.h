@@ -42,6 +42,10 @@ static inline uint64_t htole64(uint64_t x) {
     return CFSwapInt64HostToLittle(x);
 }
 
+static inline uint64_t le64toh(uint64_t x) {
+    return CFSwapInt64LittleToHost(x);
+}
+
 static inline uint32_t le32toh(uint32_t x) {
     return CFSwapInt32LittleToHost(x);
 }
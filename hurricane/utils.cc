@@ -29,6 +29,7 @@
 #include <fcntl.h>
 #include "utils.h"
 #include "numbers.h"
+#include "FileStatCache.h"
 
 namespace takevos {
 namespace hurricane {
@@ -70,14 +71,16 @@ std::vector<boost::filesystem::path> super_directories_with_file(boost::filesyst
         return std::vector<boost::filesystem::path>();
     }
 
-    if (canonical(directory) != directory) {
+    auto &cache = FileStatCache::shared();
+
+    if (cache.canonical(directory) != directory) {
         throw std::invalid_argument("Directory is not canonical.");
     }
 
     // Recurse toward root.
     auto r = super_directories_with_file(directory.parent_path(), filename);
 
-    if (exists(directory / filename)) {
+    if (cache.exists(directory / filename)) {
         // The file is found, add the directory where the file was found.
         r.push_back(directory);
     }
@@ -101,8 +104,14 @@ boost::filesystem::path nearest_super_directory_with_file(boost::filesystem::pat
 std::vector<boost::filesystem::path> search_file_in_subdirectories(boost::filesystem::path const & directory, std::vector<std::string> extensions)
 {
     std::vector<boost::filesystem::path>   tmp;
-    //recursive_directory_iterator i = directory;
-    //for (auto
+
+    for (auto i = boost::filesystem::recursive_directory_iterator(directory); i != boost::filesystem::recursive_directory_iterator(); i++) {
+        auto extension = i->path().extension().string();
+
+        if (boost::filesystem::is_regular_file(i->status()) && contains(extensions, extension)) {
+            tmp.push_back(i->path());
+        }
+    }
     return tmp;
 }
 